@@ -0,0 +1,183 @@
+#include "Allocations.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace GravityFun::Allocations
+{
+    /// @brief The index of the allocations outside of any scope.
+    static constexpr std::size_t OTHER = MODULES.size();
+
+    static std::atomic<bool> Enabled{false};
+    static long long WarmupIterations = 0;
+    static std::array<std::atomic<long long>, MODULES.size() + 1> Counts{};
+    static std::array<std::atomic<long long>, MODULES.size() + 1> Bytes{};
+
+    // Only used by NextIteration and the reports, which never run in parallel
+    static long long Iterations = 0;
+    static std::array<long long, MODULES.size() + 1> LastCounts{};
+    static std::array<long long, MODULES.size() + 1> SteadyStateCounts{};
+    static std::array<long long, MODULES.size() + 1> AllocatingIterations{};
+
+    /// @brief The module of the innermost scope of the thread, or -1. Constant initialized, so operator new can use it.
+    static thread_local int CurrentModule = -1;
+
+    static void count(std::size_t size)
+    {
+        if (!Enabled.load(std::memory_order_relaxed))
+            return;
+        std::size_t index = CurrentModule < 0 ? OTHER : (std::size_t)CurrentModule;
+        Counts[index].fetch_add(1, std::memory_order_relaxed);
+        Bytes[index].fetch_add((long long)size, std::memory_order_relaxed);
+    }
+
+    const char * GetName(Module module)
+    {
+        switch (module)
+        {
+        case Module::GameManager: return "game manager";
+        case Module::Notifiers: return "notifiers";
+        case Module::PhysicsPass1: return "physics pass1";
+        case Module::PhysicsPass2: return "physics pass2";
+        case Module::ContactSolving: return "contact solving";
+        case Module::EnergySaver: return "energy saver";
+        case Module::Rendering: return "rendering";
+        }
+        return "";
+    }
+
+    void SetEnabled(bool value, long long warmup_iterations)
+    {
+        WarmupIterations = warmup_iterations;
+        Enabled.store(value, std::memory_order_relaxed);
+    }
+    bool IsEnabled()
+    {
+        return Enabled.load(std::memory_order_relaxed);
+    }
+
+    Scope::Scope(Module module) : PreviousModule(CurrentModule)
+    {
+        CurrentModule = (int)module;
+    }
+    Scope::~Scope()
+    {
+        CurrentModule = PreviousModule;
+    }
+
+    void NextIteration()
+    {
+        if (!IsEnabled())
+            return;
+        Iterations++;
+        for (std::size_t i = 0; i < Counts.size(); i++)
+        {
+            long long count = Counts[i].load(std::memory_order_relaxed);
+            long long difference = count - LastCounts[i];
+            LastCounts[i] = count;
+            if (Iterations > WarmupIterations && difference != 0)
+            {
+                SteadyStateCounts[i] += difference;
+                AllocatingIterations[i]++;
+            }
+        }
+    }
+
+    static Totals get_totals(std::size_t index)
+    {
+        return {
+            Counts[index].load(std::memory_order_relaxed),
+            Bytes[index].load(std::memory_order_relaxed),
+            SteadyStateCounts[index],
+            AllocatingIterations[index]
+        };
+    }
+
+    Totals GetTotals(Module module)
+    {
+        return get_totals((std::size_t)module);
+    }
+
+    bool HasSteadyStateAllocations()
+    {
+        return std::any_of(MODULES.begin(), MODULES.end(), [](Module module) {
+            return GetTotals(module).SteadyStateCount != 0;
+        });
+    }
+
+    void WriteReport(std::ostream& stream)
+    {
+        auto flags = stream.flags();
+        auto precision = stream.precision();
+        double divisor = (double)std::max(1LL, Iterations);
+        stream << "Heap allocations in " << Iterations << " iterations (" << std::min(Iterations, WarmupIterations)
+            << " warm-up):\n" << std::setw(16) << "module" << std::setw(12) << "count" << std::setw(14) << "bytes"
+            << std::setw(16) << "per iteration" << std::setw(14) << "steady state" << std::setw(22) << "allocating iterations"
+            << '\n' << std::fixed << std::setprecision(2);
+        for (std::size_t i = 0; i < Counts.size(); i++)
+        {
+            auto totals = get_totals(i);
+            stream << std::setw(16) << (i == OTHER ? "other" : GetName(MODULES[i])) << std::setw(12) << totals.Count
+                << std::setw(14) << totals.Bytes << std::setw(16) << totals.Count / divisor
+                << std::setw(14) << totals.SteadyStateCount << std::setw(22) << totals.AllocatingIterations << '\n';
+        }
+        stream.flags(flags);
+        stream.precision(precision);
+    }
+}
+
+// The replaced global allocation functions, with the sized deletes. The array and nothrow forms call these by default.
+
+void * operator new(std::size_t size)
+{
+    GravityFun::Allocations::count(size);
+    if (void * pointer = std::malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void * pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+    GravityFun::Allocations::count(size);
+    std::size_t alignment_value = std::max((std::size_t)alignment, sizeof(void *));
+#ifdef _WIN32
+    if (void * pointer = _aligned_malloc(size == 0 ? 1 : size, alignment_value))
+        return pointer;
+#else
+    void * pointer;
+    if (posix_memalign(&pointer, alignment_value, size == 0 ? 1 : size) == 0)
+        return pointer;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void * pointer, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void operator delete(void * pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(pointer, alignment);
+}
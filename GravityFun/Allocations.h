@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <ostream>
+
+namespace GravityFun::Allocations
+{
+    /// @brief The modules that the heap allocations are attributed to.
+    enum class Module
+    {
+        GameManager,
+        /// @brief The pass notifiers of GameManager, with the mapper rebuilds and the contact graph builds.
+        Notifiers,
+        PhysicsPass1,
+        PhysicsPass2,
+        ContactSolving,
+        EnergySaver,
+        Rendering,
+    };
+
+    constexpr std::array<Module, 7> MODULES = {
+        Module::GameManager, Module::Notifiers, Module::PhysicsPass1, Module::PhysicsPass2,
+        Module::ContactSolving, Module::EnergySaver, Module::Rendering
+    };
+
+    const char * GetName(Module);
+
+    /// @brief Starts or stops counting, off by default.
+    ///        The global operator new is replaced in every build, and only counts while enabled.
+    /// @param warmup_iterations The loop iterations after which any allocation of a module is
+    ///                          a steady-state allocation, see NextIteration.
+    void SetEnabled(bool, long long warmup_iterations = 0);
+    bool IsEnabled();
+
+    /// @brief Attributes the allocations of the calling thread from its construction to its destruction to a module.
+    ///        The allocations outside of any scope, like the ones of LoopScheduler and the metrics server,
+    ///        are only counted in the totals of "other".
+    class Scope final
+    {
+    public:
+        explicit Scope(Module);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+    private:
+        int PreviousModule;
+    };
+
+    /// @brief Ends a loop iteration, called by GameManager at the start of each run while nothing else runs.
+    void NextIteration();
+
+    struct Totals
+    {
+        long long Count;
+        long long Bytes;
+        /// @brief The allocations after the warm-up iterations.
+        long long SteadyStateCount;
+        /// @brief The number of the iterations after the warm-up in which the module allocated.
+        long long AllocatingIterations;
+    };
+
+    Totals GetTotals(Module);
+    /// @return Whether any module allocated after the warm-up iterations.
+    bool HasSteadyStateAllocations();
+
+    /// @brief Writes a table of the modules with their allocations per iteration and after the warm-up.
+    void WriteReport(std::ostream&);
+}
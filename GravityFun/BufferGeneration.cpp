@@ -1,5 +1,6 @@
 #include "BufferGeneration.h"
 
+#include <algorithm>
 #include <cmath>
 #include <numbers>
 #include <random>
@@ -68,6 +69,108 @@ namespace GravityFun::BufferGeneration
         return std::make_tuple(vertices, indices);
     }
 
+    inline void push_flat_vertex(std::vector<float>& vertices, Math::Vec2 position)
+    {
+        vertices.push_back((float)position.x);
+        vertices.push_back((float)position.y);
+        vertices.push_back(0);
+        vertices.push_back(0);
+        vertices.push_back(0);
+        vertices.push_back(1);
+    }
+
+    inline double get_cross_product(Math::Vec2 a, Math::Vec2 b, Math::Vec2 c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    std::tuple<std::vector<float>, std::vector<unsigned int>> GenerateObstacles(
+            const std::vector<ObstacleField::Shape>& shapes,
+            int circle_resolution
+        )
+    {
+        if (circle_resolution < 8)
+            circle_resolution = 8;
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+
+        for (const auto& shape : shapes)
+        {
+            unsigned int first_index = vertices.size() / 6;
+            if (shape.Type == ObstacleField::ShapeType::Line)
+            {
+                // A half circle around each end, joined into a stadium
+                auto direction = shape.Points[1] - shape.Points[0];
+                double angle = direction.GetMagnitude() == 0 ? 0 : std::atan2(direction.y, direction.x);
+                double radius = shape.Thickness * 0.5;
+                int half_resolution = circle_resolution / 2;
+                for (int end = 0; end < 2; end++)
+                {
+                    for (int i = 0; i <= half_resolution; i++)
+                    {
+                        double t = angle + std::numbers::pi * (end == 0 ? 0.5 : -0.5) + std::numbers::pi * i / half_resolution;
+                        push_flat_vertex(vertices, shape.Points[end] + Math::Vec2(std::cos(t), std::sin(t)) * radius);
+                    }
+                }
+                unsigned int count = 2 * (half_resolution + 1);
+                for (unsigned int i = 1; i + 1 < count; i++)
+                {
+                    indices.push_back(first_index);
+                    indices.push_back(first_index + i);
+                    indices.push_back(first_index + i + 1);
+                }
+                continue;
+            }
+
+            // Polygon, by ear clipping
+            for (const auto& point : shape.Points)
+                push_flat_vertex(vertices, point);
+            std::vector<int> remaining;
+            for (int i = 0; i < (int)shape.Points.size(); i++)
+                remaining.push_back(i);
+            double area = 0;
+            for (std::size_t i = 0, j = shape.Points.size() - 1; i < shape.Points.size(); j = i++)
+                area += shape.Points[j].x * shape.Points[i].y - shape.Points[i].x * shape.Points[j].y;
+            if (area < 0) // Clipped counter-clockwise
+                std::reverse(remaining.begin(), remaining.end());
+            while (remaining.size() > 3)
+            {
+                int count = remaining.size();
+                int ear = -1;
+                for (int n = 0; n < count && ear < 0; n++)
+                {
+                    const auto& a = shape.Points[remaining[(n + count - 1) % count]];
+                    const auto& b = shape.Points[remaining[n]];
+                    const auto& c = shape.Points[remaining[(n + 1) % count]];
+                    if (get_cross_product(a, b, c) <= 0) // Reflex
+                        continue;
+                    bool contains = false;
+                    for (int m = 0; m < count && !contains; m++)
+                    {
+                        const auto& p = shape.Points[remaining[m]];
+                        if (m == n || m == (n + 1) % count || m == (n + count - 1) % count)
+                            continue;
+                        contains = get_cross_product(a, b, p) >= 0 && get_cross_product(b, c, p) >= 0 && get_cross_product(c, a, p) >= 0;
+                    }
+                    if (!contains)
+                        ear = n;
+                }
+                if (ear < 0) // Degenerate, fan the rest
+                    ear = 0;
+                indices.push_back(first_index + remaining[(ear + count - 1) % count]);
+                indices.push_back(first_index + remaining[ear]);
+                indices.push_back(first_index + remaining[(ear + 1) % count]);
+                remaining.erase(remaining.begin() + ear);
+            }
+            indices.push_back(first_index + remaining[0]);
+            indices.push_back(first_index + remaining[1]);
+            indices.push_back(first_index + remaining[2]);
+        }
+
+        return std::make_tuple(vertices, indices);
+    }
+
     std::tuple<std::vector<float>, std::vector<unsigned int>> GenerateSquare()
     {
         std::vector<float> vertices;
@@ -1005,6 +1108,121 @@ namespace GravityFun::BufferGeneration
     }
 
 
+    std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateUnboundedToggle(
+            int circle_resolution,
+            float z
+        )
+    {
+        if (circle_resolution < 8)
+            circle_resolution = 8;
+
+        std::vector<float> vertices0;
+        std::vector<float> vertices1;
+        std::vector<unsigned int> indices;
+
+        int next_index = 0;
+
+        generate_animated_circle(
+            next_index,
+            vertices0,
+            vertices1,
+            indices,
+            z, circle_resolution,
+            0, 0, 0.3,
+            0, 0, 0.2
+        );
+
+        // Arrows that reach further out when unbounded
+        const Math::Vec2 directions[4] = { Math::Vec2(1, 0), Math::Vec2(0, 1), Math::Vec2(-1, 0), Math::Vec2(0, -1) };
+        for (const auto& direction : directions)
+        {
+            generate_animated_arrow(
+                next_index,
+                vertices0,
+                vertices1,
+                indices,
+                z,
+                direction * 0.4, direction * 0.7,
+                0.1, Math::Vec2(0.3, 0.2),
+                direction * 0.3, direction * 1,
+                0.1, Math::Vec2(0.35, 0.3)
+            );
+        }
+
+        return std::make_tuple(vertices0, vertices1, indices);
+    }
+
+    std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateMergeToggle(
+            int circle_resolution,
+            float z
+        )
+    {
+        if (circle_resolution < 8)
+            circle_resolution = 8;
+
+        std::vector<float> vertices0;
+        std::vector<float> vertices1;
+        std::vector<unsigned int> indices;
+
+        int next_index = 0;
+
+        generate_animated_circle(
+            next_index,
+            vertices0,
+            vertices1,
+            indices,
+            z, circle_resolution,
+            -0.45, 0, 0.35,
+            0, 0, 0.6
+        );
+
+        generate_animated_circle(
+            next_index,
+            vertices0,
+            vertices1,
+            indices,
+            z, circle_resolution,
+            0.45, 0, 0.35,
+            0, 0, 0.6
+        );
+
+        return std::make_tuple(vertices0, vertices1, indices);
+    }
+
+    std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateSpeciesInteractionToggle(
+            int circle_resolution,
+            float z
+        )
+    {
+        if (circle_resolution < 8)
+            circle_resolution = 8;
+
+        std::vector<float> vertices0;
+        std::vector<float> vertices1;
+        std::vector<unsigned int> indices;
+
+        int next_index = 0;
+
+        // Alike objects in a grid, then different species chasing each other around
+        constexpr float positions0[4][2] = { { 0.5, 0.5 }, { -0.5, 0.5 }, { -0.5, -0.5 }, { 0.5, -0.5 } };
+        constexpr float positions1[4][2] = { { 0.6, 0 }, { 0, 0.6 }, { -0.6, 0 }, { 0, -0.6 } };
+        constexpr float radiuses1[4] = { 0.35, 0.2, 0.35, 0.2 };
+        for (int i = 0; i < 4; i++)
+        {
+            generate_animated_circle(
+                next_index,
+                vertices0,
+                vertices1,
+                indices,
+                z, circle_resolution,
+                positions0[i][0], positions0[i][1], 0.25,
+                positions1[i][0], positions1[i][1], radiuses1[i]
+            );
+        }
+
+        return std::make_tuple(vertices0, vertices1, indices);
+    }
+
     std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateMotionBlurToggle(
             int circle_resolution,
             float z
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ObstacleField.h"
+
 #include <tuple>
 #include <vector>
 
@@ -18,6 +20,14 @@ namespace GravityFun::BufferGeneration
     /// @return Vertices of vec3 position and vec3 normal, and triangles' indices.
     ///         Position xy is in range [-1, 1]. Normal is (0, 0, 1) in all vertices.
     std::tuple<std::vector<float>, std::vector<unsigned int>> GenerateRoundedSquare(int corner_resolution, float corner_radius_x, float corner_radius_y);
+    /// @param shapes The lines are given round ends, and the polygons must not intersect themselves.
+    /// @param circle_resolution The number of vertices around a full circle. The minimum is 8.
+    /// @return Vertices of vec3 position and vec3 normal, and triangles' indices.
+    ///         Position xy is in the shapes' coordinates and z is 0. Normal is (0, 0, 1) in all vertices.
+    std::tuple<std::vector<float>, std::vector<unsigned int>> GenerateObstacles(
+        const std::vector<ObstacleField::Shape>& shapes,
+        int circle_resolution
+    );
     /// @param z The z of vertices.
     /// @param line_offset The offset of the lines from center.
     /// @param line_thickness The thickness of the lines.
@@ -83,6 +93,36 @@ namespace GravityFun::BufferGeneration
         float z = 0.1
     );
 
+    /// @param circle_resolution The number of vertices around the circle. The minimum is 8.
+    /// @param z The z of vertices.
+    /// @return 2 vertex lists of vec3 position and vec3 normal, for 2 states, and triangles' indices.
+    ///           Normal is (0, 0, 1) in all vertices.
+    ///           Position xy is in range [-1, 1].
+    std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateUnboundedToggle(
+        int circle_resolution,
+        float z = 0.1
+    );
+
+    /// @param circle_resolution The number of vertices around the circle. The minimum is 8.
+    /// @param z The z of vertices.
+    /// @return 2 vertex lists of vec3 position and vec3 normal, for 2 states, and triangles' indices.
+    ///           Normal is (0, 0, 1) in all vertices.
+    ///           Position xy is in range [-1, 1].
+    std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateMergeToggle(
+        int circle_resolution,
+        float z = 0.1
+    );
+
+    /// @param circle_resolution The number of vertices around the circle. The minimum is 8.
+    /// @param z The z of vertices.
+    /// @return 2 vertex lists of vec3 position and vec3 normal, for 2 states, and triangles' indices.
+    ///           Normal is (0, 0, 1) in all vertices.
+    ///           Position xy is in range [-1, 1].
+    std::tuple<std::vector<float>, std::vector<float>, std::vector<unsigned int>> GenerateSpeciesInteractionToggle(
+        int circle_resolution,
+        float z = 0.1
+    );
+
     /// @brief Generates a reversed energy saving bar (energy consumption bar).
     /// @param circle_resolution The number of vertices around the circle. The minimum is 8.
     /// @param z The z of vertices.
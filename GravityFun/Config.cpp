@@ -0,0 +1,84 @@
+#include "Config.h"
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace GravityFun
+{
+    inline std::string trim(const std::string& text)
+    {
+        std::size_t begin = 0;
+        std::size_t end = text.length();
+        while (begin < end && std::isspace((unsigned char)text[begin]))
+            begin++;
+        while (end > begin && std::isspace((unsigned char)text[end - 1]))
+            end--;
+        return text.substr(begin, end - begin);
+    }
+
+    Config::Config(const std::string& filename) : Loaded(false)
+    {
+        if (!std::filesystem::exists(filename) || !std::filesystem::is_regular_file(filename))
+            return;
+        Loaded = true;
+        std::ifstream file(filename);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            auto i = line.find('=');
+            if (i == std::string::npos)
+                continue;
+            auto key = trim(line.substr(0, i));
+            if (key.empty())
+                continue;
+            Entries.emplace_back(key, trim(line.substr(i + 1)));
+        }
+    }
+
+    Config::Config(std::vector<std::pair<std::string, std::string>> entries) : Loaded(true), Entries(std::move(entries))
+    {
+    }
+
+    bool Config::IsLoaded() const
+    {
+        return Loaded;
+    }
+
+    std::vector<std::string> Config::GetValues(const std::string& key) const
+    {
+        std::vector<std::string> values;
+        for (const auto& entry : Entries)
+            if (entry.first == key)
+                values.push_back(entry.second);
+        return values;
+    }
+
+    const std::vector<std::pair<std::string, std::string>>& Config::GetEntries() const
+    {
+        return Entries;
+    }
+
+    std::optional<int> Config::GetInteger(const std::string& key) const
+    {
+        auto values = GetValues(key);
+        if (values.empty())
+            return std::nullopt;
+        const auto& value = values.back();
+        std::size_t i = value.length() > 0 && value[0] == '-' ? 1 : 0;
+        if (i == value.length())
+            return std::nullopt;
+        for (; i < value.length(); i++)
+            if (!std::isdigit((unsigned char)value[i]))
+                return std::nullopt;
+        try
+        {
+            return std::stoi(value);
+        }
+        catch (const std::out_of_range&)
+        {
+            return std::nullopt;
+        }
+    }
+}
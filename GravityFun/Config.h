@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief The "key = value" lines of a config file, where a key can have multiple values.
+    ///        The other lines are ignored.
+    class Config final
+    {
+    public:
+        /// @brief Reads the file if it exists, else the config is empty.
+        explicit Config(const std::string& filename);
+        /// @brief A loaded config of the given entries, like the ones that an input log recorded.
+        explicit Config(std::vector<std::pair<std::string, std::string>> entries);
+
+        /// @brief Whether the file was found.
+        bool IsLoaded() const;
+        /// @return The values of the key, in the order of the lines.
+        std::vector<std::string> GetValues(const std::string& key) const;
+        /// @return The last value of the key if it is an integer.
+        std::optional<int> GetInteger(const std::string& key) const;
+        /// @return The key and value of each line, in the order of the lines.
+        const std::vector<std::pair<std::string, std::string>>& GetEntries() const;
+    private:
+        bool Loaded;
+        std::vector<std::pair<std::string, std::string>> Entries;
+    };
+}
@@ -0,0 +1,282 @@
+#include "ContactGraph.h"
+
+#include "GameManager.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <thread>
+
+namespace GravityFun
+{
+    constexpr int MAX_PHASES_COUNT = ContactGraph::ITERATIONS * (ContactGraph::PARALLEL_COLORS_COUNT + 1);
+    constexpr int RESERVED_CONTACTS_COUNT = GameManager::MAX_OBJECTS_COUNT * ContactGraph::RESERVED_CONTACTS_PER_OBJECT;
+
+    ContactGraph::ContactGraph()
+        : BorderCollision(false), BorderX(1), BorderY(1), PhasesCount(0), Phase(0),
+          ClaimedChunks(new std::atomic<int>[MAX_PHASES_COUNT]),
+          SolvedChunks(new std::atomic<int>[MAX_PHASES_COUNT])
+    {
+        for (int i = 0; i < MAX_PHASES_COUNT; i++)
+        {
+            ClaimedChunks[i] = 0;
+            SolvedChunks[i] = 0;
+        }
+        Contacts.reserve(RESERVED_CONTACTS_COUNT);
+        PreviousContacts.reserve(RESERVED_CONTACTS_COUNT);
+        ContactColors.reserve(RESERVED_CONTACTS_COUNT);
+        ColoredIndexes.reserve(RESERVED_CONTACTS_COUNT);
+        ObjectColors.reserve(GameManager::MAX_OBJECTS_COUNT);
+        MergeParents.reserve(GameManager::MAX_OBJECTS_COUNT);
+        MergedObjects.reserve(GameManager::MAX_OBJECTS_COUNT);
+        ColorRanges.reserve(PARALLEL_COLORS_COUNT + 1);
+    }
+
+    void ContactGraph::SetWorkersCount(int count)
+    {
+        if ((int)WorkerContacts.size() < count)
+            WorkerContacts.resize(count);
+        // The objects are split evenly, so are their contacts, give or take
+        for (auto& worker_contacts : WorkerContacts)
+            worker_contacts.reserve(2 * RESERVED_CONTACTS_COUNT / count);
+    }
+
+    std::vector<ContactGraph::Contact>& ContactGraph::GetWorkerContacts(int number)
+    {
+        return WorkerContacts[number];
+    }
+
+    void ContactGraph::Build(std::span<FloatingObject> objects, bool border_collision, double border_x, double border_y)
+    {
+        BorderCollision = border_collision;
+        BorderX = border_x;
+        BorderY = border_y;
+
+        CollectContacts();
+        auto less = [](const Contact& a, const Contact& b) { return a.I < b.I || (a.I == b.I && a.J < b.J); };
+        std::sort(Contacts.begin(), Contacts.end(), less);
+
+        // Warm start, only the new contacts rebound
+        std::size_t previous = 0;
+        for (auto& contact : Contacts)
+        {
+            auto& object_i = objects[contact.I];
+            auto& object_j = objects[contact.J];
+            while (previous < PreviousContacts.size() && less(PreviousContacts[previous], contact))
+                previous++;
+            bool persisting = previous < PreviousContacts.size() && !less(contact, PreviousContacts[previous]);
+            bool resting = persisting && PreviousContacts[previous].TargetVelocity == 0;
+
+            contact.InverseMassI = 1 / object_i.Mass;
+            contact.InverseMassJ = 1 / object_j.Mass;
+            contact.EffectiveMass = 1 / (contact.InverseMassI + contact.InverseMassJ);
+            double normal_velocity = (object_i.Velocity - object_j.Velocity).GetDotProduct(contact.Normal);
+            contact.TargetVelocity = (!persisting && normal_velocity < -REBOUND_VELOCITY) ?
+                -normal_velocity * GameManager::COLLISION_PRESERVE : 0;
+            contact.Impulse = resting ? PreviousContacts[previous].Impulse * WARM_START_RATIO : 0;
+            object_i.Velocity += contact.Normal * (contact.Impulse * contact.InverseMassI);
+            object_j.Velocity -= contact.Normal * (contact.Impulse * contact.InverseMassJ);
+        }
+
+        // Greedy coloring, the overflow color is PARALLEL_COLORS_COUNT
+        std::array<int, PARALLEL_COLORS_COUNT + 2> color_offsets{};
+        ContactColors.resize(Contacts.size());
+        if (!Contacts.empty())
+            ObjectColors.assign(objects.size(), 0);
+        for (int n = 0; n < (int)Contacts.size(); n++)
+        {
+            auto& contact = Contacts[n];
+            std::uint32_t used = ObjectColors[contact.I] | ObjectColors[contact.J];
+            int color = std::min(std::countr_one(used), PARALLEL_COLORS_COUNT);
+            if (color < PARALLEL_COLORS_COUNT)
+            {
+                ObjectColors[contact.I] |= 1u << color;
+                ObjectColors[contact.J] |= 1u << color;
+            }
+            ContactColors[n] = color;
+            color_offsets[color + 1]++;
+        }
+        for (int color = 0; color <= PARALLEL_COLORS_COUNT; color++)
+            color_offsets[color + 1] += color_offsets[color];
+        ColorRanges.clear();
+        for (int color = 0; color <= PARALLEL_COLORS_COUNT; color++)
+        {
+            int begin = color_offsets[color];
+            int end = color_offsets[color + 1];
+            if (begin == end)
+                continue;
+            int chunk_size = color < PARALLEL_COLORS_COUNT ? CHUNK_SIZE : end - begin; // The overflow is sequential
+            ColorRanges.push_back(ColorRange{ begin, end, chunk_size, (end - begin + chunk_size - 1) / chunk_size });
+        }
+        ColoredIndexes.resize(Contacts.size());
+        for (int n = 0; n < (int)Contacts.size(); n++)
+            ColoredIndexes[color_offsets[ContactColors[n]]++] = n;
+
+        PhasesCount = ITERATIONS * (int)ColorRanges.size();
+        for (int i = 0; i < PhasesCount; i++)
+        {
+            ClaimedChunks[i].store(0, std::memory_order_relaxed);
+            SolvedChunks[i].store(0, std::memory_order_relaxed);
+        }
+        Phase.store(0, std::memory_order_release);
+    }
+
+    const std::vector<int>& ContactGraph::Merge(std::span<FloatingObject> objects, Math::Vec2 period)
+    {
+        CollectContacts();
+        // The indexes are about to change, nothing to warm-start or solve
+        PreviousContacts.clear();
+        ColorRanges.clear();
+        PhasesCount = 0;
+        Phase.store(0, std::memory_order_release);
+
+        MergedObjects.clear();
+        if (Contacts.empty())
+            return MergedObjects;
+
+        MergeParents.resize(objects.size());
+        for (int i = 0; i < (int)objects.size(); i++)
+            MergeParents[i] = i;
+        for (const auto& contact : Contacts)
+        {
+            int root_i = FindMergeRoot(contact.I);
+            int root_j = FindMergeRoot(contact.J);
+            if (root_i < root_j)
+                MergeParents[root_j] = root_i;
+            else if (root_j < root_i)
+                MergeParents[root_i] = root_j;
+        }
+        Contacts.clear();
+
+        for (int i = 0; i < (int)objects.size(); i++)
+        {
+            int root = FindMergeRoot(i);
+            if (root == i)
+                continue;
+            MergedObjects.push_back(i);
+            auto& merged = objects[root];
+            const auto& object = objects[i];
+            auto distance2d = object.Position - merged.Position;
+            if (period.x != 0) // Nearest image
+            {
+                distance2d.x -= period.x * std::nearbyint(distance2d.x / period.x);
+                distance2d.y -= period.y * std::nearbyint(distance2d.y / period.y);
+            }
+            double mass = merged.Mass + object.Mass;
+            merged.Velocity = (merged.Velocity * merged.Mass + object.Velocity * object.Mass) / mass;
+            merged.Position += distance2d * (object.Mass / mass);
+            merged.Mass = mass;
+        }
+        return MergedObjects;
+    }
+
+    void ContactGraph::Solve(std::span<FloatingObject> objects)
+    {
+        while (true)
+        {
+            int phase = Phase.load(std::memory_order_acquire);
+            if (phase >= PhasesCount)
+                return;
+            const auto& range = ColorRanges[phase % ColorRanges.size()];
+            int chunk = ClaimedChunks[phase].fetch_add(1, std::memory_order_relaxed);
+            if (chunk < range.ChunksCount)
+            {
+                int begin = range.Begin + chunk * range.ChunkSize;
+                int end = std::min(range.End, begin + range.ChunkSize);
+                for (int n = begin; n < end; n++)
+                    SolveContact(Contacts[ColoredIndexes[n]], objects);
+                SolvedChunks[phase].fetch_add(1, std::memory_order_release);
+                continue;
+            }
+            // The remaining chunks are being solved. A solver claims a chunk only from inside this loop and
+            // finishes it before waiting for anything, so this waits for no solver that has not started,
+            // however the solvers are scheduled, and yields to the claimers when they share a CPU.
+            while (SolvedChunks[phase].load(std::memory_order_acquire) < range.ChunksCount)
+                std::this_thread::yield();
+            Phase.compare_exchange_strong(phase, phase + 1, std::memory_order_acq_rel);
+        }
+    }
+
+    int ContactGraph::GetContactsCount()
+    {
+        return (int)Contacts.size();
+    }
+
+    void ContactGraph::CollectContacts()
+    {
+        std::swap(Contacts, PreviousContacts);
+        Contacts.clear();
+        std::size_t count = 0;
+        for (const auto& worker_contacts : WorkerContacts)
+            count += worker_contacts.size();
+        // Inserting into the empty list would only grow it to the exact size, reallocating in most steps of a growing pile
+        if (Contacts.capacity() < count)
+            Contacts.reserve(std::max(count, 2 * Contacts.capacity()));
+        for (auto& worker_contacts : WorkerContacts)
+        {
+            Contacts.insert(Contacts.end(), worker_contacts.begin(), worker_contacts.end());
+            worker_contacts.clear();
+        }
+    }
+
+    int ContactGraph::FindMergeRoot(int object)
+    {
+        while (MergeParents[object] != object)
+        {
+            MergeParents[object] = MergeParents[MergeParents[object]]; // Path halving
+            object = MergeParents[object];
+        }
+        return object;
+    }
+
+    void ContactGraph::SolveContact(Contact& contact, std::span<FloatingObject> objects)
+    {
+        auto& object_i = objects[contact.I];
+        auto& object_j = objects[contact.J];
+
+        double separation = (object_i.Position - object_j.Position + contact.Offset).GetDotProduct(contact.Normal) - contact.Threshold;
+        if (separation >= MARGIN) // Not touching yet
+            return;
+
+        // Velocity, with the accumulated impulse clamped to only push
+        double normal_velocity = (object_i.Velocity - object_j.Velocity).GetDotProduct(contact.Normal);
+        double impulse = std::max(0.0, contact.Impulse + contact.EffectiveMass * (contact.TargetVelocity - normal_velocity));
+        double impulse_diff = impulse - contact.Impulse;
+        contact.Impulse = impulse;
+        object_i.Velocity += contact.Normal * (impulse_diff * contact.InverseMassI);
+        object_j.Velocity -= contact.Normal * (impulse_diff * contact.InverseMassJ);
+
+        // Position, projected out of the overlap without changing the velocity
+        if (separation < 0)
+        {
+            double correction = -separation * contact.EffectiveMass;
+            object_i.Position += contact.Normal * (correction * contact.InverseMassI);
+            object_j.Position -= contact.Normal * (correction * contact.InverseMassJ);
+            if (BorderCollision)
+            {
+                ClampToBorders(object_i);
+                ClampToBorders(object_j);
+            }
+        }
+    }
+
+    void ContactGraph::ClampToBorders(FloatingObject& object)
+    {
+        // At least 0, as the merged objects can be larger than the domain
+        double local_bx = std::max(0.0, BorderX - object.Mass * GameManager::MASS_TO_RADIUS);
+        double local_by = std::max(0.0, BorderY - object.Mass * GameManager::MASS_TO_RADIUS);
+        if (std::abs(object.Position.x) > local_bx)
+        {
+            object.Position.x = object.Position.x > 0 ? local_bx : -local_bx;
+            if (object.Velocity.x * object.Position.x > 0) // Towards the border
+                object.Velocity.x = 0;
+        }
+        if (std::abs(object.Position.y) > local_by)
+        {
+            object.Position.y = object.Position.y > 0 ? local_by : -local_by;
+            if (object.Velocity.y * object.Position.y > 0)
+                object.Velocity.y = 0;
+        }
+    }
+}
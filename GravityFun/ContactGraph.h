@@ -0,0 +1,138 @@
+#pragma once
+
+#include "FloatingObject.h"
+#include "Math.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief The contacts between the objects of a physics step, colored so that the contacts of a color
+    ///        share no object and can be solved in parallel without locks.
+    ///        The physics modules detect the contacts, Build colors them and warm-starts them
+    ///        with the impulses of the previous step, then any number of ContactSolver modules share the Solve work.
+    class ContactGraph final
+    {
+    public:
+        ContactGraph();
+
+        ContactGraph(const ContactGraph&) = delete;
+        ContactGraph(ContactGraph&&) = delete;
+        ContactGraph& operator=(const ContactGraph&) = delete;
+        ContactGraph& operator=(ContactGraph&&) = delete;
+
+        /// @brief The number of solver iterations over all the contacts per step.
+        static constexpr int ITERATIONS = 8;
+        /// @brief The number of colors that are solved in parallel.
+        ///        The contacts that do not fit in them are solved sequentially after them.
+        static constexpr int PARALLEL_COLORS_COUNT = 16;
+        /// @brief The number of contacts that a solver claims at once.
+        static constexpr int CHUNK_SIZE = 32;
+        /// @brief Objects that are closer than their touching distance plus this are in contact,
+        ///        so the solver also separates the objects that other contacts push together.
+        static constexpr double MARGIN = 0.002;
+        /// @brief New contacts that approach slower than this do not rebound, which lets the piles rest.
+        static constexpr double REBOUND_VELOCITY = 0.01;
+        /// @brief The ratio of the previous step's impulse that a persisting contact starts with.
+        ///        The rebound impulses are not carried over.
+        static constexpr double WARM_START_RATIO = 0.9;
+        /// @brief The contacts per object that the lists are allocated for up front, so the piles do not grow them
+        ///        while running. Equal objects have at most 3 per object, and the lists still grow beyond.
+        static constexpr int RESERVED_CONTACTS_PER_OBJECT = 4;
+
+        struct Contact
+        {
+            /// @brief The lower object index.
+            int I;
+            /// @brief The higher object index.
+            int J;
+            /// @brief From J towards I.
+            Math::Vec2 Normal;
+            /// @brief Added to the position of I minus the position of J to get the nearest image distance.
+            Math::Vec2 Offset;
+            /// @brief The distance of I and J when they touch.
+            double Threshold;
+
+            double InverseMassI;
+            double InverseMassJ;
+            double EffectiveMass;
+            /// @brief The separating normal velocity the solver aims for, non-zero for rebounds.
+            double TargetVelocity;
+            /// @brief The accumulated normal impulse, never negative.
+            double Impulse;
+        };
+
+        /// @brief Must not be called while physics modules are running.
+        ///        Makes sure there are contact lists for the physics modules with numbers in [0, count).
+        void SetWorkersCount(int count);
+        /// @brief Each physics module only accesses its own list.
+        ///        The lists are emptied by Build.
+        std::vector<Contact>& GetWorkerContacts(int number);
+
+        /// @brief Must not be called while physics modules or solvers are running.
+        ///        Collects the detected contacts, matches them with the previous step's contacts,
+        ///        applies the warm-start impulses to the objects, and colors the contacts.
+        /// @param border_collision Whether the solver keeps the objects within the borders.
+        void Build(std::span<FloatingObject> objects, bool border_collision, double border_x, double border_y);
+        /// @brief Must not be called while physics modules or solvers are running.
+        ///        Instead of building, merges the objects of each connected group of contacts into its lowest index,
+        ///        conserving the mass and momentum, at the center of mass. Nothing is left to solve.
+        /// @param period The size of the wrapped around area, where the center of mass is found with the nearest images,
+        ///               or 0 when the area does not wrap around.
+        /// @return The ascending indexes of the objects that are merged into others and have to be removed.
+        const std::vector<int>& Merge(std::span<FloatingObject> objects, Math::Vec2 period);
+        /// @brief Thread-safe. Solves the contacts that are built for the objects, sharing the work with
+        ///        the other callers. Returns when all the iterations are done.
+        void Solve(std::span<FloatingObject> objects);
+
+        int GetContactsCount();
+    private:
+        std::vector<std::vector<Contact>> WorkerContacts;
+        /// @brief Sorted by I, then J.
+        std::vector<Contact> Contacts;
+        /// @brief The contacts of the previous step, sorted by I, then J.
+        std::vector<Contact> PreviousContacts;
+        /// @brief The colors of Contacts.
+        std::vector<int> ContactColors;
+        /// @brief Indexes of Contacts, sorted by color.
+        std::vector<int> ColoredIndexes;
+        /// @brief Bitsets of the colors that the contacts of each object have.
+        std::vector<std::uint32_t> ObjectColors;
+        /// @brief The union-find parents of the objects when merging.
+        std::vector<int> MergeParents;
+        std::vector<int> MergedObjects;
+
+        struct ColorRange
+        {
+            int Begin;
+            int End;
+            int ChunkSize;
+            int ChunksCount;
+        };
+        /// @brief The non-empty colors in the order they are solved.
+        std::vector<ColorRange> ColorRanges;
+
+        bool BorderCollision;
+        double BorderX;
+        double BorderY;
+
+        int PhasesCount;
+        /// @brief The phase that is being solved. A phase is a color in an iteration.
+        std::atomic<int> Phase;
+        /// @brief The number of chunks that are claimed in each phase.
+        std::unique_ptr<std::atomic<int>[]> ClaimedChunks;
+        /// @brief The number of chunks that are solved in each phase.
+        std::unique_ptr<std::atomic<int>[]> SolvedChunks;
+
+        /// @brief Moves the detected contacts of the workers to Contacts and keeps the previous ones.
+        void CollectContacts();
+        int FindMergeRoot(int object);
+        void SolveContact(Contact&, std::span<FloatingObject> objects);
+        /// @brief Keeps an object that a contact pushed within the borders, so the piles rest on them.
+        void ClampToBorders(FloatingObject&);
+    };
+}
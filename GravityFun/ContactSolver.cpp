@@ -0,0 +1,27 @@
+#include "ContactSolver.h"
+
+#include "Allocations.h"
+#include "PerfCounters.h"
+#include "Trace.h"
+
+#include <span>
+
+namespace GravityFun
+{
+    ContactSolver::ContactSolver(std::shared_ptr<GameManager> game_manager, int number)
+        : _GameManager(game_manager), Number(number)
+    {
+        _GameManager->GetMetrics().SetWorkersCount(number + 1);
+    }
+
+    void ContactSolver::OnRun()
+    {
+        Trace::Scope scope("ContactSolver");
+        PerfCounters::Scope counters(PerfCounters::Phase::ContactSolving);
+        Metrics::Scope metrics(_GameManager->GetMetrics(), Metrics::Pass::ContactSolving, Number);
+        Allocations::Scope allocations(Allocations::Module::ContactSolving);
+        _GameManager->GetContactGraph().Solve(
+            std::span<FloatingObject>(_GameManager->GetPhysicsPass2WriteBuffer().data(), _GameManager->GetObjectsCount())
+        );
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "GravityFun.dec.h"
+
+#include "GameManager.h"
+
+#include <memory>
+
+namespace GravityFun
+{
+    class ContactSolver final : public LoopScheduler::Module
+    {
+    public:
+        /// @brief Solves the GameManager's contact graph in the pass2 write buffer.
+        ///        Any number of contact solvers can run in parallel, they share the work.
+        /// @param number Zero-based number of this contact solver, unique among them.
+        explicit ContactSolver(std::shared_ptr<GameManager>, int number = 0);
+
+        ContactSolver(const ContactSolver&) = delete;
+        ContactSolver(ContactSolver&&) = delete;
+        ContactSolver& operator=(const ContactSolver&) = delete;
+        ContactSolver& operator=(ContactSolver&&) = delete;
+    protected:
+        virtual void OnRun() override;
+    private:
+        std::shared_ptr<GameManager> _GameManager;
+        int Number;
+    };
+}
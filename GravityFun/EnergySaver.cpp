@@ -1,9 +1,14 @@
 #include "EnergySaver.h"
 
+#include "Allocations.h"
+#include "Trace.h"
+
+#include <chrono>
+
 namespace GravityFun
 {
     EnergySaver::EnergySaver(double energy_saving_factor)
-        : IdlingTime(energy_saving_factor)
+        : IdlingTime(energy_saving_factor), IdledNanoseconds(0)
     {
         if (IdlingTime < 0)
             IdlingTime = 0;
@@ -23,9 +28,15 @@ namespace GravityFun
     {
         return IdlingTime;
     }
+    double EnergySaver::GetIdledTime()
+    {
+        return IdledNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+    }
 
     void EnergySaver::OnRun()
     {
+        Trace::Scope scope("EnergySaver");
+        Allocations::Scope allocations(Allocations::Module::EnergySaver);
         if (IdlingTime == 0)
             return;
         auto g = GetParent();
@@ -34,6 +45,10 @@ namespace GravityFun
         g = g->GetParent();
         if (g == nullptr)
             return;
+        auto start_time = std::chrono::steady_clock::now();
         Idle(IdlingTime);
+        IdledNanoseconds.store(IdledNanoseconds.load(std::memory_order_relaxed)
+            + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count(),
+            std::memory_order_relaxed);
     }
 }
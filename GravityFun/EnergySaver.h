@@ -2,6 +2,8 @@
 
 #include "GravityFun.dec.h"
 
+#include <atomic>
+
 namespace GravityFun
 {
     /// @brief A module that idles to save energy,
@@ -18,9 +20,12 @@ namespace GravityFun
 
         void SetIdlingTime(double);
         double GetIdlingTime();
+        /// @brief The total time this module has idled, in seconds.
+        double GetIdledTime();
     protected:
         virtual void OnRun() override;
     private:
         double IdlingTime;
+        std::atomic<long long> IdledNanoseconds;
     };
 }
@@ -0,0 +1,303 @@
+#include "EventDrivenCollisions.h"
+
+#include "GameManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace GravityFun
+{
+    EventDrivenCollisions::EventDrivenCollisions()
+        : Valid(false), Time(0), CarriedTime(0), BorderX(0), BorderY(0),
+          SlotsX(1), SlotsY(1), SlotSizeX(1), SlotSizeY(1)
+    {
+        Events.Reserve(MAX_QUEUED_EVENTS_PER_OBJECT * GameManager::MAX_OBJECTS_COUNT + QUEUED_EVENTS_SLACK);
+    }
+
+    void EventDrivenCollisions::Reset()
+    {
+        Valid = false;
+    }
+
+    void EventDrivenCollisions::Advance(
+            std::span<const FloatingObject> read_buffer,
+            std::span<FloatingObject> write_buffer,
+            double time_diff,
+            double border_x,
+            double border_y
+        )
+    {
+        int objects_count = (int)read_buffer.size();
+        if (!Valid || objects_count != (int)Masses.size() || border_x != BorderX || border_y != BorderY)
+        {
+            Initialize(read_buffer, border_x, border_y);
+        }
+        else if (Events.size() > MAX_QUEUED_EVENTS_PER_OBJECT * Masses.size() + QUEUED_EVENTS_SLACK) // Too many invalidated events
+        {
+            Events.Clear();
+            for (int i = 0; i < objects_count; i++)
+                MoveToTime(i);
+            for (int i = 0; i < objects_count; i++)
+                Predict(i);
+        }
+
+        double end_time = Time + CarriedTime + time_diff;
+        CarriedTime = 0;
+        long long max_events = (long long)MAX_EVENTS_PER_OBJECT * objects_count + 16;
+        long long events_count = 0;
+        while (!Events.empty() && Events.top().Time <= end_time)
+        {
+            Event event = Events.top();
+            if (EventsCounts[event.I] != event.EventsCountI
+                || (event.Type == EventType::Collision && EventsCounts[event.J] != event.EventsCountJ))
+            {
+                Events.pop();
+                continue;
+            }
+            if (++events_count > max_events)
+            {
+                // Stop at the last processed event, where every object is still valid, and keep this event for the next call
+                CarriedTime = std::min(end_time - Time, time_diff);
+                end_time = Time;
+                break;
+            }
+            Events.pop();
+            Time = std::max(Time, event.Time);
+
+            int i = event.I;
+            switch (event.Type)
+            {
+            case EventType::Collision:
+                Collide(i, event.J);
+                break;
+            case EventType::BorderX:
+                MoveToTime(i);
+                Velocities[i].x = -Velocities[i].x * GameManager::COLLISION_PRESERVE;
+                EventsCounts[i]++;
+                Predict(i);
+                break;
+            case EventType::BorderY:
+                MoveToTime(i);
+                Velocities[i].y = -Velocities[i].y * GameManager::COLLISION_PRESERVE;
+                EventsCounts[i]++;
+                Predict(i);
+                break;
+            case EventType::SlotX:
+            {
+                MoveToTime(i);
+                int slot_x = SlotsOfObjects[i] / SlotsY + (Velocities[i].x > 0 ? 1 : -1);
+                int slot_y = SlotsOfObjects[i] % SlotsY;
+                RemoveFromSlot(i);
+                AddToSlot(i, slot_x, slot_y);
+                EventsCounts[i]++;
+                Predict(i);
+                break;
+            }
+            case EventType::SlotY:
+            {
+                MoveToTime(i);
+                int slot_x = SlotsOfObjects[i] / SlotsY;
+                int slot_y = SlotsOfObjects[i] % SlotsY + (Velocities[i].y > 0 ? 1 : -1);
+                RemoveFromSlot(i);
+                AddToSlot(i, slot_x, slot_y);
+                EventsCounts[i]++;
+                Predict(i);
+                break;
+            }
+            }
+        }
+
+        Time = end_time;
+        for (int i = 0; i < objects_count; i++)
+        {
+            MoveToTime(i);
+            write_buffer[i] = read_buffer[i];
+            write_buffer[i].Mass = Masses[i];
+            write_buffer[i].Position = Positions[i];
+            write_buffer[i].Velocity = Velocities[i];
+        }
+    }
+
+    void EventDrivenCollisions::Initialize(std::span<const FloatingObject> read_buffer, double border_x, double border_y)
+    {
+        int objects_count = (int)read_buffer.size();
+        Valid = true;
+        Time = 0;
+        CarriedTime = 0;
+        BorderX = border_x;
+        BorderY = border_y;
+
+        // The slots must not be smaller than the objects to only check the neighbor slots
+        double max_diameter = 2 * GameManager::MAX_MASS * GameManager::MASS_TO_RADIUS;
+        for (const auto& item : read_buffer)
+            max_diameter = std::max(max_diameter, 2 * item.Mass * GameManager::MASS_TO_RADIUS);
+        SlotsX = std::clamp((int)(2 * border_x / max_diameter), 1, GameManager::OBJECT_MAPPING_SIZE_X);
+        SlotsY = std::clamp((int)(2 * border_y / max_diameter), 1, GameManager::OBJECT_MAPPING_SIZE_Y);
+        SlotSizeX = 2 * border_x / SlotsX;
+        SlotSizeY = 2 * border_y / SlotsY;
+
+        Masses.resize(objects_count);
+        Positions.resize(objects_count);
+        Velocities.resize(objects_count);
+        Times.assign(objects_count, 0);
+        LastCollisionTimes.assign(objects_count, -std::numeric_limits<double>::infinity());
+        EventsCounts.assign(objects_count, 0);
+        SlotsOfObjects.resize(objects_count);
+        SlotHeads.assign(SlotsX * SlotsY, -1);
+        NextInSlot.resize(objects_count);
+        PreviousInSlot.resize(objects_count);
+        Events.Clear();
+
+        for (int i = 0; i < objects_count; i++)
+        {
+            Masses[i] = read_buffer[i].Mass;
+            Positions[i] = read_buffer[i].Position;
+            Velocities[i] = read_buffer[i].Velocity;
+            AddToSlot(i, GetSlotX(Positions[i].x), GetSlotY(Positions[i].y));
+        }
+        for (int i = 0; i < objects_count; i++)
+            Predict(i);
+    }
+
+    void EventDrivenCollisions::MoveToTime(int i)
+    {
+        Positions[i] += Velocities[i] * (Time - Times[i]);
+        Times[i] = Time;
+    }
+
+    int EventDrivenCollisions::GetSlotX(double position_x)
+    {
+        return std::clamp((int)std::floor((position_x + BorderX) / SlotSizeX), 0, SlotsX - 1);
+    }
+
+    int EventDrivenCollisions::GetSlotY(double position_y)
+    {
+        return std::clamp((int)std::floor((position_y + BorderY) / SlotSizeY), 0, SlotsY - 1);
+    }
+
+    void EventDrivenCollisions::AddToSlot(int i, int slot_x, int slot_y)
+    {
+        int slot = slot_x * SlotsY + slot_y;
+        SlotsOfObjects[i] = slot;
+        PreviousInSlot[i] = -1;
+        NextInSlot[i] = SlotHeads[slot];
+        if (SlotHeads[slot] != -1)
+            PreviousInSlot[SlotHeads[slot]] = i;
+        SlotHeads[slot] = i;
+    }
+
+    void EventDrivenCollisions::RemoveFromSlot(int i)
+    {
+        if (PreviousInSlot[i] != -1)
+            NextInSlot[PreviousInSlot[i]] = NextInSlot[i];
+        else
+            SlotHeads[SlotsOfObjects[i]] = NextInSlot[i];
+        if (NextInSlot[i] != -1)
+            PreviousInSlot[NextInSlot[i]] = PreviousInSlot[i];
+    }
+
+    void EventDrivenCollisions::Predict(int i)
+    {
+        double dt = Time - Times[i];
+        Math::Vec2 position = Positions[i] + Velocities[i] * dt;
+        const Math::Vec2& velocity = Velocities[i];
+        double radius = Masses[i] * GameManager::MASS_TO_RADIUS;
+        int slot_x = SlotsOfObjects[i] / SlotsY;
+        int slot_y = SlotsOfObjects[i] % SlotsY;
+
+        // Borders
+        if (velocity.x != 0)
+        {
+            double border = velocity.x > 0 ? BorderX - radius : -BorderX + radius;
+            double t = std::max(0.0, (border - position.x) / velocity.x);
+            Events.push(Event{ Time + t, EventType::BorderX, i, -1, EventsCounts[i], 0 });
+        }
+        if (velocity.y != 0)
+        {
+            double border = velocity.y > 0 ? BorderY - radius : -BorderY + radius;
+            double t = std::max(0.0, (border - position.y) / velocity.y);
+            Events.push(Event{ Time + t, EventType::BorderY, i, -1, EventsCounts[i], 0 });
+        }
+
+        // Slot crossings
+        if ((velocity.x > 0 && slot_x < SlotsX - 1) || (velocity.x < 0 && slot_x > 0))
+        {
+            double edge = -BorderX + (slot_x + (velocity.x > 0 ? 1 : 0)) * SlotSizeX;
+            double t = std::max(0.0, (edge - position.x) / velocity.x);
+            Events.push(Event{ Time + t, EventType::SlotX, i, -1, EventsCounts[i], 0 });
+        }
+        if ((velocity.y > 0 && slot_y < SlotsY - 1) || (velocity.y < 0 && slot_y > 0))
+        {
+            double edge = -BorderY + (slot_y + (velocity.y > 0 ? 1 : 0)) * SlotSizeY;
+            double t = std::max(0.0, (edge - position.y) / velocity.y);
+            Events.push(Event{ Time + t, EventType::SlotY, i, -1, EventsCounts[i], 0 });
+        }
+
+        // Collisions with the objects in the neighbor slots
+        for (int x = std::max(0, slot_x - 1); x <= std::min(SlotsX - 1, slot_x + 1); x++)
+        {
+            for (int y = std::max(0, slot_y - 1); y <= std::min(SlotsY - 1, slot_y + 1); y++)
+            {
+                for (int j = SlotHeads[x * SlotsY + y]; j != -1; j = NextInSlot[j])
+                {
+                    if (j != i)
+                        PredictCollision(i, j);
+                }
+            }
+        }
+    }
+
+    void EventDrivenCollisions::PredictCollision(int i, int j)
+    {
+        auto position_i = Positions[i] + Velocities[i] * (Time - Times[i]);
+        auto position_j = Positions[j] + Velocities[j] * (Time - Times[j]);
+        auto distance2d = position_j - position_i;
+        auto velocity2d = Velocities[j] - Velocities[i];
+        double b = distance2d.GetDotProduct(velocity2d);
+        if (b >= 0) // Not approaching
+            return;
+        double threshold = (Masses[i] + Masses[j]) * GameManager::MASS_TO_RADIUS;
+        double distance_squared = distance2d.GetDotProduct(distance2d);
+        double velocity_squared = velocity2d.GetDotProduct(velocity2d);
+        double c = distance_squared - threshold * threshold;
+        double t;
+        if (c <= 0) // Already overlapping
+        {
+            t = 0;
+        }
+        else
+        {
+            double discriminant = b * b - velocity_squared * c;
+            if (discriminant < 0) // Missing each other
+                return;
+            t = c / (-b + std::sqrt(discriminant)); // Same as (-b - sqrt(discriminant)) / velocity_squared, but stable
+        }
+        Events.push(Event{ Time + t, EventType::Collision, i, j, EventsCounts[i], EventsCounts[j] });
+    }
+
+    void EventDrivenCollisions::Collide(int i, int j)
+    {
+        MoveToTime(i);
+        MoveToTime(j);
+        auto distance2d = Positions[j] - Positions[i];
+        double distance = distance2d.GetMagnitude();
+        auto normal = distance == 0 ? Math::Vec2(1, 0) : distance2d / distance;
+        double normal_velocity = (Velocities[j] - Velocities[i]).GetDotProduct(normal);
+        if (normal_velocity < 0)
+        {
+            double restitution =
+                (Time - LastCollisionTimes[i] < INELASTIC_COLLAPSE_TIME || Time - LastCollisionTimes[j] < INELASTIC_COLLAPSE_TIME) ?
+                    1 : GameManager::COLLISION_PRESERVE;
+            double impulse = -(1 + restitution) * normal_velocity / (1 / Masses[i] + 1 / Masses[j]);
+            Velocities[i] -= normal * (impulse / Masses[i]);
+            Velocities[j] += normal * (impulse / Masses[j]);
+        }
+        LastCollisionTimes[i] = Time;
+        LastCollisionTimes[j] = Time;
+        EventsCounts[i]++;
+        EventsCounts[j]++;
+        Predict(i);
+        Predict(j);
+    }
+}
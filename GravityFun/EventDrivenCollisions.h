@@ -0,0 +1,110 @@
+#pragma once
+
+#include "FloatingObject.h"
+#include "Math.h"
+
+#include <queue>
+#include <span>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Event-driven hard-sphere collisions for the objects when no force is applied to them.
+    ///        Predicts the object-object, border, and slot crossing events and advances the objects
+    ///        exactly from event to event, so there is no overlap or tunneling regardless of the time diff.
+    ///        The slots have the same dimensions as the GameManager's object mapper slots.
+    class EventDrivenCollisions final
+    {
+    public:
+        EventDrivenCollisions();
+
+        EventDrivenCollisions(const EventDrivenCollisions&) = delete;
+        EventDrivenCollisions(EventDrivenCollisions&&) = delete;
+        EventDrivenCollisions& operator=(const EventDrivenCollisions&) = delete;
+        EventDrivenCollisions& operator=(EventDrivenCollisions&&) = delete;
+
+        /// @brief The maximum number of events per object in a single Advance call.
+        ///        Exceeding it stops the objects at the last processed event, and the rest of the time diff
+        ///        is carried to the next call (up to one time diff, the rest is dropped).
+        static constexpr int MAX_EVENTS_PER_OBJECT = 64;
+        /// @brief The events are predicted again when more than this many per object, plus QUEUED_EVENTS_SLACK,
+        ///        are queued, as most of them are invalidated.
+        static constexpr int MAX_QUEUED_EVENTS_PER_OBJECT = 32;
+        static constexpr int QUEUED_EVENTS_SLACK = 1024;
+        /// @brief Collisions within this timespan of an object's previous collision are elastic,
+        ///        which prevents inelastic collapse (infinitely many collisions in a finite time).
+        static constexpr double INELASTIC_COLLAPSE_TIME = 1e-4;
+
+        /// @brief Has to be called when the objects have been changed by anything other than Advance.
+        void Reset();
+
+        /// @brief Moves the objects by time_diff, resolving every collision at its exact time.
+        ///        The motion is only read from the read buffer after a Reset or when the objects count or borders change,
+        ///        the other members of the objects are copied from it.
+        void Advance(
+            std::span<const FloatingObject> read_buffer,
+            std::span<FloatingObject> write_buffer,
+            double time_diff,
+            double border_x,
+            double border_y
+        );
+    private:
+        enum class EventType { Collision, BorderX, BorderY, SlotX, SlotY };
+        struct Event
+        {
+            double Time;
+            EventType Type;
+            int I;
+            int J;
+            /// @brief The events count of I when this event was predicted.
+            int EventsCountI;
+            /// @brief The events count of J when this event was predicted.
+            int EventsCountJ;
+            bool operator>(const Event& other) const { return Time > other.Time; }
+        };
+        /// @brief Keeps its storage when cleared, so predicting the events again does not allocate.
+        class EventQueue final : public std::priority_queue<Event, std::vector<Event>, std::greater<Event>>
+        {
+        public:
+            void Clear() { c.clear(); }
+            void Reserve(std::size_t count) { c.reserve(count); }
+        };
+
+        bool Valid;
+        double Time;
+        /// @brief The part of the previous time diff that was not advanced because of MAX_EVENTS_PER_OBJECT.
+        double CarriedTime;
+        double BorderX;
+        double BorderY;
+        int SlotsX;
+        int SlotsY;
+        double SlotSizeX;
+        double SlotSizeY;
+
+        std::vector<double> Masses;
+        std::vector<Math::Vec2> Positions;
+        std::vector<Math::Vec2> Velocities;
+        /// @brief The time that the position is at.
+        std::vector<double> Times;
+        std::vector<double> LastCollisionTimes;
+        /// @brief Incremented on every event of the object, which invalidates its previously predicted events.
+        std::vector<int> EventsCounts;
+        std::vector<int> SlotsOfObjects;
+        /// @brief The first object of each slot, or -1.
+        std::vector<int> SlotHeads;
+        std::vector<int> NextInSlot;
+        std::vector<int> PreviousInSlot;
+        EventQueue Events;
+
+        void Initialize(std::span<const FloatingObject> read_buffer, double border_x, double border_y);
+        void MoveToTime(int i);
+        int GetSlotX(double position_x);
+        int GetSlotY(double position_y);
+        void AddToSlot(int i, int slot_x, int slot_y);
+        void RemoveFromSlot(int i);
+        /// @brief Predicts the events of object i from the current time.
+        void Predict(int i);
+        void PredictCollision(int i, int j);
+        void Collide(int i, int j);
+    };
+}
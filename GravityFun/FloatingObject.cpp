@@ -2,8 +2,8 @@
 
 namespace GravityFun
 {
-    FloatingObject::FloatingObject(double mass, Math::Vec2 position, Math::Vec2 velocity)
-        : Mass(mass), Position(position), Velocity(velocity)
+    FloatingObject::FloatingObject(double mass, Math::Vec2 position, Math::Vec2 velocity, int id, int species)
+        : Mass(mass), Position(position), Velocity(velocity), Id(id), Species(species)
     {
     }
 }
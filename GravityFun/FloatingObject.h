@@ -9,11 +9,15 @@ namespace GravityFun
     class FloatingObject final
     {
     public:
-        FloatingObject(double mass = 1, Math::Vec2 position = Math::Vec2(), Math::Vec2 velocity = Math::Vec2());
+        FloatingObject(double mass = 1, Math::Vec2 position = Math::Vec2(), Math::Vec2 velocity = Math::Vec2(), int id = 0, int species = 0);
 
         double Mass;
         Math::Vec2 Position;
         Math::Vec2 Velocity;
+        /// @brief Identifies the object when its index changes, e.g. for its color.
+        int Id;
+        /// @brief In [0, GameManager::SPECIES_COUNT), selects the interactions in the species interaction mode.
+        int Species;
     private:
     };
 }
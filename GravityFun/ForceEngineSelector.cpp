@@ -0,0 +1,125 @@
+#include "ForceEngineSelector.h"
+
+#include <algorithm>
+
+namespace GravityFun
+{
+    ForceEngineSelector::ForceEngineSelector()
+        : Engine(GravityEngine::DirectSum), ObjectsCount(0), CheaperTime(0), Deterministic(false),
+          LastTime(std::chrono::steady_clock::now())
+    {
+        for (int i = 0; i < ENGINES_COUNT; i++)
+        {
+            WorkCosts[i] = DEFAULT_PAIR_COST;
+            WorkCostsMeasured[i] = false;
+            ObjectWorks[i] = 0;
+            MeasuredNanoseconds[i] = 0;
+            MeasuredObjects[i] = 0;
+        }
+    }
+
+    void ForceEngineSelector::ReportForcePass(GravityEngine engine, double seconds, int objects_count)
+    {
+        int i = (int)engine;
+        MeasuredNanoseconds[i].fetch_add((long long)(seconds * 1e9), std::memory_order_relaxed);
+        MeasuredObjects[i].fetch_add(objects_count, std::memory_order_relaxed);
+    }
+
+    void ForceEngineSelector::SetDeterministic(bool deterministic)
+    {
+        Deterministic = deterministic;
+    }
+
+    void ForceEngineSelector::Update(int objects_count, double clustering, int visited_slots, int slots_count)
+    {
+        auto time = std::chrono::steady_clock::now();
+        double time_diff = std::chrono::duration<double>(time - LastTime).count();
+        LastTime = time;
+
+        // Fit the costs to the measurements of the previous work estimates
+        double alpha = std::min(1.0, time_diff / MEASUREMENT_WINDOW);
+        for (int i = 0; i < ENGINES_COUNT; i++)
+        {
+            long long nanoseconds = MeasuredNanoseconds[i].exchange(0, std::memory_order_relaxed);
+            long long objects = MeasuredObjects[i].exchange(0, std::memory_order_relaxed);
+            if (objects == 0 || ObjectWorks[i] <= 0)
+                continue;
+            double cost = nanoseconds * 1e-9 / (objects * ObjectWorks[i]);
+            if (WorkCostsMeasured[i])
+            {
+                WorkCosts[i] += (cost - WorkCosts[i]) * alpha;
+            }
+            else
+            {
+                WorkCosts[i] = cost;
+                WorkCostsMeasured[i] = true;
+            }
+        }
+
+        // Estimate the work of the current scene
+        ObjectsCount = objects_count;
+        double others = std::max(0, objects_count - 1);
+        double neighbors = std::min(others, others * clustering * visited_slots / slots_count);
+        ObjectWorks[(int)GravityEngine::DirectSum] = others;
+        ObjectWorks[(int)GravityEngine::GridWalk] = neighbors + SLOT_VISIT_WEIGHT * visited_slots;
+
+        if (Deterministic)
+        {
+            int best = 0;
+            for (int i = 1; i < ENGINES_COUNT; i++)
+                if (ObjectWorks[i] < ObjectWorks[best])
+                    best = i;
+            Engine = (GravityEngine)best;
+            CheaperTime = 0;
+            return;
+        }
+
+        // Measure each engine once before comparing them, so neither is chosen by the default cost
+        if (WorkCostsMeasured[(int)Engine])
+        {
+            for (int i = 0; i < ENGINES_COUNT; i++)
+            {
+                if (!WorkCostsMeasured[i])
+                {
+                    Engine = (GravityEngine)i;
+                    CheaperTime = 0;
+                    return;
+                }
+            }
+        }
+
+        // Switch with hysteresis
+        GravityEngine best = Engine;
+        for (int i = 0; i < ENGINES_COUNT; i++)
+            if (PredictStepTime((GravityEngine)i) < PredictStepTime(best))
+                best = (GravityEngine)i;
+        if (best != Engine && PredictStepTime(best) < PredictStepTime(Engine) * SWITCH_RATIO)
+        {
+            CheaperTime += time_diff;
+            if (CheaperTime >= SWITCH_HOLD_TIME)
+            {
+#if GRAVITYFUN_DEBUG
+                Log(std::string("Gravity engine switched to ") + (best == GravityEngine::DirectSum ? "direct sum" : "grid walk")
+                    + " at " + std::to_string(objects_count) + " objects");
+#endif
+                Engine = best;
+                CheaperTime = 0;
+            }
+        }
+        else
+        {
+            CheaperTime = 0;
+        }
+    }
+
+    GravityEngine ForceEngineSelector::GetEngine()
+    {
+        return Engine;
+    }
+
+    double ForceEngineSelector::PredictStepTime(GravityEngine engine)
+    {
+        int i = (int)engine;
+        return WorkCosts[i] * ObjectWorks[i] * ObjectsCount;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "GravityFun.dec.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace GravityFun
+{
+    /// @brief The algorithms that can calculate the relative gravity forces.
+    enum class GravityEngine
+    {
+        /// @brief Visits every other object.
+        DirectSum = 0,
+        /// @brief Visits the objects in the object mapper slots in MASS_GRAVITY_RADIUS.
+        GridWalk = 1
+    };
+
+    /// @brief Chooses the gravity engine that is predicted to be the fastest for the current scene,
+    ///        using a cost model that is fitted to the measured gravity accumulation times of the engines.
+    class ForceEngineSelector final
+    {
+    public:
+        ForceEngineSelector();
+
+        ForceEngineSelector(const ForceEngineSelector&) = delete;
+        ForceEngineSelector(ForceEngineSelector&&) = delete;
+        ForceEngineSelector& operator=(const ForceEngineSelector&) = delete;
+        ForceEngineSelector& operator=(ForceEngineSelector&&) = delete;
+
+        static constexpr int ENGINES_COUNT = 2;
+        /// @brief The timespan in seconds that the measured costs are averaged over.
+        static constexpr double MEASUREMENT_WINDOW = 3;
+        /// @brief Another engine has to be predicted to take less than this ratio
+        ///        of the current engine's time to be switched to.
+        static constexpr double SWITCH_RATIO = 0.8;
+        /// @brief The timespan in seconds that another engine has to stay cheaper to be switched to.
+        static constexpr double SWITCH_HOLD_TIME = 1;
+        /// @brief The cost of visiting a mapper slot relative to the cost of an object pair.
+        static constexpr double SLOT_VISIT_WEIGHT = 0.1;
+        /// @brief The initial cost of an object pair in seconds, used before any measurement.
+        ///        Each engine is run once to be measured before the engines are compared.
+        static constexpr double DEFAULT_PAIR_COST = 1e-8;
+
+        /// @brief Thread-safe. Reports the time a physics module spent on a force pass.
+        /// @param objects_count The number of objects that the pass updated.
+        void ReportForcePass(GravityEngine, double seconds, int objects_count);
+        /// @brief Must not be called while physics modules are running.
+        ///        When deterministic, the engine with the least estimated work is chosen at each update,
+        ///        without the measured times or the hold time, so the choice only depends on the scene.
+        void SetDeterministic(bool);
+
+        /// @brief Must not be called while physics modules are running.
+        /// @param objects_count The total number of objects.
+        /// @param clustering The ratio of the mean neighbor count to what it would be for uniformly spread objects.
+        /// @param visited_slots The number of slots that a GridWalk query visits.
+        /// @param slots_count The total number of slots.
+        void Update(int objects_count, double clustering, int visited_slots, int slots_count);
+
+        GravityEngine GetEngine();
+        /// @return The predicted time of a step in seconds, summed over all physics modules.
+        double PredictStepTime(GravityEngine);
+    private:
+        GravityEngine Engine;
+        /// @brief Seconds per unit of work, averaged over MEASUREMENT_WINDOW.
+        std::array<double, ENGINES_COUNT> WorkCosts;
+        /// @brief Whether WorkCosts has been measured or is still the default.
+        std::array<bool, ENGINES_COUNT> WorkCostsMeasured;
+        /// @brief Work units per object, from the last update.
+        std::array<double, ENGINES_COUNT> ObjectWorks;
+        int ObjectsCount;
+        std::array<std::atomic<long long>, ENGINES_COUNT> MeasuredNanoseconds;
+        std::array<std::atomic<long long>, ENGINES_COUNT> MeasuredObjects;
+        double CheaperTime;
+        bool Deterministic;
+        std::chrono::steady_clock::time_point LastTime;
+    };
+}
@@ -1,49 +1,59 @@
 #include "GameManager.h"
 
 #include <algorithm>
+#include <cmath>
+#include <span>
+#include <utility>
 
-#include "Window.h"
+#include "Allocations.h"
+#include "InputSource.h"
 #include "EnergySaver.h"
+#include "MetricsServer.h"
+#include "PerfCounters.h"
+#include "Trace.h"
 
 namespace GravityFun
 {
-    GameManager::PhysicsPassNotifier::PhysicsPassNotifier(GameManager * gm, bool first_pass) : _GameManager(gm), FirstPass(first_pass) {}
+    GameManager::PhysicsPassNotifier::PhysicsPassNotifier(GameManager * gm, PhysicsPass pass) : _GameManager(gm), Pass(pass) {}
     void GameManager::PhysicsPassNotifier::OnRun()
     {
-        _GameManager->PhysicsPassNotify(FirstPass);
+        Trace::Scope scope(Pass == PhysicsPass::Pass1 ? "Pass1 notifier"
+            : Pass == PhysicsPass::Pass2 ? "Pass2 notifier" : "Contact solving notifier");
+        Metrics::Scope metrics(_GameManager->_Metrics);
+        Allocations::Scope allocations(Allocations::Module::Notifiers);
+        _GameManager->PhysicsPassNotify(Pass);
     }
 
-    GameManager::GameManager(std::shared_ptr<Window> window, std::shared_ptr<EnergySaver> energy_saver)
-        : _Window(window), _EnergySaver(energy_saver),
-          RootGroup(nullptr), PhysicsPass1(nullptr), PhysicsPass2(nullptr),
-          _PhysicsPass1Notifier(new PhysicsPassNotifier(this, true)),
-          _PhysicsPass2Notifier(new PhysicsPassNotifier(this, false)),
-          MainThreadId(std::this_thread::get_id()),
-          TimeStrictness(1), PhysicsUpdates(1), PhysicsUpdatesSoft(1),
-          ObjectsCount(DEFAULT_OBJECTS_COUNT), TimeMultiplier(DEFAULT_TIME_MULTIPLIER),
+    GameManager::GameManager(std::shared_ptr<InputSource> input_source, std::shared_ptr<EnergySaver> energy_saver,
+            std::optional<unsigned int> seed)
+        : LoopScheduler::Module(false, nullptr, nullptr, true),
+          _InputSource(input_source),
+          _PhysicsPass1Notifier(new PhysicsPassNotifier(this, PhysicsPass::Pass1)),
+          _PhysicsPass2Notifier(new PhysicsPassNotifier(this, PhysicsPass::Pass2)),
+          _ContactSolvingNotifier(new PhysicsPassNotifier(this, PhysicsPass::ContactSolving)),
+          _EnergySaver(energy_saver),
+          RootGroup(nullptr), PhysicsPass1(nullptr), PhysicsPass2(nullptr), ContactSolving(nullptr),
+          MainThreadId(std::this_thread::get_id()), Seed(seed),
+          PreviousRenderBufferIndex(0), RenderBufferIndex(1),
+          PhysicsPass1ReadBufferIndex(1), PhysicsPass2WriteBufferIndex(2),
+          TimeStrictness(1), PhysicsUpdates(1), PhysicsUpdatesSoft(1), StepsCount(0), ObjectStepsCount(0), FixedTimeDiff(0),
+          ObjectsCount(DEFAULT_OBJECTS_COUNT), RenderObjectsCount(DEFAULT_OBJECTS_COUNT),
+          ScenarioKind(Scenario::Kind::Scattered), NextObjectId(0),
+          TimeMultiplier(DEFAULT_TIME_MULTIPLIER),
           PhysicsFidelity(DEFAULT_PHYSICS_FIDELITY),
           DownGravityOn(false), RelativeGravityState(0),
           VariableMassOn(false),
-          BorderCollisionOn(true), ObjectCollisionOn(true),
-          MotionBlurOn(true),
-          BorderX(1), BorderY(1),
-          PreviousRenderBufferIndex(0), RenderBufferIndex(1),
-          PhysicsPass1ReadBufferIndex(1), PhysicsPass2WriteBufferIndex(2),
-          LoopScheduler::Module(false, nullptr, nullptr, true)
+          BorderCollisionOn(true), UnboundedOn(false), ObjectCollisionOn(true), MergeOn(false), SpeciesInteractionOn(false),
+          MotionBlurOn(true), OverlayOn(false), EventDrivenModeOn(false), EventDrivenCollisionOn(false),
+          BorderX(1), BorderY(1), AspectRatio(1),
+          _CollisionMapper(2 * MIN_MASS * MASS_TO_RADIUS),
+          _ObstacleField(OBSTACLE_FIELD_CELL_SIZE), StepTimeDiff(0)
     {
-        for (int i = 0; i < ObjectsCount; i++)
-        {
-            FloatingObject new_obj(
-                DEFAULT_MASS,
-                Math::Vec2(
-                    _Random.GetDouble(-BorderX + DEFAULT_MASS * MASS_TO_RADIUS, BorderX - DEFAULT_MASS * MASS_TO_RADIUS),
-                    _Random.GetDouble(-BorderY + DEFAULT_MASS * MASS_TO_RADIUS, BorderY - DEFAULT_MASS * MASS_TO_RADIUS)
-                )
-            );
-            for (int j = 0; j < 4; j++)
-                ObjectBuffers[j][i] = new_obj;
-        }
+        _SparseObjectMapper.Reserve(MAX_OBJECTS_COUNT);
+        AddObjects(0);
+        SetMappingBorders();
         UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex]);
+        InvalidateFarGravityCache();
 
         EnergySavingMinExec = 1 - PhysicsFidelity;
         EnergySavingMinExec = EnergySavingMinExec * EnergySavingMinExec * EnergySavingMinExec;
@@ -51,18 +61,22 @@ namespace GravityFun
 #if GRAVITYFUN_DEBUG
         PhysicsRateLastTime = std::chrono::steady_clock::now();
         PhysicsRateCounter = 0;
+        FarGravityErrorSquared = 0;
+        FarGravityExactSquared = 0;
 #endif
     }
 
     void GameManager::SetGroups(
             LoopScheduler::Group * root_group,
             LoopScheduler::Group * physics_pass1,
-            LoopScheduler::Group * physics_pass2
+            LoopScheduler::Group * physics_pass2,
+            LoopScheduler::Group * contact_solving
         )
     {
         RootGroup = root_group;
         PhysicsPass1 = physics_pass1;
         PhysicsPass2 = physics_pass2;
+        ContactSolving = contact_solving;
     }
 
     bool GameManager::CanRun()
@@ -72,9 +86,18 @@ namespace GravityFun
 
     void GameManager::OnRun()
     {
-        if (_Window->ShouldClose())
+        // Nothing else runs at the start of the iteration
+        Allocations::NextIteration();
+        Trace::Scope scope("GameManager");
+        Metrics::Scope metrics(_Metrics);
+        Allocations::Scope allocations(Allocations::Module::GameManager);
+        if (_InputSource->ShouldClose())
             GetLoop()->Stop();
-        _Window->Update();
+        _InputSource->Update();
+        auto snapshot_number = _Metrics.GetSnapshotNumber();
+        _Metrics.Update(StepsCount, ObjectsCount, _EnergySaver->GetIdledTime(), _ObjectMapper.GetOverflowsCount());
+        if (_MetricsServer != nullptr && _Metrics.GetSnapshotNumber() != snapshot_number)
+            _MetricsServer->Publish(_Metrics.GetSnapshot());
 
         auto temp_index = PreviousRenderBufferIndex;
         PreviousRenderBufferIndex = RenderBufferIndex;
@@ -83,48 +106,68 @@ namespace GravityFun
         PhysicsPass1ReadBufferIndex = RenderBufferIndex;
 
         // Toggles
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_G)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_1))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_G)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_1))
             DownGravityOn = !DownGravityOn;
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_R)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_2))
+        bool last_mass_gravity_on = IsMassGravityOn();
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_R)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_2))
         {
             RelativeGravityState += 1;
             if (RelativeGravityState > 1)
                 RelativeGravityState = -1;
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_Q)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_0))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_Q)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_0))
         {
             RelativeGravityState = 0;
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_W)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_9))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_W)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_9))
         {
             RelativeGravityState = 1;
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_E)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_8))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_E)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_8))
         {
             RelativeGravityState = -1;
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_M)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_3))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_M)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_3))
             VariableMassOn = !VariableMassOn;
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_B)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_4))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_B)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_4))
             BorderCollisionOn = !BorderCollisionOn;
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_C)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_5))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_U))
+        {
+            UnboundedOn = !UnboundedOn;
+            _CollisionMapper.SetUnbounded(UnboundedOn);
+            if (!UnboundedOn)
+                BringObjectsWithinBorders();
+            UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex]);
+        }
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_C)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_5))
             ObjectCollisionOn = !ObjectCollisionOn;
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_SLASH)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_6))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_A)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_7))
+            MergeOn = !MergeOn;
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_S))
+            SpeciesInteractionOn = !SpeciesInteractionOn;
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_SLASH)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_6))
             MotionBlurOn = !MotionBlurOn;
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_P))
+            OverlayOn = !OverlayOn;
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_V))
+            EventDrivenModeOn = !EventDrivenModeOn;
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_T) && !TraceFilename.empty())
+            Trace::WriteChromeTrace(TraceFilename);
 
         // Objects count
         int last_objects_count = ObjectsCount;
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_UP)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_UP))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_UP)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_UP))
         {
             for (int i = 0; i < ObjectsCount / 11 + 1; i++)
             {
@@ -133,8 +176,8 @@ namespace GravityFun
                     ObjectsCount = temp;
             }
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_DOWN)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_DOWN))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_DOWN)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_DOWN))
         {
             for (int i = 0; i < ObjectsCount / 11 + 1; i++)
             {
@@ -144,41 +187,18 @@ namespace GravityFun
             }
         }
 
-        // Update buffers based on objects count
-        if (last_objects_count < ObjectsCount)
-        {
-            for (int i = last_objects_count; i < ObjectsCount; i++)
-            {
-                double mass = VariableMassOn ? _Random.GetDouble(MIN_MASS, MAX_MASS) : DEFAULT_MASS;
-                FloatingObject new_obj(
-                    mass,
-                    Math::Vec2(
-                        _Random.GetDouble(-BorderX + mass * MASS_TO_RADIUS, BorderX - mass * MASS_TO_RADIUS),
-                        _Random.GetDouble(-BorderY + mass * MASS_TO_RADIUS, BorderY - mass * MASS_TO_RADIUS)
-                    )
-                );
-                for (int j = 0; j < 4; j++)
-                    ObjectBuffers[j][i] = new_obj;
-            }
-            // Only add new missing objects without clearing
-            UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex], last_objects_count);
-        }
-        else if (ObjectsCount < last_objects_count)
-        {
-            // Clear and re-write from the reduced buffer
-            UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex]);
-        }
+        UpdateObjectsCount(last_objects_count);
 
         // Time multiplier
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_LEFT)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_LEFT))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_LEFT)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_LEFT))
         {
             auto temp = TimeMultiplier * 0.5;
             if (MIN_TIME_MULTIPLIER <= temp)
                 TimeMultiplier = temp;
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_RIGHT)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_RIGHT))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_RIGHT)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_RIGHT))
         {
             auto temp = TimeMultiplier * 2;
             if (temp <= MAX_TIME_MULTIPLIER)
@@ -186,10 +206,10 @@ namespace GravityFun
         }
 
         // Energy saving factor
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_MINUS)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_MINUS)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_KP_SUBTRACT)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_KP_SUBTRACT))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_MINUS)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_MINUS)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_KP_SUBTRACT)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_KP_SUBTRACT))
         {
             auto temp = PhysicsFidelity - PHYSICS_FIDELITY_STEP;
             if (MIN_PHYSICS_FIDELITY <= temp)
@@ -203,10 +223,10 @@ namespace GravityFun
             EnergySavingMinExec = 1 - PhysicsFidelity;
             EnergySavingMinExec = EnergySavingMinExec * EnergySavingMinExec * EnergySavingMinExec;
         }
-        if (_Window->GetPressedKeys().contains(GLFW_KEY_EQUAL)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_EQUAL)
-            || _Window->GetPressedKeys().contains(GLFW_KEY_KP_ADD)
-            || _Window->GetRepeatedKeys().contains(GLFW_KEY_KP_ADD))
+        if (_InputSource->GetPressedKeys().contains(GLFW_KEY_EQUAL)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_EQUAL)
+            || _InputSource->GetPressedKeys().contains(GLFW_KEY_KP_ADD)
+            || _InputSource->GetRepeatedKeys().contains(GLFW_KEY_KP_ADD))
         {
             auto temp = PhysicsFidelity + PHYSICS_FIDELITY_STEP;
             if (temp <= MAX_PHYSICS_FIDELITY)
@@ -222,7 +242,8 @@ namespace GravityFun
         }
 
         double min_exec = EnergySavingMinExec * RootGroup->PredictLowerExecutionTime();
-        double exec = PhysicsPass1->PredictHigherExecutionTime() + PhysicsPass2->PredictHigherExecutionTime();
+        double exec = PhysicsPass1->PredictHigherExecutionTime() + PhysicsPass2->PredictHigherExecutionTime()
+            + ContactSolving->PredictHigherExecutionTime();
         if (min_exec <= exec)
         {
             _EnergySaver->SetIdlingTime(0);
@@ -234,17 +255,41 @@ namespace GravityFun
 
         // Update AspectRatio, BorderX, and BorderY
         int width, height;
-        _Window->GetSize(width, height);
-        AspectRatio = (double)width / height;
-        BorderX = AspectRatio;
-        BorderY = 1;
+        _InputSource->GetSize(width, height);
+        if (width > 0 && height > 0) // Not minimized
+        {
+            AspectRatio = (double)width / height;
+            if (BorderX != AspectRatio || BorderY != 1)
+            {
+                BorderX = AspectRatio;
+                BorderY = 1;
+                SetMappingBorders();
+                UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex]);
+            }
+        }
 
-        auto [mouse_xi, mouse_yi] = _Window->GetMousePosition();
+        auto [mouse_xi, mouse_yi] = _InputSource->GetMousePosition();
         MouseX = BorderX * (2 * (double)mouse_xi / width - 1);
         MouseY = BorderY * (-2 * (double)mouse_yi / height + 1);
-        MouseLeft = _Window->GetMouseLeftButton();
-        MouseRight = _Window->GetMouseRightButton();
-        MouseMiddle = _Window->GetMouseMiddleButton();
+        MouseLeft = _InputSource->GetMouseLeftButton();
+        MouseRight = _InputSource->GetMouseRightButton();
+        MouseMiddle = _InputSource->GetMouseMiddleButton();
+
+        if (IsMassGravityOn())
+        {
+            // The cache is outdated if it's not been used for a while
+            auto last_gravity_engine = GetGravityEngine();
+            UpdateForceEngineSelector();
+            if (!last_mass_gravity_on || last_gravity_engine != GetGravityEngine())
+                InvalidateFarGravityCache();
+        }
+
+        bool last_event_driven_collision_on = EventDrivenCollisionOn;
+        EventDrivenCollisionOn = EventDrivenModeOn && ObjectCollisionOn && BorderCollisionOn && !UnboundedOn && !MergeOn
+            && !DownGravityOn && !IsRelativeGravityOn() && !SpeciesInteractionOn && _ObstacleField.IsEmpty() && _ObjectFlow.IsEmpty()
+            && !MouseLeft && !MouseRight && !MouseMiddle;
+        if (EventDrivenCollisionOn && (!last_event_driven_collision_on || last_objects_count != ObjectsCount))
+            _EventDrivenCollisions.Reset();
 
         PhysicsUpdatesSoft += (PhysicsUpdates - PhysicsUpdatesSoft) * TIME_STRICTNESS_UPDATE_ALPHA;
         TimeStrictness = 1 / (double)PhysicsUpdatesSoft;
@@ -258,20 +303,59 @@ namespace GravityFun
             Log(std::string("Physics update rate: ") + std::to_string(PhysicsRateCounter / d));
             PhysicsRateLastTime = std::chrono::steady_clock::now();
             PhysicsRateCounter = 0;
+            if (FarGravityExactSquared != 0)
+            {
+                Log(std::string("Far gravity cache relative RMS error: ")
+                    + std::to_string(std::sqrt(FarGravityErrorSquared / FarGravityExactSquared)));
+                FarGravityErrorSquared = 0;
+                FarGravityExactSquared = 0;
+            }
         }
 #endif
     }
 
-    void GameManager::PhysicsPassNotify(bool first_pass)
+    void GameManager::PhysicsPassNotify(PhysicsPass pass)
     {
-        int next_read_buffer_index = first_pass ? PhysicsPass1WriteBufferIndex : PhysicsPass2WriteBufferIndex;
-        UpdateMappedObjectBuffer(ObjectBuffers[next_read_buffer_index]);
+        if (pass == PhysicsPass::Pass2)
+        {
+            std::span<FloatingObject> objects(ObjectBuffers[PhysicsPass2WriteBufferIndex].data(), ObjectsCount);
+            if (MergeOn)
+            {
+                const auto& merged_objects = _ContactGraph.Merge(
+                    objects,
+                    BorderCollisionOn || UnboundedOn ? Math::Vec2(0, 0) : Math::Vec2(2 * BorderX, 2 * BorderY)
+                );
+                // Descending, so the moved last object is never a merged one
+                for (auto i = merged_objects.rbegin(); i != merged_objects.rend(); i++)
+                    RemoveObject(*i);
+            }
+            else
+            {
+                Trace::Scope scope("Contact graph build");
+                _ContactGraph.Build(objects, BorderCollisionOn && !UnboundedOn, BorderX, BorderY);
+            }
+            return;
+        }
 
-        if (first_pass)
+        if (pass == PhysicsPass::Pass1)
+        {
+            if (IsContactDetectionOn())
+                UpdateCollisionMapper(ObjectBuffers[PhysicsPass1WriteBufferIndex]);
+            else if (IsFluidOn()) // Pass1 only calculated the densities
+                return;
+            else
+                UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1WriteBufferIndex]);
             return;
+        }
+
+        // Once per step, before mapping so the new objects are mapped with the rest
+        UpdateObjectFlow();
+        UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass2WriteBufferIndex]);
 
         PhysicsPass1ReadBufferIndex = PhysicsPass2WriteBufferIndex;
         PhysicsUpdates++;
+        StepsCount++;
+        ObjectStepsCount += ObjectsCount;
 
 #if GRAVITYFUN_DEBUG
         PhysicsRateCounter++;
@@ -280,14 +364,245 @@ namespace GravityFun
 
     void GameManager::UpdateMappedObjectBuffer(const std::array<FloatingObject, MAX_OBJECTS_COUNT>& object_buffer, int starting_index)
     {
+        Trace::Scope scope("Object mapper rebuild");
+        PerfCounters::Scope counters(PerfCounters::Phase::MapperRebuild);
         if (starting_index == 0)
-            _ObjectMapper.Clear();
+        {
+            if (UnboundedOn)
+                _SparseObjectMapper.Clear();
+            else
+                _ObjectMapper.Clear();
+        }
         for (int i = starting_index; i < ObjectsCount; i++)
         {
-            _ObjectMapper.AddObject(object_buffer[i].Position, i);
+            if (UnboundedOn)
+                _SparseObjectMapper.AddObject(object_buffer[i].Position, i);
+            else
+                _ObjectMapper.AddObject(object_buffer[i].Position, i);
+        }
+    }
+
+    void GameManager::UpdateCollisionMapper(const std::array<FloatingObject, MAX_OBJECTS_COUNT>& object_buffer)
+    {
+        Trace::Scope scope("Collision mapper rebuild");
+        PerfCounters::Scope counters(PerfCounters::Phase::MapperRebuild);
+        // Pass1 has reported its time diff, which the contact detection sweeps the objects by
+        _CollisionMapper.Map(std::span<const FloatingObject>(object_buffer.data(), ObjectsCount), MASS_TO_RADIUS, StepTimeDiff);
+    }
+
+    void GameManager::InvalidateFarGravityCache(int starting_index)
+    {
+        for (int i = starting_index; i < MAX_OBJECTS_COUNT; i++)
+            FarGravityCache[i].Age = -1;
+    }
+
+    void GameManager::BringObjectsWithinBorders()
+    {
+        auto& objects = ObjectBuffers[PhysicsPass1ReadBufferIndex];
+        auto& previous_objects = ObjectBuffers[PreviousRenderBufferIndex];
+        for (int i = 0; i < ObjectsCount; i++)
+        {
+            // By whole areas, like the wrap around mode would
+            Math::Vec2 offset(
+                -2 * BorderX * std::floor((objects[i].Position.x + BorderX) / (2 * BorderX)),
+                -2 * BorderY * std::floor((objects[i].Position.y + BorderY) / (2 * BorderY))
+            );
+            objects[i].Position += offset;
+            if (previous_objects[i].Id == objects[i].Id)
+                previous_objects[i].Position += offset;
+        }
+    }
+
+    void GameManager::SetMappingBorders()
+    {
+        // The slots must match the borders for the wrap around mode
+        _ObjectMapper.SetBorders(BorderX, BorderY);
+        _SparseObjectMapper.SetCellSize(2 * BorderX / OBJECT_MAPPING_SIZE_X, 2 * BorderY / OBJECT_MAPPING_SIZE_Y);
+        _CollisionMapper.SetBorders(BorderX, BorderY);
+        _ObstacleField.SetBorders(BorderX, BorderY);
+    }
+
+    void GameManager::UpdateObjectsCount(int last_objects_count)
+    {
+        if (last_objects_count < ObjectsCount)
+        {
+            AddObjects(last_objects_count);
+            // Only add new missing objects without clearing
+            UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex], last_objects_count);
+            InvalidateFarGravityCache(last_objects_count);
+        }
+        else if (ObjectsCount < last_objects_count)
+        {
+            // Clear and re-write from the reduced buffer
+            UpdateMappedObjectBuffer(ObjectBuffers[PhysicsPass1ReadBufferIndex]);
+        }
+        RenderObjectsCount = ObjectsCount;
+    }
+
+    void GameManager::AddObjects(int starting_index)
+    {
+        // Regenerating all objects restarts the sequences, so the initial state does not depend on
+        // how many times the scenario or the count was set before the run
+        if (starting_index == 0)
+        {
+            NextObjectId = 0;
+            if (Seed)
+                _Random.Seed(*Seed);
+        }
+        if (starting_index == 0 && ScenarioKind != Scenario::Kind::Scattered)
+        {
+            // The borders are only updated when running, so they are taken from the input size like there
+            int width, height;
+            _InputSource->GetSize(width, height);
+            double border_x = width > 0 && height > 0 ? (double)width / height : BorderX;
+            auto& objects = ObjectBuffers[0];
+            Scenario::Generate(ScenarioKind, std::span<FloatingObject>(objects.data(), ObjectsCount),
+                border_x, BorderY, VariableMassOn, _Random);
+            for (int j = 1; j < 4; j++)
+                std::copy(objects.begin(), objects.begin() + ObjectsCount, ObjectBuffers[j].begin());
+            NextObjectId = ObjectsCount;
+            return;
+        }
+        // Overlapping objects would start with a burst of collisions, so they are placed apart
+        double max_mass = VariableMassOn ? MAX_MASS : DEFAULT_MASS;
+        const auto& objects = ObjectBuffers[PhysicsPass1ReadBufferIndex];
+        for (int i = 0; i < starting_index; i++)
+            max_mass = std::max(max_mass, objects[i].Mass);
+        _PoissonDiskSampler.Reset(BorderX, BorderY, 2 * max_mass * MASS_TO_RADIUS);
+        for (int i = 0; i < starting_index; i++)
+            _PoissonDiskSampler.AddPoint(objects[i].Position);
+
+        for (int i = starting_index; i < ObjectsCount; i++)
+        {
+            double mass = VariableMassOn ? _Random.GetDouble(MIN_MASS, MAX_MASS) : DEFAULT_MASS;
+            Math::Vec2 position;
+            if (!_PoissonDiskSampler.Place(_Random, mass * MASS_TO_RADIUS, position))
+            {
+                // Too crowded, anywhere
+                position = Math::Vec2(
+                    _Random.GetDouble(-BorderX + mass * MASS_TO_RADIUS, BorderX - mass * MASS_TO_RADIUS),
+                    _Random.GetDouble(-BorderY + mass * MASS_TO_RADIUS, BorderY - mass * MASS_TO_RADIUS)
+                );
+            }
+            FloatingObject new_obj(
+                mass,
+                position,
+                Math::Vec2(),
+                NextObjectId,
+                NextObjectId % SPECIES_COUNT
+            );
+            NextObjectId++;
+            for (int j = 0; j < 4; j++)
+                ObjectBuffers[j][i] = new_obj;
         }
     }
 
+    void GameManager::RemoveObject(int index)
+    {
+        ObjectsCount--;
+        ObjectBuffers[PhysicsPass2WriteBufferIndex][index] = ObjectBuffers[PhysicsPass2WriteBufferIndex][ObjectsCount];
+        FarGravityCache[index] = FarGravityCache[ObjectsCount];
+    }
+
+    void GameManager::UpdateObjectFlow()
+    {
+        double time_diff = StepTimeDiff;
+        StepTimeDiff = 0;
+        if (_ObjectFlow.IsEmpty())
+            return;
+        auto& objects = ObjectBuffers[PhysicsPass2WriteBufferIndex];
+
+        // Descending, so the moved last object has already been checked
+        for (int i = ObjectsCount - 1; i >= 0; i--)
+            if (_ObjectFlow.IsInSink(objects[i].Position))
+                RemoveObject(i);
+
+        const auto& emitters = _ObjectFlow.GetEmitters();
+        const auto& counts = _ObjectFlow.Advance(time_diff);
+        for (std::size_t i = 0; i < emitters.size(); i++)
+        {
+            for (int j = 0; j < counts[i] && ObjectsCount < MAX_OBJECTS_COUNT; j++)
+            {
+                double mass = VariableMassOn ? _Random.GetDouble(MIN_MASS, MAX_MASS) : DEFAULT_MASS;
+                double radius = mass * MASS_TO_RADIUS;
+                // Spread over the step as if spawned continuously, with a jitter so they do not stack up
+                double age = time_diff * (j + 0.5) / counts[i];
+                FloatingObject new_obj(
+                    mass,
+                    emitters[i].Position + emitters[i].Velocity * age
+                        + Math::Vec2(_Random.GetDouble(-radius, radius), _Random.GetDouble(-radius, radius)),
+                    emitters[i].Velocity,
+                    NextObjectId,
+                    NextObjectId % SPECIES_COUNT
+                );
+                NextObjectId++;
+                objects[ObjectsCount] = new_obj;
+                FarGravityCache[ObjectsCount].Age = -1;
+                ObjectsCount++;
+            }
+        }
+    }
+
+    void GameManager::UpdateForceEngineSelector()
+    {
+        double clustering = 1;
+        if (ObjectsCount > 1)
+        {
+            // Pairs sharing a slot, relative to the expected count for uniformly spread objects
+            // (the slots count cancels out in the neighbors estimate, so it also fits the unbounded mode)
+            long long squared_occupancy_sum = UnboundedOn ?
+                _SparseObjectMapper.GetSquaredOccupancySum() : _ObjectMapper.GetSquaredOccupancySum();
+            clustering = (double)(squared_occupancy_sum - ObjectsCount) * FloatingObjectMapper::SLOTS_COUNT
+                / ((double)ObjectsCount * (ObjectsCount - 1));
+        }
+        _ForceEngineSelector.Update(
+            ObjectsCount,
+            clustering,
+            UnboundedOn ?
+                _SparseObjectMapper.GetVisitedSlotsCount(MASS_GRAVITY_RADIUS)
+                : _ObjectMapper.GetVisitedSlotsCount(MASS_GRAVITY_RADIUS),
+            FloatingObjectMapper::SLOTS_COUNT
+        );
+    }
+
+    void GameManager::SetObstacles(std::vector<ObstacleField::Shape> shapes)
+    {
+        _ObstacleField.SetShapes(std::move(shapes));
+    }
+
+    void GameManager::SetObjectsCount(int objects_count)
+    {
+        int last_objects_count = ObjectsCount;
+        ObjectsCount = std::clamp(objects_count, MIN_OBJECTS_COUNT, MAX_OBJECTS_COUNT);
+        UpdateObjectsCount(ScenarioKind == Scenario::Kind::Scattered ? last_objects_count : 0);
+        _EventDrivenCollisions.Reset();
+    }
+
+    void GameManager::SetScenario(Scenario::Kind kind)
+    {
+        ScenarioKind = kind;
+        UpdateObjectsCount(0);
+        _EventDrivenCollisions.Reset();
+    }
+
+    void GameManager::SetFixedTimeDiff(double time_diff)
+    {
+        FixedTimeDiff = time_diff;
+        _ForceEngineSelector.SetDeterministic(time_diff > 0);
+    }
+
+    void GameManager::SetTraceFilename(const std::string& filename)
+    {
+        TraceFilename = filename;
+        Trace::SetEnabled(!filename.empty());
+    }
+
+    void GameManager::SetObjectFlow(std::vector<ObjectFlow::Emitter> emitters, std::vector<ObjectFlow::Sink> sinks)
+    {
+        _ObjectFlow.SetEmitters(std::move(emitters));
+        _ObjectFlow.SetSinks(std::move(sinks));
+    }
+
     std::shared_ptr<GameManager::PhysicsPassNotifier> GameManager::GetPhysicsPass1Notifier()
     {
         return _PhysicsPass1Notifier;
@@ -298,6 +613,11 @@ namespace GravityFun
         return _PhysicsPass2Notifier;
     }
 
+    std::shared_ptr<GameManager::PhysicsPassNotifier> GameManager::GetContactSolvingNotifier()
+    {
+        return _ContactSolvingNotifier;
+    }
+
     const std::array<FloatingObject, GameManager::MAX_OBJECTS_COUNT>& GameManager::GetPreviousRenderBuffer()
     {
         return ObjectBuffers[PreviousRenderBufferIndex];
@@ -326,16 +646,101 @@ namespace GravityFun
     {
         return _ObjectMapper;
     }
+    const SparseObjectMapper& GameManager::GetSparseObjectMapper()
+    {
+        return _SparseObjectMapper;
+    }
+    const GameManager::FloatingObjectCollisionMapper& GameManager::GetCollisionMapper()
+    {
+        return _CollisionMapper;
+    }
+
+    int GameManager::GetRenderObjectsCount()
+    {
+        return RenderObjectsCount;
+    }
+
+    const ObstacleField& GameManager::GetObstacleField()
+    {
+        return _ObstacleField;
+    }
+    const ObjectFlow& GameManager::GetObjectFlow()
+    {
+        return _ObjectFlow;
+    }
+    Metrics& GameManager::GetMetrics()
+    {
+        return _Metrics;
+    }
+    void GameManager::SetMetricsServer(std::shared_ptr<MetricsServer> server)
+    {
+        _MetricsServer = server;
+    }
+    void GameManager::ReportTimeDiff(double time_diff)
+    {
+        StepTimeDiff += time_diff;
+    }
+    std::array<double, GameManager::MAX_OBJECTS_COUNT>& GameManager::GetFluidDensities()
+    {
+        return FluidDensities;
+    }
+    std::array<GameManager::FarGravity, GameManager::MAX_OBJECTS_COUNT>& GameManager::GetFarGravityCache()
+    {
+        return FarGravityCache;
+    }
+#if GRAVITYFUN_DEBUG
+    void GameManager::ReportFarGravityError(double error_squared, double exact_squared)
+    {
+        std::lock_guard<std::mutex> guard(FarGravityErrorMutex);
+        FarGravityErrorSquared += error_squared;
+        FarGravityExactSquared += exact_squared;
+    }
+#endif
+
+    ContactGraph& GameManager::GetContactGraph()
+    {
+        return _ContactGraph;
+    }
+
+    EventDrivenCollisions& GameManager::GetEventDrivenCollisions()
+    {
+        return _EventDrivenCollisions;
+    }
+
+    ForceEngineSelector& GameManager::GetForceEngineSelector()
+    {
+        return _ForceEngineSelector;
+    }
+    GravityEngine GameManager::GetGravityEngine()
+    {
+        return _ForceEngineSelector.GetEngine();
+    }
 
     double GameManager::GetTimeStrictness()
     {
         return TimeStrictness;
     }
+    double GameManager::GetFixedTimeDiff()
+    {
+        return FixedTimeDiff;
+    }
+    long long GameManager::GetStepsCount()
+    {
+        return StepsCount;
+    }
+    long long GameManager::GetObjectStepsCount()
+    {
+        return ObjectStepsCount;
+    }
 
     int GameManager::GetObjectsCount()
     {
         return ObjectsCount;
     }
+    Scenario::Kind GameManager::GetScenario()
+    {
+        return ScenarioKind;
+    }
     double GameManager::GetTimeMultiplier()
     {
         return TimeMultiplier;
@@ -352,6 +757,10 @@ namespace GravityFun
     {
         return RelativeGravityState != 0;
     }
+    bool GameManager::IsMassGravityOn()
+    {
+        return RelativeGravityState == 1 && !SpeciesInteractionOn;
+    }
     double GameManager::GetRelativeGravityScale()
     {
         return (double)RelativeGravityState;
@@ -364,14 +773,42 @@ namespace GravityFun
     {
         return BorderCollisionOn;
     }
+    bool GameManager::IsUnboundedOn()
+    {
+        return UnboundedOn;
+    }
     bool GameManager::IsObjectCollisionOn()
     {
         return ObjectCollisionOn;
     }
+    bool GameManager::IsMergeOn()
+    {
+        return MergeOn;
+    }
+    bool GameManager::IsSpeciesInteractionOn()
+    {
+        return SpeciesInteractionOn;
+    }
     bool GameManager::IsMotionBlurOn()
     {
         return MotionBlurOn;
     }
+    bool GameManager::IsOverlayOn()
+    {
+        return OverlayOn;
+    }
+    bool GameManager::IsEventDrivenCollisionOn()
+    {
+        return EventDrivenCollisionOn;
+    }
+    bool GameManager::IsFluidOn()
+    {
+        return RelativeGravityState == -1 && !SpeciesInteractionOn;
+    }
+    bool GameManager::IsContactDetectionOn()
+    {
+        return !EventDrivenCollisionOn && !IsFluidOn() && (ObjectCollisionOn || MergeOn);
+    }
     double GameManager::GetBorderX()
     {
         return BorderX;
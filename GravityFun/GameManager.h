@@ -3,13 +3,27 @@
 #include "GravityFun.dec.h"
 
 #include "Random.h"
+#include "ContactGraph.h"
+#include "EventDrivenCollisions.h"
 #include "FloatingObject.h"
+#include "ForceEngineSelector.h"
+#include "Metrics.h"
+#include "MultiLevelObjectMapper.h"
+#include "ObjectFlow.h"
 #include "ObjectMapper.h"
+#include "ObstacleField.h"
+#include "PoissonDiskSampler.h"
+#include "Scenario.h"
+#include "SparseObjectMapper.h"
 
 #include <array>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace GravityFun
 {
@@ -17,19 +31,24 @@ namespace GravityFun
     class GameManager final : public LoopScheduler::Module
     {
     public:
+        /// @brief The parts of a physics step that a PhysicsPassNotifier follows.
+        enum class PhysicsPass { Pass1, Pass2, ContactSolving };
+
         class PhysicsPassNotifier final : public LoopScheduler::Module
         {
             friend GameManager;
         protected:
             virtual void OnRun() override;
         private:
-            PhysicsPassNotifier(GameManager*, bool first_pass);
+            PhysicsPassNotifier(GameManager*, PhysicsPass);
             GameManager * _GameManager;
-            bool FirstPass;
+            PhysicsPass Pass;
         };
         friend PhysicsPassNotifier;
 
-        explicit GameManager(std::shared_ptr<Window>, std::shared_ptr<EnergySaver>);
+        /// @param seed The seed of the random object placement, random by default.
+        explicit GameManager(std::shared_ptr<InputSource>, std::shared_ptr<EnergySaver>,
+            std::optional<unsigned int> seed = std::nullopt);
 
         /// @brief MUST be called before running.
         ///        The owner must take care of the group lifetimes
@@ -37,7 +56,8 @@ namespace GravityFun
         void SetGroups(
             LoopScheduler::Group * root_group,
             LoopScheduler::Group * physics_pass1,
-            LoopScheduler::Group * physics_pass2
+            LoopScheduler::Group * physics_pass2,
+            LoopScheduler::Group * contact_solving
         );
 
         GameManager(const GameManager&) = delete;
@@ -45,10 +65,31 @@ namespace GravityFun
         GameManager& operator=(const GameManager&) = delete;
         GameManager& operator=(GameManager&&) = delete;
 
+        /// @brief MUST be called before running if there are any obstacles.
+        void SetObstacles(std::vector<ObstacleField::Shape>);
+        /// @brief MUST be called before running if there are any emitters or sinks.
+        void SetObjectFlow(std::vector<ObjectFlow::Emitter>, std::vector<ObjectFlow::Sink>);
+        /// @brief Must not be called while running. Clamped to [MIN_OBJECTS_COUNT, MAX_OBJECTS_COUNT].
+        ///        Regenerates all the objects unless the scenario is Scenario::Kind::Scattered.
+        void SetObjectsCount(int);
+        /// @brief Must not be called while running. Regenerates the objects in the initial conditions of the scenario,
+        ///        within the borders of the input size.
+        void SetScenario(Scenario::Kind);
+        /// @brief Must not be called while running.
+        ///        Makes every physics pass move the objects by this time diff instead of the real time since the last one,
+        ///        which makes the simulated time independent of how fast it runs. 0 for the real time.
+        ///        A fixed time diff also makes the gravity engine choice deterministic,
+        ///        so the runs with the same seed and input are identical.
+        void SetFixedTimeDiff(double);
+        /// @brief Where the T key writes the module trace to, which enables tracing. Empty by default, for no tracing.
+        void SetTraceFilename(const std::string&);
+
         /// @brief This module has to be added after the first physics pass.
         std::shared_ptr<PhysicsPassNotifier> GetPhysicsPass1Notifier();
-        /// @brief This module has to be added after the second physics pass.
+        /// @brief This module has to be added after the second physics pass, before the contact solvers.
         std::shared_ptr<PhysicsPassNotifier> GetPhysicsPass2Notifier();
+        /// @brief This module has to be added after the contact solvers.
+        std::shared_ptr<PhysicsPassNotifier> GetContactSolvingNotifier();
 
         static constexpr int DEFAULT_OBJECTS_COUNT = 10;
         static constexpr int MIN_OBJECTS_COUNT = 0;
@@ -69,7 +110,12 @@ namespace GravityFun
         static constexpr double MIN_PHYSICS_FIDELITY = 0;
         static constexpr double MAX_PHYSICS_FIDELITY = 1;
 
-        typedef ObjectMapper<OBJECT_MAPPING_SIZE_X, OBJECT_MAPPING_SIZE_Y, 4, 2, OBJECT_MAPPING_CELL_CAPACITY> FloatingObjectMapper;
+        /// @brief The number of collision mapping levels, where each level has cells twice the size of the previous one.
+        static constexpr int COLLISION_MAPPING_LEVELS_COUNT = 10;
+        static constexpr int COLLISION_MAPPING_BUCKETS_COUNT = 2048;
+
+        typedef ObjectMapper<OBJECT_MAPPING_SIZE_X, OBJECT_MAPPING_SIZE_Y, OBJECT_MAPPING_CELL_CAPACITY> FloatingObjectMapper;
+        typedef MultiLevelObjectMapper<COLLISION_MAPPING_LEVELS_COUNT, COLLISION_MAPPING_BUCKETS_COUNT> FloatingObjectCollisionMapper;
 
         const std::array<FloatingObject, MAX_OBJECTS_COUNT>& GetPreviousRenderBuffer();
         const std::array<FloatingObject, MAX_OBJECTS_COUNT>& GetRenderBuffer();
@@ -78,9 +124,68 @@ namespace GravityFun
         const std::array<FloatingObject, MAX_OBJECTS_COUNT>& GetPhysicsPass2ReadBuffer();
         std::array<FloatingObject, MAX_OBJECTS_COUNT>& GetPhysicsPass2WriteBuffer();
 
+        /// @brief The objects count of the render buffer, which can differ from GetObjectsCount()
+        ///        as objects can be merged during the physics passes.
+        int GetRenderObjectsCount();
+
+        /// @brief Not updated when IsUnboundedOn() returns true, see GetSparseObjectMapper().
         const FloatingObjectMapper& GetObjectMapper();
+        /// @brief Updated instead of GetObjectMapper() when IsUnboundedOn() returns true, with the same cells.
+        const SparseObjectMapper& GetSparseObjectMapper();
+        /// @brief Maps the pass2 read buffer when the pass2 physics modules detect contacts,
+        ///        in which case GetObjectMapper() is not updated for pass2.
+        ///        Each object is mapped with its radius plus its displacement in the pass1 time diff.
+        const FloatingObjectCollisionMapper& GetCollisionMapper();
 
-        /// @brief Used for physics.
+        /// @brief The static obstacles that the objects bounce off, sampled for the current borders.
+        const ObstacleField& GetObstacleField();
+        /// @brief The emitters and sinks, which spawn and absorb objects once per physics step.
+        const ObjectFlow& GetObjectFlow();
+        /// @brief Aggregated at the start of each run of this module.
+        Metrics& GetMetrics();
+        /// @brief Must not be called while running. The server is given each new metrics snapshot. Can be nullptr.
+        void SetMetricsServer(std::shared_ptr<MetricsServer>);
+        /// @brief Only called by one physics module of each pass, with the time diff that it moves the objects by.
+        ///        The emitters spawn the objects for the sum of the time diffs of a step.
+        void ReportTimeDiff(double time_diff);
+
+        /// @brief The cached far part of the relative gravity of an object.
+        struct FarGravity
+        {
+            /// @brief Without the relative gravity scale.
+            Math::Vec2 Acceleration;
+            /// @brief The object position when the acceleration was calculated.
+            Math::Vec2 Position;
+            /// @brief The number of force passes since the calculation. Negative when invalid.
+            int Age;
+        };
+        /// @brief Each physics module only accesses the objects it updates.
+        std::array<FarGravity, MAX_OBJECTS_COUNT>& GetFarGravityCache();
+#if GRAVITYFUN_DEBUG
+        /// @brief Thread-safe. Used to log the far gravity cache accuracy.
+        /// @param error_squared The squared magnitude of the cached minus the exact accelerations.
+        /// @param exact_squared The squared magnitude of the exact accelerations.
+        void ReportFarGravityError(double error_squared, double exact_squared);
+#endif
+
+        /// @brief The pass2 physics modules detect the contacts in object collision mode,
+        ///        and the contact solvers solve them.
+        ContactGraph& GetContactGraph();
+
+        /// @brief The fluid densities of the objects, calculated by the pass1 physics modules
+        ///        for the pass2 ones when IsFluidOn() returns true.
+        ///        Each physics module only writes the densities of the objects it updates.
+        std::array<double, MAX_OBJECTS_COUNT>& GetFluidDensities();
+
+        /// @brief Used by the first pass1 physics module when IsEventDrivenCollisionOn() returns true.
+        EventDrivenCollisions& GetEventDrivenCollisions();
+
+        /// @brief The physics modules report their force pass times to it.
+        ForceEngineSelector& GetForceEngineSelector();
+        /// @brief The engine to calculate the relative gravity with.
+        GravityEngine GetGravityEngine();
+
+        /// @brief Used for physics. The maximum number of contacts that are detected for an object with the higher indexes.
         static constexpr int MAX_COLLISION_COUNT = 24;
         /// @brief Used for physics. See also: COLLISION_PRESERVE
         static constexpr double COLLISION_LOSS = 0.2;
@@ -91,7 +196,56 @@ namespace GravityFun
         /// @brief Used for physics.
         static constexpr double MASS_GRAVITY_ACCELERATION = 0.02;
         /// @brief Used for physics. The forces outside the radius must be negligible.
+        ///        In the wrap around mode, it's clamped to half the smaller period, so one image of an object is in range.
         static constexpr double MASS_GRAVITY_RADIUS = 0.6;
+        /// @brief Used for physics. The relative gravity is softened within about this distance
+        ///        to bound the acceleration of overlapping objects (see GRAVITYFUN_GRAVITY_SOFTENING).
+        static constexpr double GRAVITY_SOFTENING_LENGTH = 0.01;
+        /// @brief Used for physics. The relative gravity within this radius is calculated every step,
+        ///        the rest up to MASS_GRAVITY_RADIUS is cached per object and refreshed less often.
+        static constexpr double NEAR_GRAVITY_RADIUS = 0.2;
+        /// @brief Used for physics. The far gravity of an object is refreshed at least every this many force passes.
+        static constexpr int FAR_GRAVITY_REFRESH_STEPS = 4;
+        /// @brief Used for physics. The far gravity of an object is refreshed when it moves further than this.
+        static constexpr double FAR_GRAVITY_DRIFT_TOLERANCE = 0.02;
+        /// @brief Used for physics. The radius of the fluid kernels, where the neighbors of an object are.
+        static constexpr double FLUID_SMOOTHING_LENGTH = 0.05;
+        /// @brief Used for physics. The fluid only pushes where it is denser than this.
+        static constexpr double FLUID_REST_DENSITY = 800;
+        /// @brief Used for physics. The fluid pressure per density above the rest density.
+        static constexpr double FLUID_STIFFNESS = 30;
+        /// @brief Used for physics.
+        static constexpr double FLUID_VISCOSITY = 1;
+        /// @brief Used for physics. The fluid acceleration is limited so that it moves an object
+        ///        at most this ratio of FLUID_SMOOTHING_LENGTH in a step, which keeps long steps stable.
+        static constexpr double FLUID_MAX_STEP_DISPLACEMENT = 0.25;
+        /// @brief The number of species that the objects are evenly spread over.
+        static constexpr int SPECIES_COUNT = 4;
+        /// @brief Used for physics. How much the objects of a species (row) are pulled (positive) or pushed (negative)
+        ///        by the objects of another species (column) in the species interaction mode.
+        ///        Flat, so the pair lookups are from one small table.
+        static constexpr std::array<double, SPECIES_COUNT * SPECIES_COUNT> SPECIES_INTERACTION_COEFFICIENTS = {
+            0.8, -0.4, 0.3, 0,
+            0.5, 0.6, -0.3, 0.2,
+            -0.3, 0.4, 0.5, -0.5,
+            0.2, -0.2, 0.6, 0.3,
+        };
+        /// @brief Used for physics. The interaction radiuses of the species pairs, laid out like the coefficients.
+        static constexpr std::array<double, SPECIES_COUNT * SPECIES_COUNT> SPECIES_INTERACTION_RADIUSES = {
+            0.15, 0.15, 0.2, 0.15,
+            0.15, 0.15, 0.15, 0.2,
+            0.2, 0.15, 0.15, 0.15,
+            0.15, 0.2, 0.15, 0.15,
+        };
+        /// @brief Used for physics. Within this ratio of the interaction radius, all the species push each other.
+        static constexpr double SPECIES_REPULSION_RATIO = 0.3;
+        /// @brief Used for physics. The acceleration of a coefficient of 1, per interaction radius.
+        static constexpr double SPECIES_INTERACTION_ACCELERATION = 3;
+        /// @brief Used for physics. The rate at which the velocities decay in the species interaction mode,
+        ///        which keeps the chasing species from speeding up.
+        static constexpr double SPECIES_FRICTION = 5;
+        /// @brief Used for physics. The cell size of the obstacles' signed distance field.
+        static constexpr double OBSTACLE_FIELD_CELL_SIZE = 0.01;
         /// @brief Used for physics.
         static constexpr double MOUSE_GRAVITY_ACCELERATION = 0.1;
         /// @brief Used for physics.
@@ -109,19 +263,49 @@ namespace GravityFun
         /// @brief Used for physics.
         ///        Represents how much the time diff is close to the actual time diff.
         double GetTimeStrictness();
+        /// @brief 0 when the physics passes use the real time.
+        double GetFixedTimeDiff();
+        /// @brief The number of completed physics steps.
+        long long GetStepsCount();
+        /// @brief The sum of the objects count over the completed physics steps.
+        long long GetObjectStepsCount();
 
         int GetObjectsCount();
+        Scenario::Kind GetScenario();
         double GetTimeMultiplier();
         /// @return In range [0, 1]
         double GetPhysicsFidelity();
         bool IsDownGravityOn();
         bool IsRelativeGravityOn();
+        /// @brief Whether the objects pull each other with the relative gravity calculated by GetGravityEngine(),
+        ///        which is the case when the relative gravity scale is 1 and species interaction is off.
+        bool IsMassGravityOn();
         /// @brief -1 when objects push each other, 0 when none, 1 when they pull.
         double GetRelativeGravityScale();
         bool IsVariableMassOn();
         bool IsBorderCollisionOn();
+        /// @brief Whether the objects move freely beyond the borders, which are ignored.
+        bool IsUnboundedOn();
         bool IsObjectCollisionOn();
+        /// @brief Whether the objects that collide are merged into one.
+        bool IsMergeOn();
+        /// @brief Whether the species interactions replace the relative force mode.
+        bool IsSpeciesInteractionOn();
         bool IsMotionBlurOn();
+        /// @brief Whether the Renderer draws the performance metrics.
+        bool IsOverlayOn();
+        /// @brief Whether the objects are only moved by EventDrivenCollisions,
+        ///        which is the case when the event-driven mode is toggled on (V),
+        ///        object and border collisions are on, the world is bounded,
+        ///        no force is applied, and there are no obstacles, emitters, or sinks.
+        ///        Else the objects move by the time-stepped physics, as without the mode.
+        bool IsEventDrivenCollisionOn();
+        /// @brief Whether the objects push each other as a fluid (SPH) instead of the relative gravity,
+        ///        which is the case when the relative gravity scale is -1 and species interaction is off.
+        ///        The fluid pressure replaces the object collisions.
+        bool IsFluidOn();
+        /// @brief Whether the pass2 physics modules detect contacts to be solved or merged.
+        bool IsContactDetectionOn();
         double GetBorderX();
         double GetBorderY();
         /// @brief Width / Height
@@ -135,16 +319,20 @@ namespace GravityFun
         virtual void OnRun() override;
         virtual bool CanRun() override;
     private:
-        std::shared_ptr<Window> _Window;
+        std::shared_ptr<InputSource> _InputSource;
         std::shared_ptr<PhysicsPassNotifier> _PhysicsPass1Notifier;
         std::shared_ptr<PhysicsPassNotifier> _PhysicsPass2Notifier;
+        std::shared_ptr<PhysicsPassNotifier> _ContactSolvingNotifier;
         std::shared_ptr<EnergySaver> _EnergySaver;
         LoopScheduler::Group * RootGroup;
         LoopScheduler::Group * PhysicsPass1;
         LoopScheduler::Group * PhysicsPass2;
+        LoopScheduler::Group * ContactSolving;
 
         std::thread::id MainThreadId;
 
+        /// @brief The seed that _Random restarts from whenever all objects are regenerated, if given.
+        std::optional<unsigned int> Seed;
         Random _Random;
 
         /// @brief [0, 2]
@@ -162,8 +350,16 @@ namespace GravityFun
         double TimeStrictness;
         int PhysicsUpdates;
         double PhysicsUpdatesSoft;
+        long long StepsCount;
+        long long ObjectStepsCount;
+        double FixedTimeDiff;
 
         int ObjectsCount;
+        int RenderObjectsCount;
+        Scenario::Kind ScenarioKind;
+        std::string TraceFilename;
+        /// @brief The Id of the next new object.
+        int NextObjectId;
         double TimeMultiplier;
         double PhysicsFidelity;
         /// @brief Minimum allowed physics execution timespan
@@ -172,8 +368,15 @@ namespace GravityFun
         int RelativeGravityState;
         bool VariableMassOn;
         bool BorderCollisionOn;
+        bool UnboundedOn;
         bool ObjectCollisionOn;
+        bool MergeOn;
+        bool SpeciesInteractionOn;
         bool MotionBlurOn;
+        bool OverlayOn;
+        /// @brief Toggled by the user, EventDrivenCollisionOn also needs the other conditions.
+        bool EventDrivenModeOn;
+        bool EventDrivenCollisionOn;
         double BorderX;
         double BorderY;
         /// @brief Width / Height
@@ -186,13 +389,48 @@ namespace GravityFun
 
         std::array<FloatingObject, MAX_OBJECTS_COUNT> ObjectBuffers[4];
         FloatingObjectMapper _ObjectMapper;
+        SparseObjectMapper _SparseObjectMapper;
+        FloatingObjectCollisionMapper _CollisionMapper;
+        ObstacleField _ObstacleField;
+        ObjectFlow _ObjectFlow;
+        Metrics _Metrics;
+        std::shared_ptr<MetricsServer> _MetricsServer;
+        PoissonDiskSampler _PoissonDiskSampler;
+        /// @brief The time diffs reported in the current physics step.
+        double StepTimeDiff;
+        ForceEngineSelector _ForceEngineSelector;
+        ContactGraph _ContactGraph;
+        EventDrivenCollisions _EventDrivenCollisions;
+        std::array<FarGravity, MAX_OBJECTS_COUNT> FarGravityCache;
+        std::array<double, MAX_OBJECTS_COUNT> FluidDensities;
 
-        void PhysicsPassNotify(bool first_pass);
+        void PhysicsPassNotify(PhysicsPass);
         void UpdateMappedObjectBuffer(const std::array<FloatingObject, MAX_OBJECTS_COUNT>& object_buffer, int starting_index = 0);
+        void UpdateCollisionMapper(const std::array<FloatingObject, MAX_OBJECTS_COUNT>& object_buffer);
+        void UpdateForceEngineSelector();
+        void InvalidateFarGravityCache(int starting_index = 0);
+        /// @brief Adds or removes the objects after the objects count changed.
+        void UpdateObjectsCount(int last_objects_count);
+        /// @brief Moves the objects of the pass1 read buffer that are beyond the borders by whole areas to within them,
+        ///        with their previous render positions.
+        void BringObjectsWithinBorders();
+        void SetMappingBorders();
+        /// @brief Adds new objects from the starting index up to the objects count to all the buffers,
+        ///        apart from each other and from the objects of the pass1 read buffer before the starting index.
+        ///        From 0, they are generated in the scenario.
+        void AddObjects(int starting_index);
+        /// @brief Removes an object from the pass2 write buffer by moving the last object to its index.
+        void RemoveObject(int index);
+        /// @brief Absorbs the objects of the pass2 write buffer that are in the sinks,
+        ///        and adds the objects that the emitters spawn to it.
+        void UpdateObjectFlow();
 
 #if GRAVITYFUN_DEBUG
         std::chrono::steady_clock::time_point PhysicsRateLastTime;
         int PhysicsRateCounter;
+        std::mutex FarGravityErrorMutex;
+        double FarGravityErrorSquared;
+        double FarGravityExactSquared;
 #endif
     };
 }
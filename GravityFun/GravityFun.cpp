@@ -1,65 +1,156 @@
 #include "GravityFun.h"
 
-#include <filesystem>
-#include <fstream>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
 
-int main()
+constexpr const char * USAGE =
+    "Options: --record FILE (the input log to write), --replay FILE (the input log to run),\n"
+    "         --time-diff SECONDS (the fixed time diff of the physics passes, 0 for the real time by default),\n"
+    "         --seed N, --trace FILE (where the module trace is written on T and at the end),\n"
+    "         --counters (reports the hardware counters of each phase per object per step at the end),\n"
+    "         --metrics-port N (serves the Prometheus metrics on http://127.0.0.1:N/metrics),\n"
+    "         --check-allocations WARMUP (fails if a module allocates after WARMUP frames), --help\n";
+
+int main(int argc, char * argv[])
 {
+    std::string record_filename;
+    std::string replay_filename;
+    std::string trace_filename;
+    bool counters = false;
+    std::optional<int> metrics_port;
+    double time_diff = 0;
+    std::optional<unsigned int> seed;
+    std::optional<long long> allocations_warmup;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        // The flags
+        if (option == "--help")
+        {
+            std::cout << USAGE;
+            return 0;
+        }
+        if (option == "--counters")
+        {
+            counters = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            std::cout << "Missing the value of " << option << '\n';
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--record")
+            record_filename = value;
+        else if (option == "--replay")
+            replay_filename = value;
+        else if (option == "--trace")
+            trace_filename = value;
+        else if (option == "--metrics-port")
+            metrics_port = std::atoi(value.c_str());
+        else if (option == "--time-diff")
+            time_diff = std::max(0.0, std::atof(value.c_str()));
+        else if (option == "--seed")
+            seed = (unsigned int)std::atoll(value.c_str());
+        else if (option == "--check-allocations")
+            allocations_warmup = std::max(0LL, std::atoll(value.c_str()));
+        else
+        {
+            std::cout << "Unknown option: " << option << '\n' << USAGE;
+            return 1;
+        }
+    }
+
     std::cout << "Powered by:\n";
     std::cout << GravityFun::Info::DEPENDENCIES << '\n';
     std::cout << GravityFun::Info::CREATOR << " - " << GravityFun::Info::NAME << " v" << GravityFun::Info::VERSION << "\n";
     std::cout << GravityFun::Info::LICENSE << '\n';
     std::cout << GravityFun::Info::DESCRIPTION << '\n';
 
-    auto concurrency = std::thread::hardware_concurrency();
+    int concurrency = std::max(1, (int)std::thread::hardware_concurrency());
 
     // Override concurrency if the conf exists with a concurrency value
-    constexpr auto conf_filename = "GravityFun.conf";
-    if (std::filesystem::exists(conf_filename) && std::filesystem::is_regular_file(conf_filename))
+    GravityFun::Config config("GravityFun.conf");
+    if (auto value = config.GetInteger("concurrency"))
     {
-        std::ifstream conf(conf_filename);
-        std::string line;
-        while (std::getline(conf, line))
-        {
-            auto i = line.find("concurrency");
-            if (i == std::string::npos)
-                continue;
-            i += std::string("concurrency").length();
-            for (; i < line.length(); i++)
-                if (line[i] != ' ')
-                    break;
-            if (line[i] != '=')
-                continue;
-            i++;
-            for (; i < line.length(); i++)
-                if (line[i] != ' ')
-                    break;
-            int j = i;
-            for (; j < line.length(); j++)
-                if (!std::isdigit(line[i]))
-                    break;
-            if (i != j)
-            {
-                concurrency = std::stoi(line.substr(i, j - i));
-                if (concurrency < 1)
-                    concurrency = 1;
-                if (concurrency > 1024)
-                    concurrency = 1024;
-                std::cout << "Config found, concurrency set to " << concurrency << ".\n";
-            }
-        }
+        concurrency = std::clamp(*value, 1, 1024);
+        std::cout << "Config found, concurrency set to " << concurrency << ".\n";
     }
+    if (!metrics_port)
+        metrics_port = config.GetInteger("metrics_port");
 
     // Modules Initialization
 
     std::shared_ptr<GravityFun::Window> window(new GravityFun::Window(std::string(GravityFun::Info::NAME) + " v" + GravityFun::Info::VERSION));
+    std::shared_ptr<GravityFun::InputSource> input_source = window;
+    std::shared_ptr<GravityFun::InputRecorder> recorder;
+    std::shared_ptr<GravityFun::InputReplayer> replayer;
+    std::optional<GravityFun::Scenario::Kind> scenario;
+    std::optional<int> objects_count;
+    if (!replay_filename.empty())
+    {
+        // The window is still updated, and closing it ends the replay
+        replayer.reset(new GravityFun::InputReplayer(window));
+        if (!replayer->Open(replay_filename))
+        {
+            std::cout << "Could not read the input log " << replay_filename << '\n';
+            return 1;
+        }
+        const auto& header = replayer->GetHeader();
+        seed = header.Seed;
+        time_diff = header.TimeDiff;
+        objects_count = header.ObjectsCount;
+        scenario = header.ScenarioKind;
+        concurrency = std::clamp(header.Concurrency, 1, 1024);
+        input_source = replayer;
+    }
+    else if (!record_filename.empty())
+    {
+        if (!seed)
+            seed = std::random_device()();
+        recorder.reset(new GravityFun::InputRecorder(window));
+        input_source = recorder;
+    }
     std::shared_ptr<GravityFun::EnergySaver> energy_saver(new GravityFun::EnergySaver());
-    std::shared_ptr<GravityFun::GameManager> game_manager(new GravityFun::GameManager(window, energy_saver));
+    std::shared_ptr<GravityFun::GameManager> game_manager(new GravityFun::GameManager(input_source, energy_saver, seed));
+    // The replays apply the recorded world instead of the config's
+    auto world_config = replayer ? GravityFun::Config(replayer->GetHeader().WorldConfig) : config;
+    GravityFun::ApplyWorldConfig(world_config, *game_manager);
+    if (scenario)
+        game_manager->SetScenario(*scenario);
+    if (objects_count)
+        game_manager->SetObjectsCount(*objects_count);
+    game_manager->SetFixedTimeDiff(time_diff);
+    game_manager->SetTraceFilename(trace_filename);
+    GravityFun::PerfCounters::SetEnabled(counters);
+    if (allocations_warmup)
+        GravityFun::Allocations::SetEnabled(true, *allocations_warmup);
+    if (metrics_port)
+    {
+        std::shared_ptr<GravityFun::MetricsServer> metrics_server(new GravityFun::MetricsServer());
+        if (metrics_server->Start(*metrics_port))
+            game_manager->SetMetricsServer(metrics_server);
+        else
+            std::cout << "Could not serve the metrics on port " << *metrics_port << ".\n";
+    }
+    if (replayer)
+        replayer->SetGameManager(game_manager.get());
+    if (recorder && !recorder->Open(record_filename,
+        { *seed, time_diff, game_manager->GetObjectsCount(), game_manager->GetScenario(),
+            concurrency, GravityFun::GetWorldConfigEntries(config) },
+        game_manager.get()))
+    {
+        std::cout << "Could not write the input log " << record_filename << '\n';
+        return 1;
+    }
     std::vector<std::shared_ptr<GravityFun::Physics>> physics_pass1;
     std::vector<std::shared_ptr<GravityFun::Physics>> physics_pass2; // hybrid pass
     auto physics_modules_count = concurrency;
@@ -75,6 +166,13 @@ int main()
                 new GravityFun::Physics(game_manager, i, physics_modules_count, physics_pass1[i].get())
             )
         );
+    std::vector<std::shared_ptr<GravityFun::ContactSolver>> contact_solvers;
+    for (int i = 0; i < physics_modules_count; i++)
+        contact_solvers.push_back(
+            std::shared_ptr<GravityFun::ContactSolver>(
+                new GravityFun::ContactSolver(game_manager, i)
+            )
+        );
     std::shared_ptr<GravityFun::Renderer> renderer(new GravityFun::Renderer(window, game_manager));
 
     // Construct Loop
@@ -89,15 +187,23 @@ int main()
         physics_pass2_members.push_back(
             LoopScheduler::ParallelGroupMember(item, 0)
         );
+    std::vector<LoopScheduler::ParallelGroupMember> contact_solving_members;
+    for (auto& item : contact_solvers)
+        contact_solving_members.push_back(
+            LoopScheduler::ParallelGroupMember(item, 0)
+        );
 
     std::shared_ptr<LoopScheduler::ParallelGroup> physics_pass1_group(new LoopScheduler::ParallelGroup(physics_pass1_members));
     std::shared_ptr<LoopScheduler::ParallelGroup> physics_pass2_group(new LoopScheduler::ParallelGroup(physics_pass2_members));
+    std::shared_ptr<LoopScheduler::ParallelGroup> contact_solving_group(new LoopScheduler::ParallelGroup(contact_solving_members));
     std::shared_ptr<LoopScheduler::SequentialGroup> physics_passes_group(new LoopScheduler::SequentialGroup(
         std::vector<LoopScheduler::SequentialGroupMember>({
             physics_pass1_group,
             game_manager->GetPhysicsPass1Notifier(),
             physics_pass2_group,
             game_manager->GetPhysicsPass2Notifier(),
+            contact_solving_group,
+            game_manager->GetContactSolvingNotifier(),
             energy_saver
         })
     ));
@@ -115,11 +221,26 @@ int main()
         })
     ));
 
-    game_manager->SetGroups(root_group.get(), physics_pass1_group.get(), physics_pass2_group.get());
+    game_manager->SetGroups(root_group.get(), physics_pass1_group.get(), physics_pass2_group.get(), contact_solving_group.get());
 
     LoopScheduler::Loop loop(root_group);
 
     loop.Run(concurrency);
+    if (recorder)
+        recorder->Close();
+    if (counters)
+        GravityFun::PerfCounters::WriteReport(std::cout, game_manager->GetObjectStepsCount());
+    if (!trace_filename.empty() && !GravityFun::Trace::WriteChromeTrace(trace_filename))
+        std::cout << "Could not write the trace " << trace_filename << '\n';
+    if (allocations_warmup)
+    {
+        GravityFun::Allocations::WriteReport(std::cout);
+        if (GravityFun::Allocations::HasSteadyStateAllocations())
+        {
+            std::cout << "Heap allocations after the warm-up\n";
+            return 2;
+        }
+    }
 
     // For testing no LoopScheduler (use instead of loop.Run(...))
     //while (!window->ShouldClose())
@@ -134,6 +255,9 @@ int main()
     //        for (auto& pass : physics_pass2)
     //            pass->GetRunningToken().Run();
     //        game_manager->GetPhysicsPass2Notifier()->GetRunningToken().Run();
+    //        for (auto& solver : contact_solvers)
+    //            solver->GetRunningToken().Run();
+    //        game_manager->GetContactSolvingNotifier()->GetRunningToken().Run();
     //    }
     //}
 
@@ -23,6 +23,11 @@
     #define GRAVITYFUN_DEBUG 0
 #endif
 
+/// 0: No softening, 1: Plummer softening, 2: Cubic spline softening
+#ifndef GRAVITYFUN_GRAVITY_SOFTENING
+    #define GRAVITYFUN_GRAVITY_SOFTENING 1
+#endif
+
 #if GRAVITYFUN_DEBUG
 #include <iostream>
 #include <string>
@@ -39,17 +44,28 @@ Loop with threads=concurrency:
             Renderer (idles on thread block)
             SequentialGroup* physics passes:
                 ParallelGroup physics pass 1:
-                    Physics[concurrency] // force/motion updates.
+                    Physics[concurrency] // force/motion updates, or fluid densities in the fluid mode.
                 GameManager.PhysicsPass1Notifier
                 ParallelGroup physics pass 2:
-                    Physics[concurrency] // resolves collisions between objects if on, else, normal force/motion update.
-                GameManager.PhysicsPass2Notifier
+                    Physics[concurrency] // detects contacts between objects if on, else, normal force/motion update.
+                GameManager.PhysicsPass2Notifier // builds the contact graph.
+                ParallelGroup contact solving:
+                    ContactSolver[concurrency] // share the contact graph work, if any.
+                GameManager.ContactSolvingNotifier
                 EnergySaver
 
-GameManager uses Window
+GameManager uses InputSource (Window, or HeadlessInput in the headless executable,
+    either of which can be wrapped in an InputRecorder, or replaced by an InputReplayer)
 Renderer uses Window
 Renderer uses GameManager
 Physics uses GameManager
+ContactSolver uses GameManager
+
+GameManager contains
+    ContactGraph
+    ObjectMapper
+    MultiLevelObjectMapper
+    ForceEngineSelector
 
 Renderer contains
     ShaderProgram
@@ -63,11 +79,17 @@ namespace GravityFun
 #if GRAVITYFUN_DEBUG
     inline void Log(std::string message = "", std::string end = "\n") { std::cout << message << end; }
 #endif
+    class InputSource;
     class Window;
+    class HeadlessInput;
+    class InputRecorder;
+    class InputReplayer;
     class MouseEventManager;
     class ShaderProgram;
     class GameManager;
     class Renderer;
     class Physics;
+    class ContactSolver;
     class EnergySaver;
+    class MetricsServer;
 }
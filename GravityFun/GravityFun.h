@@ -19,9 +19,18 @@
 
 #include "Info.h"
 
+#include "Config.h"
+#include "WorldConfig.h"
+
 #include "Window.h"
+#include "InputLog.h"
 #include "GameManager.h"
 #include "Physics.h"
+#include "ContactSolver.h"
 #include "EnergySaver.h"
+#include "Allocations.h"
+#include "MetricsServer.h"
+#include "PerfCounters.h"
+#include "Trace.h"
 #include "ShaderProgram.h"
 #include "Renderer.h"
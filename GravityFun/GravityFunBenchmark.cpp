@@ -0,0 +1,576 @@
+#include "GravityFunBenchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Records the time whenever it runs, to time the modules between 2 markers in a SequentialGroup.
+    class TimeMarker final : public LoopScheduler::Module
+    {
+    public:
+        explicit TimeMarker(int capacity) { Times.reserve(capacity); }
+        std::vector<std::chrono::steady_clock::time_point> Times;
+    protected:
+        virtual void OnRun() override { Times.push_back(std::chrono::steady_clock::now()); }
+    };
+}
+
+/// @brief A combination of the modes, with the toggle keys that turn it on from the default modes.
+struct Mode
+{
+    std::string Gravity;
+    std::string Collision;
+    std::string Borders;
+    std::string Keys;
+};
+
+struct Statistics
+{
+    double Median;
+    /// @brief The median absolute deviation from the median.
+    double Mad;
+    double Min;
+};
+
+/// @brief The timings of a scenario, by subsystem.
+struct Result
+{
+    std::string Scenario;
+    std::map<std::string, Statistics> Subsystems;
+};
+
+struct Settings
+{
+    int Steps = 50;
+    int WarmupSteps = 10;
+    double TimeDiff = 1.0 / 60;
+    unsigned int Seed = 1;
+    /// @brief The number of times each scenario is run, for the noise across runs.
+    int Repeats = 1;
+    std::vector<int> Sizes = { 100, 250, 500, 1000 };
+    std::vector<int> ThreadCounts;
+    std::vector<GravityFun::Scenario::Kind> Scenarios = { GravityFun::Scenario::Kind::Scattered };
+};
+
+/// @brief A run is slower than the baseline when its median is slower by more than the tolerance,
+///        by more than this many (normal-consistent) MADs of the noisier one, and by more than the min difference.
+constexpr double DEFAULT_TOLERANCE = 0.1;
+constexpr double DEFAULT_MAD_FACTOR = 3;
+/// @brief Differences below this many milliseconds are scheduling noise rather than changes in the code.
+constexpr double DEFAULT_MIN_DIFFERENCE = 0.05;
+/// @brief Scales a MAD to the standard deviation of normally distributed samples.
+constexpr double MAD_TO_STANDARD_DEVIATION = 1.4826;
+
+static double get_median(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    int n = (int)samples.size();
+    return n % 2 == 1 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+}
+
+static Statistics get_statistics(const std::vector<double>& samples)
+{
+    double median = get_median(samples);
+    std::vector<double> deviations;
+    for (double sample : samples)
+        deviations.push_back(std::abs(sample - median));
+    return Statistics{ median, get_median(deviations), *std::min_element(samples.begin(), samples.end()) };
+}
+
+static std::vector<int> parse_list(const std::string& text)
+{
+    std::vector<int> values;
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        if (int value = std::atoi(item.c_str()); value > 0)
+            values.push_back(value);
+    return values;
+}
+
+/// @brief The physics stages that are timed, in order. The markers are before and after each.
+enum Stage { Pass1, Pass1Notifier, Pass2, Pass2Notifier, ContactSolving, ContactSolvingNotifier, STAGES_COUNT };
+
+/// @return The step times in milliseconds by subsystem, for the steps after the warmup ones.
+static std::map<std::string, std::vector<double>> run_physics(const Mode& mode, GravityFun::Scenario::Kind scenario,
+    int objects_count, int threads, const Settings& settings)
+{
+    using namespace GravityFun;
+    std::shared_ptr<HeadlessInput> input(new HeadlessInput());
+    std::shared_ptr<EnergySaver> energy_saver(new EnergySaver());
+    std::shared_ptr<GameManager> game_manager(new GameManager(input, energy_saver, settings.Seed));
+    game_manager->SetObjectsCount(objects_count);
+    game_manager->SetScenario(scenario);
+    game_manager->SetFixedTimeDiff(settings.TimeDiff);
+    for (char key : mode.Keys)
+        input->PressKey(key);
+    input->SetMaxUpdatesCount(settings.WarmupSteps + settings.Steps);
+
+    std::vector<std::shared_ptr<Physics>> physics_pass1;
+    std::vector<std::shared_ptr<Physics>> physics_pass2;
+    std::vector<std::shared_ptr<ContactSolver>> contact_solvers;
+    std::vector<LoopScheduler::ParallelGroupMember> physics_pass1_members;
+    std::vector<LoopScheduler::ParallelGroupMember> physics_pass2_members;
+    std::vector<LoopScheduler::ParallelGroupMember> contact_solving_members;
+    for (int i = 0; i < threads; i++)
+    {
+        physics_pass1.push_back(std::shared_ptr<Physics>(new Physics(game_manager, i, threads, nullptr)));
+        physics_pass1_members.push_back(LoopScheduler::ParallelGroupMember(physics_pass1.back(), 0));
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        physics_pass2.push_back(std::shared_ptr<Physics>(new Physics(game_manager, i, threads, physics_pass1[i].get())));
+        physics_pass2_members.push_back(LoopScheduler::ParallelGroupMember(physics_pass2.back(), 0));
+    }
+    for (int i = 0; i < threads; i++)
+    {
+        contact_solvers.push_back(std::shared_ptr<ContactSolver>(new ContactSolver(game_manager, i)));
+        contact_solving_members.push_back(LoopScheduler::ParallelGroupMember(contact_solvers.back(), 0));
+    }
+    std::shared_ptr<LoopScheduler::ParallelGroup> physics_pass1_group(new LoopScheduler::ParallelGroup(physics_pass1_members));
+    std::shared_ptr<LoopScheduler::ParallelGroup> physics_pass2_group(new LoopScheduler::ParallelGroup(physics_pass2_members));
+    std::shared_ptr<LoopScheduler::ParallelGroup> contact_solving_group(new LoopScheduler::ParallelGroup(contact_solving_members));
+
+    std::vector<std::shared_ptr<TimeMarker>> markers;
+    for (int i = 0; i <= STAGES_COUNT; i++)
+        markers.push_back(std::shared_ptr<TimeMarker>(new TimeMarker(settings.WarmupSteps + settings.Steps)));
+    std::shared_ptr<LoopScheduler::SequentialGroup> root_group(new LoopScheduler::SequentialGroup(
+        std::vector<LoopScheduler::SequentialGroupMember>({
+            game_manager,
+            markers[Pass1],
+            physics_pass1_group,
+            markers[Pass1Notifier],
+            game_manager->GetPhysicsPass1Notifier(),
+            markers[Pass2],
+            physics_pass2_group,
+            markers[Pass2Notifier],
+            game_manager->GetPhysicsPass2Notifier(),
+            markers[ContactSolving],
+            contact_solving_group,
+            markers[ContactSolvingNotifier],
+            game_manager->GetContactSolvingNotifier(),
+            markers[STAGES_COUNT]
+        })
+    ));
+    game_manager->SetGroups(root_group.get(), physics_pass1_group.get(), physics_pass2_group.get(), contact_solving_group.get());
+
+    LoopScheduler::Loop loop(root_group);
+    loop.Run(threads);
+
+    auto get_time = [&](int i, Stage begin, Stage end) -> double
+    {
+        return std::chrono::duration<double, std::milli>(markers[end]->Times[i] - markers[begin]->Times[i]).count();
+    };
+    std::map<std::string, std::vector<double>> samples;
+    for (int i = settings.WarmupSteps; i < (int)markers[STAGES_COUNT]->Times.size(); i++)
+    {
+        // Pass2 moves the objects too when there are no contacts to detect
+        samples["force_pass_ms"].push_back(get_time(i, Pass1, Pass1Notifier));
+        samples["collision_pass_ms"].push_back(get_time(i, Pass2, Pass2Notifier) + get_time(i, ContactSolving, ContactSolvingNotifier));
+        // The notifiers update the mappers, the contact graph, and the object flow
+        samples["notify_ms"].push_back(get_time(i, Pass1Notifier, Pass2) + get_time(i, Pass2Notifier, ContactSolving)
+            + get_time(i, ContactSolvingNotifier, STAGES_COUNT));
+        samples["step_ms"].push_back(get_time(i, Pass1, STAGES_COUNT));
+    }
+    return samples;
+}
+
+/// @brief Times rebuilding a mapper with all the objects, and querying around every object.
+/// @return The times in milliseconds by subsystem.
+template <typename Rebuild, typename Query>
+static std::map<std::string, std::vector<double>> run_mapper(int repetitions, const Rebuild& rebuild, const Query& query)
+{
+    using clock = std::chrono::steady_clock;
+    std::map<std::string, std::vector<double>> samples;
+    for (int i = 0; i < repetitions; i++)
+    {
+        auto start = clock::now();
+        rebuild();
+        auto middle = clock::now();
+        query();
+        auto end = clock::now();
+        samples["mapper_build_ms"].push_back(std::chrono::duration<double, std::milli>(middle - start).count());
+        samples["mapper_query_ms"].push_back(std::chrono::duration<double, std::milli>(end - middle).count());
+    }
+    return samples;
+}
+
+/// @return The times of each mapper scenario by subsystem.
+static std::vector<std::pair<std::string, std::map<std::string, std::vector<double>>>> run_mappers(GravityFun::Scenario::Kind scenario,
+    int objects_count, unsigned int seed)
+{
+    using namespace GravityFun;
+    constexpr double border_x = 4.0 / 3;
+    constexpr double border_y = 1;
+    std::unique_ptr<std::array<FloatingObject, GameManager::MAX_OBJECTS_COUNT>> objects(
+        new std::array<FloatingObject, GameManager::MAX_OBJECTS_COUNT>());
+    Random random;
+    random.Seed(seed);
+    Scenario::Generate(scenario, std::span<FloatingObject>(objects->data(), objects_count), border_x, border_y, true, random);
+    // About 100000 object insertions for each
+    int repetitions = std::max(3, 100000 / std::max(1, objects_count));
+
+    std::unique_ptr<GameManager::FloatingObjectMapper> object_mapper(new GameManager::FloatingObjectMapper());
+    object_mapper->SetBorders(border_x, border_y);
+    std::unique_ptr<SparseObjectMapper> sparse_object_mapper(new SparseObjectMapper());
+    sparse_object_mapper->SetCellSize(2 * border_x / GameManager::OBJECT_MAPPING_SIZE_X, 2 * border_y / GameManager::OBJECT_MAPPING_SIZE_Y);
+    std::unique_ptr<GameManager::FloatingObjectCollisionMapper> collision_mapper(
+        new GameManager::FloatingObjectCollisionMapper(2 * GameManager::MIN_MASS * GameManager::MASS_TO_RADIUS));
+    collision_mapper->SetBorders(border_x, border_y);
+
+    long long visited = 0; // Used, so the queries are not optimized away
+    auto query_all = [&](const auto& mapper, double radius)
+    {
+        for (int i = 0; i < objects_count; i++)
+            mapper.VisitObjects((*objects)[i].Position, radius, [&](int) -> bool { visited++; return false; });
+    };
+
+    std::vector<std::pair<std::string, std::map<std::string, std::vector<double>>>> results;
+    for (double radius : { GameManager::FLUID_SMOOTHING_LENGTH, GameManager::MASS_GRAVITY_RADIUS })
+    {
+        std::string suffix = std::string(" initial=") + Scenario::GetName(scenario)
+            + " objects=" + std::to_string(objects_count) + " radius=" + std::to_string(radius);
+        results.emplace_back("mapper=object" + suffix, run_mapper(repetitions,
+            [&]
+            {
+                object_mapper->Clear();
+                for (int i = 0; i < objects_count; i++)
+                    object_mapper->AddObject((*objects)[i].Position, i);
+            },
+            [&] { query_all(*object_mapper, radius); }
+        ));
+        results.emplace_back("mapper=sparse" + suffix, run_mapper(repetitions,
+            [&]
+            {
+                sparse_object_mapper->Clear();
+                for (int i = 0; i < objects_count; i++)
+                    sparse_object_mapper->AddObject((*objects)[i].Position, i);
+            },
+            [&] { query_all(*sparse_object_mapper, radius); }
+        ));
+    }
+    double collision_radius = 2 * GameManager::MAX_MASS * GameManager::MASS_TO_RADIUS;
+    results.emplace_back(std::string("mapper=collision initial=") + Scenario::GetName(scenario)
+        + " objects=" + std::to_string(objects_count) + " radius=" + std::to_string(collision_radius),
+        run_mapper(repetitions,
+            [&] { collision_mapper->Map(std::span<const FloatingObject>(objects->data(), objects_count), GameManager::MASS_TO_RADIUS); },
+            [&] { query_all(*collision_mapper, collision_radius); }
+        )
+    );
+    if (visited < 0)
+        std::cerr << visited;
+    return results;
+}
+
+/// @brief Runs a scenario the repeats count of times.
+///        The statistics of each subsystem are of the samples of all the runs,
+///        so the MAD covers both the noise within a run and between the runs.
+template <typename Run>
+static std::map<std::string, Statistics> repeat(int repeats, const Run& run)
+{
+    std::map<std::string, std::vector<double>> samples;
+    for (int i = 0; i < repeats; i++)
+        for (auto& [subsystem, run_samples] : run())
+            samples[subsystem].insert(samples[subsystem].end(), run_samples.begin(), run_samples.end());
+    std::map<std::string, Statistics> statistics;
+    for (const auto& [subsystem, subsystem_samples] : samples)
+        if (!subsystem_samples.empty())
+            statistics[subsystem] = get_statistics(subsystem_samples);
+    return statistics;
+}
+
+static std::string to_json(const Settings& settings, const std::vector<Result>& results)
+{
+    auto list_to_json = [](const std::vector<int>& list)
+    {
+        std::string text = "[";
+        for (std::size_t i = 0; i < list.size(); i++)
+            text += (i == 0 ? "" : ", ") + std::to_string(list[i]);
+        return text + "]";
+    };
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\n  \"name\": " << GravityFun::Json::Quote(GravityFun::Info::NAME)
+        << ", \"version\": " << GravityFun::Json::Quote(GravityFun::Info::VERSION)
+        << ", \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+        << ",\n  \"settings\": { \"steps\": " << settings.Steps << ", \"warmup_steps\": " << settings.WarmupSteps
+        << ", \"time_diff\": " << settings.TimeDiff << ", \"seed\": " << settings.Seed << ", \"repeats\": " << settings.Repeats
+        << ", \"sizes\": " << list_to_json(settings.Sizes) << ", \"threads\": " << list_to_json(settings.ThreadCounts)
+        << ", \"scenarios\": [";
+    for (std::size_t i = 0; i < settings.Scenarios.size(); i++)
+        json << (i == 0 ? "" : ", ") << GravityFun::Json::Quote(GravityFun::Scenario::GetName(settings.Scenarios[i]));
+    json << "] }"
+        << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        json << (i == 0 ? "" : ",") << "\n    { \"scenario\": " << GravityFun::Json::Quote(results[i].Scenario) << ", \"subsystems\": {";
+        bool first = true;
+        for (const auto& [subsystem, statistics] : results[i].Subsystems)
+        {
+            json << (first ? "" : ",") << "\n      " << GravityFun::Json::Quote(subsystem) << ": { \"median\": " << statistics.Median
+                << ", \"mad\": " << statistics.Mad << ", \"min\": " << statistics.Min << " }";
+            first = false;
+        }
+        json << " } }";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+/// @brief Reports the subsystems of the scenarios that are slower than the baseline.
+/// @return The number of regressions.
+static int compare(const GravityFun::Json& baseline, const std::vector<Result>& results,
+    double tolerance, double mad_factor, double min_difference)
+{
+    std::map<std::string, const GravityFun::Json *> baseline_results;
+    if (auto items = baseline.Get("results"); items != nullptr)
+        for (const auto& item : items->GetArray())
+            if (auto subsystems = item.Get("subsystems"); subsystems != nullptr)
+                baseline_results[item.GetString("scenario", "")] = subsystems;
+
+    int regressions = 0;
+    int improvements = 0;
+    int compared = 0;
+    int missing = 0;
+    for (const auto& result : results)
+    {
+        auto i = baseline_results.find(result.Scenario);
+        if (i == baseline_results.end())
+        {
+            missing++;
+            continue;
+        }
+        for (const auto& [subsystem, statistics] : result.Subsystems)
+        {
+            auto base = i->second->Get(subsystem);
+            if (base == nullptr)
+            {
+                missing++;
+                continue;
+            }
+            compared++;
+            double base_median = base->GetNumber("median", 0);
+            double noise = MAD_TO_STANDARD_DEVIATION * std::max(base->GetNumber("mad", 0), statistics.Mad);
+            double difference = statistics.Median - base_median;
+            double threshold = std::max({ tolerance * base_median, mad_factor * noise, min_difference });
+            if (difference > threshold || -difference > threshold)
+            {
+                bool slower = difference > 0;
+                (slower ? regressions : improvements)++;
+                std::cerr << (slower ? "SLOWER  " : "faster  ") << result.Scenario << "  " << subsystem << ": "
+                    << base_median << " -> " << statistics.Median
+                    << " (" << (difference >= 0 ? "+" : "") << (base_median > 0 ? 100 * difference / base_median : 0) << "%)\n";
+            }
+        }
+    }
+    std::cerr << compared << " timings compared, " << regressions << " slower, " << improvements << " faster, "
+        << missing << " not in the baseline\n";
+    return regressions;
+}
+
+/// @brief Times the physics passes and the object mappers in every mode combination, and writes the results as JSON.
+///        Optionally compares them to a baseline of a previous run.
+int main(int argc, char * argv[])
+{
+    Settings settings;
+    int hardware_concurrency = std::max(1u, std::thread::hardware_concurrency());
+    settings.ThreadCounts.push_back(1);
+    for (int threads = 2; threads < hardware_concurrency; threads *= 2)
+        settings.ThreadCounts.push_back(threads);
+    if (hardware_concurrency > 1)
+        settings.ThreadCounts.push_back(hardware_concurrency);
+
+    std::map<std::string, std::string> options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (i + 1 == argc)
+        {
+            std::cerr << "Missing the value of " << option << '\n';
+            return 1;
+        }
+        options[option] = argv[++i];
+    }
+
+    // The baseline's settings are the defaults, so the same scenarios are run
+    std::optional<GravityFun::Json> baseline;
+    if (options.contains("--baseline"))
+    {
+        std::ifstream file(options["--baseline"]);
+        std::stringstream text;
+        text << file.rdbuf();
+        baseline = GravityFun::Json::Parse(text.str());
+        if (!file || !baseline)
+        {
+            std::cerr << "Could not read the baseline " << options["--baseline"] << '\n';
+            return 1;
+        }
+        if (auto base = baseline->Get("settings"); base != nullptr)
+        {
+            settings.Steps = (int)base->GetNumber("steps", settings.Steps);
+            settings.WarmupSteps = (int)base->GetNumber("warmup_steps", settings.WarmupSteps);
+            settings.TimeDiff = base->GetNumber("time_diff", settings.TimeDiff);
+            settings.Seed = (unsigned int)base->GetNumber("seed", settings.Seed);
+            settings.Repeats = (int)base->GetNumber("repeats", settings.Repeats);
+            for (auto [key, list] : { std::pair{ "sizes", &settings.Sizes }, std::pair{ "threads", &settings.ThreadCounts } })
+            {
+                if (auto items = base->Get(key); items != nullptr && !items->GetArray().empty())
+                {
+                    list->clear();
+                    for (const auto& item : items->GetArray())
+                        list->push_back((int)item.GetNumber());
+                }
+            }
+            if (auto items = base->Get("scenarios"); items != nullptr && !items->GetArray().empty())
+            {
+                settings.Scenarios.clear();
+                for (const auto& item : items->GetArray())
+                    if (GravityFun::Scenario::Kind kind; GravityFun::Scenario::Parse(item.GetString(), kind))
+                        settings.Scenarios.push_back(kind);
+            }
+        }
+    }
+
+    double tolerance = DEFAULT_TOLERANCE;
+    double mad_factor = DEFAULT_MAD_FACTOR;
+    double min_difference = DEFAULT_MIN_DIFFERENCE;
+    std::string output_filename;
+    for (const auto& [option, value] : options)
+    {
+        if (option == "--steps")
+            settings.Steps = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--warmup")
+            settings.WarmupSteps = std::max(0, std::atoi(value.c_str()));
+        else if (option == "--time-diff")
+            settings.TimeDiff = std::atof(value.c_str());
+        else if (option == "--seed")
+            settings.Seed = (unsigned int)std::atoll(value.c_str());
+        else if (option == "--repeats")
+            settings.Repeats = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--sizes")
+            settings.Sizes = parse_list(value);
+        else if (option == "--threads")
+            settings.ThreadCounts = parse_list(value);
+        else if (option == "--scenarios")
+        {
+            settings.Scenarios.clear();
+            std::istringstream stream(value);
+            std::string name;
+            while (std::getline(stream, name, ','))
+            {
+                GravityFun::Scenario::Kind kind;
+                if (name == "all")
+                {
+                    settings.Scenarios.assign(GravityFun::Scenario::KINDS.begin(), GravityFun::Scenario::KINDS.end());
+                }
+                else if (GravityFun::Scenario::Parse(name, kind))
+                {
+                    settings.Scenarios.push_back(kind);
+                }
+                else
+                {
+                    std::cerr << "Unknown scenario: " << name << '\n';
+                    return 1;
+                }
+            }
+        }
+        else if (option == "--output")
+            output_filename = value;
+        else if (option == "--tolerance")
+            tolerance = std::atof(value.c_str());
+        else if (option == "--mad-factor")
+            mad_factor = std::atof(value.c_str());
+        else if (option == "--min-difference")
+            min_difference = std::atof(value.c_str());
+        else if (option != "--baseline")
+        {
+            std::cerr << "Unknown option: " << option << "\n"
+                "Options: --steps N, --warmup N, --time-diff SECONDS, --seed N, --repeats N,\n"
+                "         --sizes N,N,..., --threads N,N,..., --scenarios NAME,NAME,... (or all),\n"
+                "         --output FILE (stdout by default),\n"
+                "         --baseline FILE, --tolerance RATIO, --mad-factor N, --min-difference MILLISECONDS\n";
+            return 1;
+        }
+    }
+    // The object buffers have a fixed size, and each size is run once, in ascending order
+    for (auto& size : settings.Sizes)
+        size = std::min(size, GravityFun::GameManager::MAX_OBJECTS_COUNT);
+    std::sort(settings.Sizes.begin(), settings.Sizes.end());
+    settings.Sizes.erase(std::unique(settings.Sizes.begin(), settings.Sizes.end()), settings.Sizes.end());
+
+    // R cycles the relative gravity from none to pull, E sets it to push, C turns object collision off,
+    // B turns border collision off (wrap around), U makes the world unbounded
+    std::vector<Mode> modes;
+    for (auto [gravity, gravity_keys] : { std::pair{ "none", "" }, std::pair{ "pull", "R" }, std::pair{ "push", "E" } })
+        for (auto [collision, collision_keys] : { std::pair{ "on", "" }, std::pair{ "off", "C" } })
+            for (auto [borders, borders_keys] : { std::pair{ "bounce", "" }, std::pair{ "wrap", "B" }, std::pair{ "unbounded", "U" } })
+                modes.push_back(Mode{ gravity, collision, borders, std::string(gravity_keys) + collision_keys + borders_keys });
+
+    std::vector<Result> results;
+    for (auto scenario : settings.Scenarios)
+    {
+        std::string initial = std::string(" initial=") + GravityFun::Scenario::GetName(scenario);
+        for (const auto& mode : modes)
+        {
+            for (int objects_count : settings.Sizes)
+            {
+                for (int threads : settings.ThreadCounts)
+                {
+                    std::string name = "physics gravity=" + mode.Gravity + " collision=" + mode.Collision + " borders=" + mode.Borders
+                        + initial + " objects=" + std::to_string(objects_count) + " threads=" + std::to_string(threads);
+                    std::cerr << name << '\n';
+                    results.push_back(Result{ name, repeat(settings.Repeats,
+                        [&] { return run_physics(mode, scenario, objects_count, threads, settings); }) });
+                }
+            }
+        }
+        for (int objects_count : settings.Sizes)
+        {
+            std::cerr << "mappers" << initial << " objects=" << objects_count << '\n';
+            std::map<std::string, std::vector<std::map<std::string, std::vector<double>>>> runs;
+            for (int i = 0; i < settings.Repeats; i++)
+                for (auto& [name, samples] : run_mappers(scenario, objects_count, settings.Seed))
+                    runs[name].push_back(std::move(samples));
+            for (auto& [name, name_runs] : runs)
+            {
+                std::size_t i = 0;
+                results.push_back(Result{ name, repeat(settings.Repeats, [&] { return name_runs[i++]; }) });
+            }
+        }
+    }
+
+    auto json = to_json(settings, results);
+    if (output_filename.empty())
+    {
+        std::cout << json;
+    }
+    else
+    {
+        std::ofstream file(output_filename);
+        file << json;
+        if (!file)
+        {
+            std::cerr << "Could not write " << output_filename << '\n';
+            return 1;
+        }
+    }
+
+    if (baseline && compare(*baseline, results, tolerance, mad_factor, min_difference) > 0)
+        return 2;
+    return 0;
+}
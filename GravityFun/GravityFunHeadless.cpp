@@ -0,0 +1,363 @@
+#include "GravityFunHeadless.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @return The FNV-1a hash of the objects of the last physics step.
+static std::uint64_t get_checksum(GravityFun::GameManager& game_manager)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    auto add = [&](const void * data, std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; i++)
+            hash = (hash ^ ((const unsigned char *)data)[i]) * 1099511628211ULL;
+    };
+    const auto& objects = game_manager.GetPhysicsPass1ReadBuffer();
+    for (int i = 0; i < game_manager.GetObjectsCount(); i++)
+    {
+        double values[] = { objects[i].Mass, objects[i].Position.x, objects[i].Position.y, objects[i].Velocity.x, objects[i].Velocity.y };
+        add(values, sizeof(values));
+        add(&objects[i].Id, sizeof(objects[i].Id));
+    }
+    return hash;
+}
+
+/// @brief The relative change of the totals that --check-conservation allows for the rounding errors.
+constexpr double CONSERVATION_TOLERANCE = 1e-9;
+
+/// @brief The totals that the objects keep without external forces, borders, obstacles, emitters and sinks.
+struct Totals
+{
+    double Mass = 0;
+    GravityFun::Math::Vec2 Momentum;
+    /// @brief The sum of the momentum magnitudes, which the rounding errors of Momentum are relative to.
+    double MomentumScale = 0;
+};
+
+/// @return The totals of the objects of the last physics step.
+static Totals get_totals(GravityFun::GameManager& game_manager)
+{
+    Totals totals;
+    const auto& objects = game_manager.GetPhysicsPass1ReadBuffer();
+    for (int i = 0; i < game_manager.GetObjectsCount(); i++)
+    {
+        totals.Mass += objects[i].Mass;
+        totals.Momentum += objects[i].Velocity * objects[i].Mass;
+        totals.MomentumScale += objects[i].Velocity.GetMagnitude() * objects[i].Mass;
+    }
+    return totals;
+}
+
+/// @return Whether two objects of the last physics step have the same Id.
+static bool has_duplicate_ids(GravityFun::GameManager& game_manager)
+{
+    const auto& objects = game_manager.GetPhysicsPass1ReadBuffer();
+    std::vector<int> ids;
+    for (int i = 0; i < game_manager.GetObjectsCount(); i++)
+        ids.push_back(objects[i].Id);
+    std::sort(ids.begin(), ids.end());
+    return std::adjacent_find(ids.begin(), ids.end()) != ids.end();
+}
+
+constexpr const char * USAGE =
+    "Options: --steps N, --objects N, --time-diff SECONDS (0 for the real time), --width N, --height N,\n"
+    "         --seed N, --threads N, --keys KEYS (the toggle keys to press at the start, like GC),\n"
+    "         --scenario NAME (the initial conditions, like plummer-sphere),\n"
+    "         --record FILE (the input log to write), --replay FILE (the input log to run instead of the options),\n"
+    "         --trace FILE (the Chrome trace of the modules to write),\n"
+    "         --counters (reports the hardware counters of each phase per object per step),\n"
+    "         --metrics-port N (serves the Prometheus metrics on http://127.0.0.1:N/metrics),\n"
+    "         --check-allocations WARMUP (fails if a module allocates after WARMUP steps),\n"
+    "         --check-ids (fails if two objects have the same Id at the end),\n"
+    "         --check-conservation (fails if the total mass or momentum changed, like with --keys AB), --help\n";
+
+/// @brief Runs the simulation without a window, as fast as possible, and reports the steps per second.
+int main(int argc, char * argv[])
+{
+    long long steps = 1000;
+    int objects_count = GravityFun::GameManager::MAX_OBJECTS_COUNT;
+    double time_diff = 1.0 / 60;
+    int width = 640;
+    int height = 480;
+    std::optional<unsigned int> seed;
+    std::optional<int> threads;
+    std::string keys;
+    std::optional<GravityFun::Scenario::Kind> scenario;
+    std::string record_filename;
+    std::string replay_filename;
+    std::string trace_filename;
+    bool counters = false;
+    bool check_ids = false;
+    bool check_conservation = false;
+    std::optional<int> metrics_port;
+    std::optional<long long> allocations_warmup;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        // The flags
+        if (option == "--help")
+        {
+            std::cout << USAGE;
+            return 0;
+        }
+        if (option == "--counters")
+        {
+            counters = true;
+            continue;
+        }
+        if (option == "--check-ids")
+        {
+            check_ids = true;
+            continue;
+        }
+        if (option == "--check-conservation")
+        {
+            check_conservation = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            std::cout << "Missing the value of " << option << '\n';
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--steps")
+            steps = std::max(1LL, std::atoll(value.c_str()));
+        else if (option == "--objects")
+            objects_count = std::atoi(value.c_str());
+        else if (option == "--time-diff")
+            time_diff = std::atof(value.c_str());
+        else if (option == "--width")
+            width = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--height")
+            height = std::max(1, std::atoi(value.c_str()));
+        else if (option == "--seed")
+            seed = (unsigned int)std::atoll(value.c_str());
+        else if (option == "--threads")
+            threads = std::clamp(std::atoi(value.c_str()), 1, 1024);
+        else if (option == "--keys")
+            keys = value;
+        else if (option == "--record")
+            record_filename = value;
+        else if (option == "--replay")
+            replay_filename = value;
+        else if (option == "--trace")
+            trace_filename = value;
+        else if (option == "--metrics-port")
+            metrics_port = std::atoi(value.c_str());
+        else if (option == "--check-allocations")
+            allocations_warmup = std::max(0LL, std::atoll(value.c_str()));
+        else if (option == "--scenario")
+        {
+            GravityFun::Scenario::Kind kind;
+            if (!GravityFun::Scenario::Parse(value, kind))
+            {
+                std::cout << "Unknown scenario: " << value << "\nScenarios:";
+                for (auto item : GravityFun::Scenario::KINDS)
+                    std::cout << ' ' << GravityFun::Scenario::GetName(item);
+                std::cout << '\n';
+                return 1;
+            }
+            scenario = kind;
+        }
+        else
+        {
+            std::cout << "Unknown option: " << option << '\n' << USAGE;
+            return 1;
+        }
+    }
+
+    std::cout << GravityFun::Info::CREATOR << " - " << GravityFun::Info::NAME << " v" << GravityFun::Info::VERSION << " (headless)\n";
+
+    int concurrency = std::max(1, (int)std::thread::hardware_concurrency());
+    GravityFun::Config config("GravityFun.conf");
+    if (auto value = config.GetInteger("concurrency"))
+        concurrency = std::clamp(*value, 1, 1024);
+    if (threads)
+        concurrency = *threads;
+    if (!metrics_port)
+        metrics_port = config.GetInteger("metrics_port");
+
+    // Modules Initialization
+
+    std::shared_ptr<GravityFun::HeadlessInput> input(new GravityFun::HeadlessInput(width, height));
+    std::shared_ptr<GravityFun::InputSource> input_source = input;
+    std::shared_ptr<GravityFun::InputRecorder> recorder;
+    std::shared_ptr<GravityFun::InputReplayer> replayer;
+    if (!replay_filename.empty())
+    {
+        replayer.reset(new GravityFun::InputReplayer());
+        if (!replayer->Open(replay_filename))
+        {
+            std::cout << "Could not read the input log " << replay_filename << '\n';
+            return 1;
+        }
+        // The log's settings replace the options
+        const auto& header = replayer->GetHeader();
+        seed = header.Seed;
+        time_diff = header.TimeDiff;
+        objects_count = header.ObjectsCount;
+        scenario = header.ScenarioKind;
+        concurrency = std::clamp(header.Concurrency, 1, 1024);
+        input_source = replayer;
+    }
+    else if (!record_filename.empty())
+    {
+        // Written to the log, so the replays start the same
+        if (!seed)
+            seed = std::random_device()();
+        recorder.reset(new GravityFun::InputRecorder(input));
+        input_source = recorder;
+    }
+    // Not added to the loop, so nothing idles
+    std::shared_ptr<GravityFun::EnergySaver> energy_saver(new GravityFun::EnergySaver());
+    std::shared_ptr<GravityFun::GameManager> game_manager(new GravityFun::GameManager(input_source, energy_saver, seed));
+    // The replays apply the recorded world instead of the config's
+    auto world_config = replayer ? GravityFun::Config(replayer->GetHeader().WorldConfig) : config;
+    GravityFun::ApplyWorldConfig(world_config, *game_manager);
+    if (scenario)
+        game_manager->SetScenario(*scenario);
+    game_manager->SetObjectsCount(objects_count);
+    game_manager->SetFixedTimeDiff(std::max(0.0, time_diff));
+    game_manager->SetTraceFilename(trace_filename);
+    GravityFun::PerfCounters::SetEnabled(counters);
+    if (allocations_warmup)
+        GravityFun::Allocations::SetEnabled(true, *allocations_warmup);
+    if (metrics_port)
+    {
+        std::shared_ptr<GravityFun::MetricsServer> metrics_server(new GravityFun::MetricsServer());
+        if (!metrics_server->Start(*metrics_port))
+        {
+            std::cout << "Could not serve the metrics on port " << *metrics_port << '\n';
+            return 1;
+        }
+        game_manager->SetMetricsServer(metrics_server);
+    }
+    if (replayer)
+        replayer->SetGameManager(game_manager.get());
+    if (recorder && !recorder->Open(record_filename,
+        { *seed, game_manager->GetFixedTimeDiff(), game_manager->GetObjectsCount(), game_manager->GetScenario(),
+            concurrency, GravityFun::GetWorldConfigEntries(config) },
+        game_manager.get()))
+    {
+        std::cout << "Could not write the input log " << record_filename << '\n';
+        return 1;
+    }
+    // The letter and digit key codes are their upper case characters
+    for (char key : keys)
+        input->PressKey(std::toupper((unsigned char)key));
+    // GameManager updates the input once per step
+    input->SetMaxUpdatesCount(steps);
+
+    std::vector<std::shared_ptr<GravityFun::Physics>> physics_pass1;
+    std::vector<std::shared_ptr<GravityFun::Physics>> physics_pass2; // hybrid pass
+    for (int i = 0; i < concurrency; i++)
+        physics_pass1.push_back(
+            std::shared_ptr<GravityFun::Physics>(
+                new GravityFun::Physics(game_manager, i, concurrency, nullptr)
+            )
+        );
+    for (int i = 0; i < concurrency; i++)
+        physics_pass2.push_back(
+            std::shared_ptr<GravityFun::Physics>(
+                new GravityFun::Physics(game_manager, i, concurrency, physics_pass1[i].get())
+            )
+        );
+    std::vector<std::shared_ptr<GravityFun::ContactSolver>> contact_solvers;
+    for (int i = 0; i < concurrency; i++)
+        contact_solvers.push_back(
+            std::shared_ptr<GravityFun::ContactSolver>(
+                new GravityFun::ContactSolver(game_manager, i)
+            )
+        );
+
+    // Construct Loop (one physics step per iteration, nothing to render)
+
+    std::vector<LoopScheduler::ParallelGroupMember> physics_pass1_members;
+    std::vector<LoopScheduler::ParallelGroupMember> physics_pass2_members;
+    std::vector<LoopScheduler::ParallelGroupMember> contact_solving_members;
+    for (auto& item : physics_pass1)
+        physics_pass1_members.push_back(LoopScheduler::ParallelGroupMember(item, 0));
+    for (auto& item : physics_pass2)
+        physics_pass2_members.push_back(LoopScheduler::ParallelGroupMember(item, 0));
+    for (auto& item : contact_solvers)
+        contact_solving_members.push_back(LoopScheduler::ParallelGroupMember(item, 0));
+
+    std::shared_ptr<LoopScheduler::ParallelGroup> physics_pass1_group(new LoopScheduler::ParallelGroup(physics_pass1_members));
+    std::shared_ptr<LoopScheduler::ParallelGroup> physics_pass2_group(new LoopScheduler::ParallelGroup(physics_pass2_members));
+    std::shared_ptr<LoopScheduler::ParallelGroup> contact_solving_group(new LoopScheduler::ParallelGroup(contact_solving_members));
+    std::shared_ptr<LoopScheduler::SequentialGroup> root_group(new LoopScheduler::SequentialGroup(
+        std::vector<LoopScheduler::SequentialGroupMember>({
+            game_manager,
+            physics_pass1_group,
+            game_manager->GetPhysicsPass1Notifier(),
+            physics_pass2_group,
+            game_manager->GetPhysicsPass2Notifier(),
+            contact_solving_group,
+            game_manager->GetContactSolvingNotifier()
+        })
+    ));
+
+    game_manager->SetGroups(root_group.get(), physics_pass1_group.get(), physics_pass2_group.get(), contact_solving_group.get());
+
+    LoopScheduler::Loop loop(root_group);
+
+    Totals initial_totals = get_totals(*game_manager);
+    auto start_time = std::chrono::steady_clock::now();
+    loop.Run(concurrency);
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    long long steps_count = game_manager->GetStepsCount();
+    std::cout << "Simulated " << steps_count << " steps of " << game_manager->GetObjectsCount() << " objects with "
+        << concurrency << " threads in " << duration << " s\n";
+    std::cout << "Steps per second: " << steps_count / duration << '\n';
+    if (recorder)
+        recorder->Close();
+    if (counters)
+        GravityFun::PerfCounters::WriteReport(std::cout, game_manager->GetObjectStepsCount());
+    if (!trace_filename.empty() && !GravityFun::Trace::WriteChromeTrace(trace_filename))
+        std::cout << "Could not write the trace " << trace_filename << '\n';
+    // Equal for runs with equal trajectories, like the replays of an input log
+    std::cout << "State checksum: " << std::hex << get_checksum(*game_manager) << std::dec << '\n';
+    if (allocations_warmup)
+    {
+        GravityFun::Allocations::WriteReport(std::cout);
+        if (GravityFun::Allocations::HasSteadyStateAllocations())
+        {
+            std::cout << "Heap allocations after the warm-up\n";
+            return 2;
+        }
+    }
+    if (check_ids && has_duplicate_ids(*game_manager))
+    {
+        std::cout << "Objects with the same Id\n";
+        return 3;
+    }
+    if (check_conservation)
+    {
+        Totals totals = get_totals(*game_manager);
+        double momentum_scale = std::max(initial_totals.MomentumScale, totals.MomentumScale);
+        std::cout << "Total mass: " << initial_totals.Mass << " -> " << totals.Mass
+            << ", total momentum: (" << initial_totals.Momentum.x << ", " << initial_totals.Momentum.y << ") -> ("
+            << totals.Momentum.x << ", " << totals.Momentum.y << ")\n";
+        if (std::abs(totals.Mass - initial_totals.Mass) > CONSERVATION_TOLERANCE * initial_totals.Mass
+            || (totals.Momentum - initial_totals.Momentum).GetMagnitude() > CONSERVATION_TOLERANCE * momentum_scale)
+        {
+            std::cout << "The total mass or momentum changed\n";
+            return 3;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*
+    Copyright (C) 2022  Majidzadeh (hashpragmaonce@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Info.h"
+
+#include "Config.h"
+#include "WorldConfig.h"
+
+#include "HeadlessInput.h"
+#include "InputLog.h"
+#include "GameManager.h"
+#include "Physics.h"
+#include "ContactSolver.h"
+#include "EnergySaver.h"
+#include "Allocations.h"
+#include "MetricsServer.h"
+#include "PerfCounters.h"
+#include "Trace.h"
@@ -0,0 +1,77 @@
+#include "HeadlessInput.h"
+
+#include <utility>
+
+namespace GravityFun
+{
+    HeadlessInput::HeadlessInput(int width, int height)
+        : Width(width), Height(height), MousePosition({0, 0}),
+          MouseLeftButton(false), MouseRightButton(false), MouseMiddleButton(false),
+          MaxUpdatesCount(0), UpdatesCount(0), Closed(false)
+    {
+    }
+
+    void HeadlessInput::SetSize(int width, int height)
+    {
+        Width = width;
+        Height = height;
+    }
+
+    void HeadlessInput::SetMousePosition(double x, double y)
+    {
+        MousePosition = { x, y };
+    }
+
+    void HeadlessInput::SetMouseButtons(bool left, bool right, bool middle)
+    {
+        MouseLeftButton = left;
+        MouseRightButton = right;
+        MouseMiddleButton = middle;
+    }
+
+    void HeadlessInput::PressKey(int key)
+    {
+        NextPressedKeys.insert(key);
+    }
+
+    void HeadlessInput::SetMaxUpdatesCount(long long count)
+    {
+        MaxUpdatesCount = count;
+    }
+
+    long long HeadlessInput::GetUpdatesCount()
+    {
+        return UpdatesCount;
+    }
+
+    void HeadlessInput::GetSize(int& width, int& height)
+    {
+        width = Width;
+        height = Height;
+    }
+
+    std::tuple<double, double> HeadlessInput::GetMousePosition() { return MousePosition; }
+    bool HeadlessInput::GetMouseLeftButton() { return MouseLeftButton; }
+    bool HeadlessInput::GetMouseRightButton() { return MouseRightButton; }
+    bool HeadlessInput::GetMouseMiddleButton() { return MouseMiddleButton; }
+    const KeySet& HeadlessInput::GetPressedKeys() { return PressedKeys; }
+    const KeySet& HeadlessInput::GetReleasedKeys() { return ReleasedKeys; }
+    const KeySet& HeadlessInput::GetRepeatedKeys() { return RepeatedKeys; }
+
+    void HeadlessInput::Update()
+    {
+        PressedKeys.clear();
+        std::swap(PressedKeys, NextPressedKeys);
+        UpdatesCount++;
+    }
+
+    bool HeadlessInput::ShouldClose()
+    {
+        return Closed || (MaxUpdatesCount != 0 && UpdatesCount + 1 >= MaxUpdatesCount);
+    }
+
+    void HeadlessInput::Close()
+    {
+        Closed = true;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "GravityFun.dec.h"
+
+#include "InputSource.h"
+
+#include <atomic>
+#include <tuple>
+
+namespace GravityFun
+{
+    /// @brief A stand-in for the Window without GLFW, with a fixed size and the input set by the owner.
+    class HeadlessInput final : public InputSource
+    {
+    public:
+        explicit HeadlessInput(int width = 640, int height = 480);
+
+        HeadlessInput(const HeadlessInput&) = delete;
+        HeadlessInput(HeadlessInput&&) = delete;
+        HeadlessInput& operator=(const HeadlessInput&) = delete;
+        HeadlessInput& operator=(HeadlessInput&&) = delete;
+
+        /// @brief Must not be called while GameManager is running, like the other setters.
+        void SetSize(int width, int height);
+        void SetMousePosition(double x, double y);
+        void SetMouseButtons(bool left, bool right, bool middle);
+        /// @brief The key is in the pressed keys after the next Update call only.
+        void PressKey(int key);
+        /// @brief Limits the Update calls of a loop to this many, 0 for no limit.
+        ///        As a loop finishes the iteration where ShouldClose() returns true,
+        ///        it returns true when the next Update call is the last one.
+        void SetMaxUpdatesCount(long long count);
+        /// @brief Thread-safe.
+        long long GetUpdatesCount();
+
+        void GetSize(int& width, int& height) override;
+        std::tuple<double, double> GetMousePosition() override;
+        bool GetMouseLeftButton() override;
+        bool GetMouseRightButton() override;
+        bool GetMouseMiddleButton() override;
+        const KeySet& GetPressedKeys() override;
+        const KeySet& GetReleasedKeys() override;
+        const KeySet& GetRepeatedKeys() override;
+        void Update() override;
+        bool ShouldClose() override;
+        /// @brief Thread-safe.
+        void Close();
+    private:
+        int Width;
+        int Height;
+        std::tuple<double, double> MousePosition;
+        bool MouseLeftButton;
+        bool MouseRightButton;
+        bool MouseMiddleButton;
+        /// @brief Moved to PressedKeys by Update.
+        KeySet NextPressedKeys;
+        KeySet PressedKeys;
+        KeySet ReleasedKeys;
+        KeySet RepeatedKeys;
+        long long MaxUpdatesCount;
+        std::atomic<long long> UpdatesCount;
+        std::atomic<bool> Closed;
+    };
+}
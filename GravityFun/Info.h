@@ -16,10 +16,13 @@ namespace GravityFun::Info
         R or 2: Switch between relative force modes
             Q or 0: Set relative force mode to off
             W or 9: Set relative force mode to inward (pulling, like gravity)
-            E or 8: Set relative force mode to outward (pushing, like fluids)
+            E or 8: Set relative force mode to outward (a fluid that replaces object collisions)
         M or 3: Toggle variable mass (when adding objects)
         B or 4: Toggle border collision
+        U: Toggle unbounded world (objects move freely beyond the borders)
         C or 5: Toggle object to object collision
+        A or 7: Toggle merging colliding objects (conserving mass and momentum)
+        S: Toggle species interactions (each species pulls or pushes the others differently), replacing the relative force mode
         Up/Down: Add/remove objects
         Left/Right: Decrease/increase time multiplier (simulation speed)
             Possible time multiplier values: 0.125x, 0.25x, 0.5x, 1x, 2x, 4x, 8x
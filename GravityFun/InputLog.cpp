@@ -0,0 +1,371 @@
+#include "InputLog.h"
+
+#include "GameManager.h"
+
+#include <cstring>
+
+namespace GravityFun
+{
+    // The log is the magic, the version, the header (seed, time diff, objects count, scenario, concurrency,
+    // and the world config entries), and the size at the start, which the objects are generated for,
+    // followed by the records. Each record is the step difference from the previous record, the flags,
+    // and the changed values in the order of the flags. The integers are unsigned LEB128 varints,
+    // the doubles are little-endian IEEE 754, and the strings are their lengths followed by their bytes.
+
+    constexpr char INPUT_LOG_MAGIC[4] = { 'G', 'F', 'I', 'L' };
+    constexpr std::uint8_t INPUT_LOG_VERSION = 2;
+
+    constexpr std::uint8_t RECORD_SIZE = 1;
+    constexpr std::uint8_t RECORD_MOUSE_POSITION = 2;
+    constexpr std::uint8_t RECORD_MOUSE_BUTTONS = 4;
+    constexpr std::uint8_t RECORD_PRESSED_KEYS = 8;
+    constexpr std::uint8_t RECORD_RELEASED_KEYS = 16;
+    constexpr std::uint8_t RECORD_REPEATED_KEYS = 32;
+    /// @brief The last record, with only the step.
+    constexpr std::uint8_t RECORD_END = 128;
+
+    inline void write_varint(std::vector<std::uint8_t>& data, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back((std::uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        data.push_back((std::uint8_t)value);
+    }
+
+    inline void write_double(std::vector<std::uint8_t>& data, double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; i++)
+            data.push_back((std::uint8_t)(bits >> (8 * i)));
+    }
+
+    inline void write_string(std::vector<std::uint8_t>& data, const std::string& value)
+    {
+        write_varint(data, value.size());
+        data.insert(data.end(), value.begin(), value.end());
+    }
+
+    inline void write_keys(std::vector<std::uint8_t>& data, const KeySet& keys)
+    {
+        write_varint(data, keys.size());
+        for (int key : keys)
+            write_varint(data, key);
+    }
+
+    inline bool read_varint(const std::vector<std::uint8_t>& data, std::size_t& position, std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < data.size(); shift += 7)
+        {
+            std::uint8_t byte = data[position++];
+            value |= (std::uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    inline bool read_double(const std::vector<std::uint8_t>& data, std::size_t& position, double& value)
+    {
+        if (data.size() - position < 8)
+            return false;
+        std::uint64_t bits = 0;
+        for (int i = 0; i < 8; i++)
+            bits |= (std::uint64_t)data[position++] << (8 * i);
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+
+    inline bool read_string(const std::vector<std::uint8_t>& data, std::size_t& position, std::string& value)
+    {
+        std::uint64_t length;
+        if (!read_varint(data, position, length) || data.size() - position < length)
+            return false;
+        value.assign(data.begin() + position, data.begin() + position + length);
+        position += length;
+        return true;
+    }
+
+    inline bool read_keys(const std::vector<std::uint8_t>& data, std::size_t& position, KeySet& keys)
+    {
+        std::uint64_t count, key;
+        if (!read_varint(data, position, count))
+            return false;
+        for (std::uint64_t i = 0; i < count; i++)
+        {
+            if (!read_varint(data, position, key))
+                return false;
+            keys.insert((int)key);
+        }
+        return true;
+    }
+
+    InputRecorder::InputRecorder(std::shared_ptr<InputSource> source)
+        : Source(source), _GameManager(nullptr), LastStep(0), LastWidth(-1), LastHeight(-1),
+          LastMousePosition({0, 0}), LastMouseButtons(0)
+    {
+    }
+
+    InputRecorder::~InputRecorder()
+    {
+        Close();
+    }
+
+    bool InputRecorder::Open(const std::string& filename, const InputLogHeader& header, GameManager * game_manager)
+    {
+        _GameManager = game_manager;
+        File.open(filename, std::ios::binary | std::ios::trunc);
+        Record.assign(std::begin(INPUT_LOG_MAGIC), std::end(INPUT_LOG_MAGIC));
+        Record.push_back(INPUT_LOG_VERSION);
+        write_varint(Record, header.Seed);
+        write_double(Record, header.TimeDiff);
+        write_varint(Record, header.ObjectsCount);
+        Record.push_back((std::uint8_t)header.ScenarioKind);
+        write_varint(Record, header.Concurrency);
+        write_varint(Record, header.WorldConfig.size());
+        for (const auto& entry : header.WorldConfig)
+        {
+            write_string(Record, entry.first);
+            write_string(Record, entry.second);
+        }
+        Source->GetSize(LastWidth, LastHeight);
+        write_varint(Record, LastWidth);
+        write_varint(Record, LastHeight);
+        File.write((const char *)Record.data(), Record.size());
+        // The steps are counted from the start of the run, like in the replays
+        LastStep = 0;
+        if (!File)
+        {
+            File.close();
+            return false;
+        }
+        return true;
+    }
+
+    void InputRecorder::Close()
+    {
+        if (!File.is_open())
+            return;
+        Record.clear();
+        write_varint(Record, _GameManager->GetStepsCount() - LastStep);
+        Record.push_back(RECORD_END);
+        File.write((const char *)Record.data(), Record.size());
+        File.close();
+    }
+
+    void InputRecorder::GetSize(int& width, int& height) { Source->GetSize(width, height); }
+    std::tuple<double, double> InputRecorder::GetMousePosition() { return Source->GetMousePosition(); }
+    bool InputRecorder::GetMouseLeftButton() { return Source->GetMouseLeftButton(); }
+    bool InputRecorder::GetMouseRightButton() { return Source->GetMouseRightButton(); }
+    bool InputRecorder::GetMouseMiddleButton() { return Source->GetMouseMiddleButton(); }
+    const KeySet& InputRecorder::GetPressedKeys() { return Source->GetPressedKeys(); }
+    const KeySet& InputRecorder::GetReleasedKeys() { return Source->GetReleasedKeys(); }
+    const KeySet& InputRecorder::GetRepeatedKeys() { return Source->GetRepeatedKeys(); }
+    bool InputRecorder::ShouldClose() { return Source->ShouldClose(); }
+
+    void InputRecorder::Update()
+    {
+        Source->Update();
+        if (!File.is_open())
+            return;
+
+        int width, height;
+        Source->GetSize(width, height);
+        auto mouse_position = Source->GetMousePosition();
+        std::uint8_t mouse_buttons = (Source->GetMouseLeftButton() ? 1 : 0)
+            | (Source->GetMouseRightButton() ? 2 : 0)
+            | (Source->GetMouseMiddleButton() ? 4 : 0);
+        std::uint8_t flags = 0;
+        if (width != LastWidth || height != LastHeight)
+            flags |= RECORD_SIZE;
+        if (mouse_position != LastMousePosition)
+            flags |= RECORD_MOUSE_POSITION;
+        if (mouse_buttons != LastMouseButtons)
+            flags |= RECORD_MOUSE_BUTTONS;
+        // The keys are events of one update, so they are recorded whenever there are any
+        if (!Source->GetPressedKeys().empty())
+            flags |= RECORD_PRESSED_KEYS;
+        if (!Source->GetReleasedKeys().empty())
+            flags |= RECORD_RELEASED_KEYS;
+        if (!Source->GetRepeatedKeys().empty())
+            flags |= RECORD_REPEATED_KEYS;
+        if (flags == 0)
+            return;
+
+        long long step = _GameManager->GetStepsCount();
+        Record.clear();
+        write_varint(Record, step - LastStep);
+        Record.push_back(flags);
+        if (flags & RECORD_SIZE)
+        {
+            write_varint(Record, width);
+            write_varint(Record, height);
+        }
+        if (flags & RECORD_MOUSE_POSITION)
+        {
+            write_double(Record, std::get<0>(mouse_position));
+            write_double(Record, std::get<1>(mouse_position));
+        }
+        if (flags & RECORD_MOUSE_BUTTONS)
+            Record.push_back(mouse_buttons);
+        if (flags & RECORD_PRESSED_KEYS)
+            write_keys(Record, Source->GetPressedKeys());
+        if (flags & RECORD_RELEASED_KEYS)
+            write_keys(Record, Source->GetReleasedKeys());
+        if (flags & RECORD_REPEATED_KEYS)
+            write_keys(Record, Source->GetRepeatedKeys());
+        File.write((const char *)Record.data(), Record.size());
+
+        LastStep = step;
+        LastWidth = width;
+        LastHeight = height;
+        LastMousePosition = mouse_position;
+        LastMouseButtons = mouse_buttons;
+    }
+
+    InputReplayer::InputReplayer(std::shared_ptr<InputSource> source)
+        : Source(source), _GameManager(nullptr), Header{ 0, 0, 0, Scenario::Kind::Scattered, 1, {} },
+          Position(0), NextStep(0), NextFlags(RECORD_END), Width(0), Height(0), MousePosition({0, 0}),
+          MouseLeftButton(false), MouseRightButton(false), MouseMiddleButton(false)
+    {
+    }
+
+    bool InputReplayer::Open(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        Position = 0;
+        NextStep = 0;
+        NextFlags = RECORD_END;
+        if (Data.size() < sizeof(INPUT_LOG_MAGIC) + 1
+            || std::memcmp(Data.data(), INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC)) != 0
+            || Data[sizeof(INPUT_LOG_MAGIC)] != INPUT_LOG_VERSION)
+            return false;
+        Position = sizeof(INPUT_LOG_MAGIC) + 1;
+        std::uint64_t seed, objects_count, concurrency, entries_count, width, height;
+        if (!read_varint(Data, Position, seed)
+            || !read_double(Data, Position, Header.TimeDiff)
+            || !read_varint(Data, Position, objects_count)
+            || Position == Data.size()
+            || Data[Position] >= Scenario::KINDS.size())
+            return false;
+        Header.Seed = (unsigned int)seed;
+        Header.ObjectsCount = (int)objects_count;
+        Header.ScenarioKind = (Scenario::Kind)Data[Position++];
+        if (!read_varint(Data, Position, concurrency) || !read_varint(Data, Position, entries_count))
+            return false;
+        Header.Concurrency = (int)concurrency;
+        Header.WorldConfig.clear();
+        for (std::uint64_t i = 0; i < entries_count; i++)
+        {
+            std::pair<std::string, std::string> entry;
+            if (!read_string(Data, Position, entry.first) || !read_string(Data, Position, entry.second))
+                return false;
+            Header.WorldConfig.push_back(std::move(entry));
+        }
+        if (!read_varint(Data, Position, width) || !read_varint(Data, Position, height))
+            return false;
+        Width = (int)width;
+        Height = (int)height;
+        return ReadNextRecordStart();
+    }
+
+    const InputLogHeader& InputReplayer::GetHeader()
+    {
+        return Header;
+    }
+
+    void InputReplayer::SetGameManager(GameManager * game_manager)
+    {
+        _GameManager = game_manager;
+    }
+
+    void InputReplayer::GetSize(int& width, int& height)
+    {
+        width = Width;
+        height = Height;
+    }
+
+    std::tuple<double, double> InputReplayer::GetMousePosition() { return MousePosition; }
+    bool InputReplayer::GetMouseLeftButton() { return MouseLeftButton; }
+    bool InputReplayer::GetMouseRightButton() { return MouseRightButton; }
+    bool InputReplayer::GetMouseMiddleButton() { return MouseMiddleButton; }
+    const KeySet& InputReplayer::GetPressedKeys() { return PressedKeys; }
+    const KeySet& InputReplayer::GetReleasedKeys() { return ReleasedKeys; }
+    const KeySet& InputReplayer::GetRepeatedKeys() { return RepeatedKeys; }
+
+    void InputReplayer::Update()
+    {
+        if (Source)
+            Source->Update();
+        PressedKeys.clear();
+        ReleasedKeys.clear();
+        RepeatedKeys.clear();
+        if ((NextFlags & RECORD_END) || _GameManager->GetStepsCount() < NextStep)
+            return;
+
+        // One record per update, so the keys of records with the same step are not merged
+        bool valid = true;
+        if (NextFlags & RECORD_SIZE)
+        {
+            std::uint64_t width = 0, height = 0;
+            valid = read_varint(Data, Position, width) && read_varint(Data, Position, height);
+            if (valid)
+            {
+                Width = (int)width;
+                Height = (int)height;
+            }
+        }
+        if (valid && (NextFlags & RECORD_MOUSE_POSITION))
+        {
+            double x = 0, y = 0;
+            valid = read_double(Data, Position, x) && read_double(Data, Position, y);
+            if (valid)
+                MousePosition = { x, y };
+        }
+        if (valid && (NextFlags & RECORD_MOUSE_BUTTONS))
+        {
+            valid = Position < Data.size();
+            if (valid)
+            {
+                std::uint8_t mouse_buttons = Data[Position++];
+                MouseLeftButton = mouse_buttons & 1;
+                MouseRightButton = mouse_buttons & 2;
+                MouseMiddleButton = mouse_buttons & 4;
+            }
+        }
+        if (valid && (NextFlags & RECORD_PRESSED_KEYS))
+            valid = read_keys(Data, Position, PressedKeys);
+        if (valid && (NextFlags & RECORD_RELEASED_KEYS))
+            valid = read_keys(Data, Position, ReleasedKeys);
+        if (valid && (NextFlags & RECORD_REPEATED_KEYS))
+            valid = read_keys(Data, Position, RepeatedKeys);
+        if (!valid || !ReadNextRecordStart())
+            NextFlags = RECORD_END; // Ends at the last valid record
+    }
+
+    bool InputReplayer::ShouldClose()
+    {
+        return (Source && Source->ShouldClose())
+            || ((NextFlags & RECORD_END) && _GameManager->GetStepsCount() + 1 >= NextStep);
+    }
+
+    bool InputReplayer::ReadNextRecordStart()
+    {
+        if (Position == Data.size())
+        {
+            // Cut off without an end, like a crashed recording
+            NextFlags = RECORD_END;
+            return true;
+        }
+        std::uint64_t step_diff;
+        if (!read_varint(Data, Position, step_diff) || Position == Data.size())
+            return false;
+        NextStep += step_diff;
+        NextFlags = Data[Position++];
+        return true;
+    }
+}
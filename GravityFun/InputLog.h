@@ -0,0 +1,134 @@
+#pragma once
+
+#include "GravityFun.dec.h"
+
+#include "InputSource.h"
+#include "Scenario.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief The settings that a replay starts with, so it repeats the recorded run.
+    struct InputLogHeader
+    {
+        unsigned int Seed;
+        /// @brief The fixed time diff, or 0 for the real time.
+        double TimeDiff;
+        int ObjectsCount;
+        Scenario::Kind ScenarioKind;
+        /// @brief The number of physics modules of each pass, which the trajectories depend on.
+        int Concurrency;
+        /// @brief The entries of the config that ApplyWorldConfig applied, from GetWorldConfigEntries.
+        std::vector<std::pair<std::string, std::string>> WorldConfig;
+    };
+
+    /// @brief Records the input of another input source with the physics steps count at each Update call
+    ///        to a compact binary log, where only the changes are written.
+    class InputRecorder final : public InputSource
+    {
+    public:
+        explicit InputRecorder(std::shared_ptr<InputSource> source);
+        /// @brief Closes the log if it is open.
+        ~InputRecorder() override;
+
+        InputRecorder(const InputRecorder&) = delete;
+        InputRecorder(InputRecorder&&) = delete;
+        InputRecorder& operator=(const InputRecorder&) = delete;
+        InputRecorder& operator=(InputRecorder&&) = delete;
+
+        /// @brief MUST be called before running to record, else the input is only passed through.
+        ///        The game manager is not a smart pointer as it owns this.
+        /// @return Whether the file could be written.
+        bool Open(const std::string& filename, const InputLogHeader& header, GameManager * game_manager);
+        /// @brief Ends the log with the current steps count, which is where the replays close.
+        void Close();
+
+        void GetSize(int& width, int& height) override;
+        std::tuple<double, double> GetMousePosition() override;
+        bool GetMouseLeftButton() override;
+        bool GetMouseRightButton() override;
+        bool GetMouseMiddleButton() override;
+        const KeySet& GetPressedKeys() override;
+        const KeySet& GetReleasedKeys() override;
+        const KeySet& GetRepeatedKeys() override;
+        void Update() override;
+        bool ShouldClose() override;
+    private:
+        std::shared_ptr<InputSource> Source;
+        GameManager * _GameManager;
+        std::ofstream File;
+        long long LastStep;
+        int LastWidth;
+        int LastHeight;
+        std::tuple<double, double> LastMousePosition;
+        std::uint8_t LastMouseButtons;
+        std::vector<std::uint8_t> Record;
+    };
+
+    /// @brief Feeds the input of a log that InputRecorder wrote back at the recorded physics steps.
+    ///        With the header's settings, including the concurrency and the world config, and a fixed time diff,
+    ///        the headless replays of a log (one physics step per update) have bit-identical trajectories.
+    ///        Windowed replays run a varying number of steps per update,
+    ///        so each input is applied at the first update at or after its step.
+    class InputReplayer final : public InputSource
+    {
+    public:
+        /// @param source Updated along, and closes the replay early if it should close, like a Window. Can be nullptr.
+        explicit InputReplayer(std::shared_ptr<InputSource> source = nullptr);
+
+        InputReplayer(const InputReplayer&) = delete;
+        InputReplayer(InputReplayer&&) = delete;
+        InputReplayer& operator=(const InputReplayer&) = delete;
+        InputReplayer& operator=(InputReplayer&&) = delete;
+
+        /// @brief Reads the whole log.
+        /// @return Whether the file is a valid log.
+        bool Open(const std::string& filename);
+        const InputLogHeader& GetHeader();
+        /// @brief MUST be called before running.
+        ///        The game manager is not a smart pointer as it owns this.
+        void SetGameManager(GameManager * game_manager);
+
+        void GetSize(int& width, int& height) override;
+        std::tuple<double, double> GetMousePosition() override;
+        bool GetMouseLeftButton() override;
+        bool GetMouseRightButton() override;
+        bool GetMouseMiddleButton() override;
+        const KeySet& GetPressedKeys() override;
+        const KeySet& GetReleasedKeys() override;
+        const KeySet& GetRepeatedKeys() override;
+        /// @brief Applies the next record if its step has been reached.
+        void Update() override;
+        /// @brief Returns true when the next physics step is the last recorded one.
+        bool ShouldClose() override;
+    private:
+        std::shared_ptr<InputSource> Source;
+        GameManager * _GameManager;
+        InputLogHeader Header;
+        std::vector<std::uint8_t> Data;
+        /// @brief The position of the next record in Data.
+        std::size_t Position;
+        /// @brief The step of the next record, or of the end.
+        long long NextStep;
+        std::uint8_t NextFlags;
+        int Width;
+        int Height;
+        std::tuple<double, double> MousePosition;
+        bool MouseLeftButton;
+        bool MouseRightButton;
+        bool MouseMiddleButton;
+        KeySet PressedKeys;
+        KeySet ReleasedKeys;
+        KeySet RepeatedKeys;
+
+        /// @brief Reads the step and flags of the next record.
+        bool ReadNextRecordStart();
+    };
+}
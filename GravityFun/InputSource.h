@@ -0,0 +1,33 @@
+#pragma once
+
+#include "GravityFun.dec.h"
+
+#include "KeySet.h"
+
+#include <tuple>
+
+namespace GravityFun
+{
+    /// @brief The input and the domain size that GameManager is controlled by, a Window or a stand-in.
+    ///        The keys are GLFW key codes.
+    class InputSource
+    {
+    public:
+        virtual ~InputSource() = default;
+
+        /// @brief The size that the aspect ratio and the mouse position are relative to.
+        virtual void GetSize(int& width, int& height) = 0;
+        /// @return In the size's coordinates, from the top left.
+        virtual std::tuple<double, double> GetMousePosition() = 0;
+        virtual bool GetMouseLeftButton() = 0;
+        virtual bool GetMouseRightButton() = 0;
+        virtual bool GetMouseMiddleButton() = 0;
+        /// @brief The keys pressed before the last Update call.
+        virtual const KeySet& GetPressedKeys() = 0;
+        virtual const KeySet& GetReleasedKeys() = 0;
+        virtual const KeySet& GetRepeatedKeys() = 0;
+        /// @brief Takes the input since the last call.
+        virtual void Update() = 0;
+        virtual bool ShouldClose() = 0;
+    };
+}
@@ -0,0 +1,221 @@
+#include "Json.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+namespace GravityFun
+{
+    class Json::Parser final
+    {
+    public:
+        explicit Parser(const std::string& text) : Text(text), Position(0) {}
+
+        bool ParseDocument(Json& value)
+        {
+            if (!ParseValue(value))
+                return false;
+            SkipWhitespace();
+            return Position == Text.length();
+        }
+    private:
+        const std::string& Text;
+        std::size_t Position;
+
+        void SkipWhitespace()
+        {
+            while (Position < Text.length() && std::isspace((unsigned char)Text[Position]))
+                Position++;
+        }
+
+        bool Consume(char c)
+        {
+            SkipWhitespace();
+            if (Position < Text.length() && Text[Position] == c)
+            {
+                Position++;
+                return true;
+            }
+            return false;
+        }
+
+        bool ConsumeWord(const char * word)
+        {
+            std::size_t length = std::char_traits<char>::length(word);
+            if (Text.compare(Position, length, word) != 0)
+                return false;
+            Position += length;
+            return true;
+        }
+
+        bool ParseValue(Json& value)
+        {
+            SkipWhitespace();
+            if (Position == Text.length())
+                return false;
+            char c = Text[Position];
+            if (c == '{')
+                return ParseObject(value);
+            if (c == '[')
+                return ParseArray(value);
+            if (c == '"')
+            {
+                value._Type = Type::String;
+                return ParseString(value.String);
+            }
+            if (ConsumeWord("true") || ConsumeWord("false"))
+            {
+                value._Type = Type::Boolean;
+                value.Boolean = c == 't';
+                return true;
+            }
+            if (ConsumeWord("null"))
+            {
+                value._Type = Type::Null;
+                return true;
+            }
+            const char * start = Text.c_str() + Position;
+            char * end;
+            value.Number = std::strtod(start, &end);
+            if (end == start)
+                return false;
+            value._Type = Type::Number;
+            Position += end - start;
+            return true;
+        }
+
+        bool ParseString(std::string& result)
+        {
+            if (!Consume('"'))
+                return false;
+            result.clear();
+            while (Position < Text.length())
+            {
+                char c = Text[Position++];
+                if (c == '"')
+                    return true;
+                if (c != '\\')
+                {
+                    result.push_back(c);
+                    continue;
+                }
+                if (Position == Text.length())
+                    return false;
+                switch (char escaped = Text[Position++])
+                {
+                case 'n': result.push_back('\n'); break;
+                case 't': result.push_back('\t'); break;
+                case 'r': result.push_back('\r'); break;
+                case 'b': result.push_back('\b'); break;
+                case 'f': result.push_back('\f'); break;
+                case 'u':
+                {
+                    // Only the ASCII range is kept, the tools write nothing else
+                    if (Position + 4 > Text.length())
+                        return false;
+                    int code = std::strtol(Text.substr(Position, 4).c_str(), nullptr, 16);
+                    Position += 4;
+                    result.push_back(code < 128 ? (char)code : '?');
+                    break;
+                }
+                default: result.push_back(escaped); break;
+                }
+            }
+            return false;
+        }
+
+        bool ParseArray(Json& value)
+        {
+            value._Type = Type::Array;
+            Consume('[');
+            if (Consume(']'))
+                return true;
+            do
+            {
+                value.Array.emplace_back();
+                if (!ParseValue(value.Array.back()))
+                    return false;
+            } while (Consume(','));
+            return Consume(']');
+        }
+
+        bool ParseObject(Json& value)
+        {
+            value._Type = Type::Object;
+            Consume('{');
+            if (Consume('}'))
+                return true;
+            do
+            {
+                std::string key;
+                SkipWhitespace();
+                if (!ParseString(key) || !Consume(':') || !ParseValue(value.Object[key]))
+                    return false;
+            } while (Consume(','));
+            return Consume('}');
+        }
+    };
+
+    Json::Json() : _Type(Type::Null), Boolean(false), Number(0)
+    {
+    }
+
+    std::optional<Json> Json::Parse(const std::string& text)
+    {
+        Json value;
+        Parser parser(text);
+        if (!parser.ParseDocument(value))
+            return std::nullopt;
+        return value;
+    }
+
+    std::string Json::Quote(const std::string& text)
+    {
+        std::string result = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                result.push_back('\\');
+                result.push_back(c);
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                result += escaped;
+            }
+            else
+            {
+                result.push_back(c);
+            }
+        }
+        result.push_back('"');
+        return result;
+    }
+
+    Json::Type Json::GetType() const { return _Type; }
+    bool Json::GetBoolean() const { return Boolean; }
+    double Json::GetNumber() const { return Number; }
+    const std::string& Json::GetString() const { return String; }
+    const std::vector<Json>& Json::GetArray() const { return Array; }
+    const std::map<std::string, Json>& Json::GetObject() const { return Object; }
+
+    const Json * Json::Get(const std::string& key) const
+    {
+        auto i = Object.find(key);
+        return i == Object.end() ? nullptr : &i->second;
+    }
+
+    double Json::GetNumber(const std::string& key, double default_value) const
+    {
+        auto value = Get(key);
+        return value != nullptr && value->_Type == Type::Number ? value->Number : default_value;
+    }
+
+    std::string Json::GetString(const std::string& key, const std::string& default_value) const
+    {
+        auto value = Get(key);
+        return value != nullptr && value->_Type == Type::String ? value->String : default_value;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief A parsed JSON value, for reading the files that the tools write.
+    class Json final
+    {
+    public:
+        enum class Type { Null, Boolean, Number, String, Array, Object };
+
+        Json();
+
+        /// @return The value, or std::nullopt if the text is not valid JSON.
+        static std::optional<Json> Parse(const std::string& text);
+        /// @return The text in quotes, escaped.
+        static std::string Quote(const std::string& text);
+
+        Type GetType() const;
+        bool GetBoolean() const;
+        double GetNumber() const;
+        const std::string& GetString() const;
+        const std::vector<Json>& GetArray() const;
+        const std::map<std::string, Json>& GetObject() const;
+        /// @return The member of an object, or nullptr if it is not an object or has no such member.
+        const Json * Get(const std::string& key) const;
+        /// @return The number member of an object, or the default value.
+        double GetNumber(const std::string& key, double default_value) const;
+        /// @return The string member of an object, or the default value.
+        std::string GetString(const std::string& key, const std::string& default_value) const;
+    private:
+        Type _Type;
+        bool Boolean;
+        double Number;
+        std::string String;
+        std::vector<Json> Array;
+        std::map<std::string, Json> Object;
+
+        class Parser;
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Only for the key codes
+#define GLFW_INCLUDE_NONE
+#include "../glfw/include/GLFW/glfw3.h"
+
+#include <bitset>
+#include <cstddef>
+#include <iterator>
+
+namespace GravityFun
+{
+    /// @brief A set of GLFW key codes in a bitset, so clearing and filling it never allocates,
+    ///        with the part of the std::set interface that the input sources use.
+    ///        The codes outside [0, GLFW_KEY_LAST], like GLFW_KEY_UNKNOWN, are ignored.
+    class KeySet final
+    {
+    public:
+        static constexpr int CAPACITY = GLFW_KEY_LAST + 1;
+
+        /// @brief Visits the keys in ascending order.
+        class Iterator final
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = int;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const int *;
+            using reference = int;
+
+            Iterator(const KeySet * set, int key) : Set(set), Key(key) { SkipAbsent(); }
+
+            int operator*() const { return Key; }
+            Iterator& operator++() { Key++; SkipAbsent(); return *this; }
+            Iterator operator++(int) { Iterator temp = *this; ++*this; return temp; }
+            bool operator==(const Iterator& other) const { return Key == other.Key; }
+            bool operator!=(const Iterator& other) const { return Key != other.Key; }
+        private:
+            const KeySet * Set;
+            int Key;
+
+            void SkipAbsent()
+            {
+                while (Key < CAPACITY && !Set->Keys[Key])
+                    Key++;
+            }
+        };
+
+        bool contains(int key) const { return key >= 0 && key < CAPACITY && Keys[key]; }
+        void insert(int key) { if (key >= 0 && key < CAPACITY) Keys[key] = true; }
+        void erase(int key) { if (key >= 0 && key < CAPACITY) Keys[key] = false; }
+        void clear() { Keys.reset(); }
+        bool empty() const { return Keys.none(); }
+        std::size_t size() const { return Keys.count(); }
+        Iterator begin() const { return Iterator(this, 0); }
+        Iterator end() const { return Iterator(this, CAPACITY); }
+    private:
+        std::bitset<CAPACITY> Keys;
+    };
+}
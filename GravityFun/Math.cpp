@@ -1,7 +1,7 @@
 #include "Math.h"
 
+#include <algorithm>
 #include <cmath>
-#include <utility>
 
 namespace GravityFun::Math
 {
@@ -66,19 +66,13 @@ namespace GravityFun::Math
     {
         for (int column = 0; column < 4; column++)
             for (int row = 0; row < 4; row++)
-                Data.push_back(row == column ? 1 : 0);
+                Set(row, column, row == column ? 1 : 0);
     }
 
-    Matrix4x4::Matrix4x4(std::vector<float> column_major_vector)
+    Matrix4x4::Matrix4x4(std::vector<float> column_major_vector) : Matrix4x4()
     {
         if (column_major_vector.size() == 16)
-        {
-            Data = std::move(column_major_vector);
-            return;
-        }
-        for (int i = 0; i < 4; i++)
-            for (int j = 0; j < 4; j++)
-                Data.push_back(i == j ? 1 : 0);
+            std::copy(column_major_vector.begin(), column_major_vector.end(), Data.begin());
     }
 
     void Matrix4x4::Set(int row, int column, float value)
@@ -93,7 +87,7 @@ namespace GravityFun::Math
 
     Matrix4x4 Matrix4x4::operator*(const Matrix4x4& other) const
     {
-        std::vector<float> resulting_vector;
+        Matrix4x4 result;
         for (int column = 0; column < 4; column++)
         {
             for (int row = 0; row < 4; row++)
@@ -103,10 +97,10 @@ namespace GravityFun::Math
                 {
                     sum += Get(row, i) * other.Get(i, column);
                 }
-                resulting_vector.push_back(sum);
+                result.Set(row, column, sum);
             }
         }
-        return Matrix4x4(resulting_vector);
+        return result;
     }
 
     float * Matrix4x4::GetData()
@@ -116,141 +110,46 @@ namespace GravityFun::Math
 
     Matrix4x4 Matrix4x4::Scale(float x, float y, float z)
     {
-        std::vector<float> data;
-        for (int column = 0; column < 4; column++)
-        {
-            for (int row = 0; row < 4; row++)
-            {
-                if (row == column)
-                {
-                    switch (column)
-                    {
-                    case 0:
-                        data.push_back(x);
-                        break;
-                    case 1:
-                        data.push_back(y);
-                        break;
-                    case 2:
-                        data.push_back(z);
-                        break;
-                    case 3:
-                        data.push_back(1);
-                        break;
-                    }
-                }
-                else
-                    data.push_back(0);
-            }
-        }
-        return Matrix4x4(data);
+        Matrix4x4 result;
+        result.Set(0, 0, x);
+        result.Set(1, 1, y);
+        result.Set(2, 2, z);
+        return result;
     }
     Matrix4x4 Matrix4x4::RotationAroundX(float angle)
     {
-        std::vector<float> data;
-        for (int column = 0; column < 4; column++)
-        {
-            for (int row = 0; row < 4; row++)
-            {
-                if (column != 3 && row != 3 && column != 0 && row != 0)
-                {
-                    data.push_back(
-                        row == column ?
-                            std::cos(angle)
-                            : (
-                                row == 1 ?
-                                    -std::sin(angle)
-                                    : std::sin(angle)
-                            )
-                    );
-                }
-                else
-                    data.push_back(row == column ? 1 : 0);
-            }
-        }
-        return Matrix4x4(data);
+        Matrix4x4 result;
+        result.Set(1, 1, std::cos(angle));
+        result.Set(1, 2, -std::sin(angle));
+        result.Set(2, 1, std::sin(angle));
+        result.Set(2, 2, std::cos(angle));
+        return result;
     }
     Matrix4x4 Matrix4x4::RotationAroundY(float angle)
     {
-        std::vector<float> data;
-        for (int column = 0; column < 4; column++)
-        {
-            for (int row = 0; row < 4; row++)
-            {
-                if (column != 3 && row != 3 && column != 1 && row != 1)
-                {
-                    data.push_back(
-                        row == column ?
-                            std::cos(angle)
-                            : (
-                                row == 0 ?
-                                    std::sin(angle)
-                                    : -std::sin(angle)
-                            )
-                    );
-                }
-                else
-                    data.push_back(row == column ? 1 : 0);
-            }
-        }
-        return Matrix4x4(data);
+        Matrix4x4 result;
+        result.Set(0, 0, std::cos(angle));
+        result.Set(0, 2, std::sin(angle));
+        result.Set(2, 0, -std::sin(angle));
+        result.Set(2, 2, std::cos(angle));
+        return result;
     }
     Matrix4x4 Matrix4x4::RotationAroundZ(float angle)
     {
-        std::vector<float> data;
-        for (int column = 0; column < 4; column++)
-        {
-            for (int row = 0; row < 4; row++)
-            {
-                if (column != 3 && row != 3 && column != 2 && row != 2)
-                {
-                    data.push_back(
-                        row == column ?
-                            std::cos(angle)
-                            : (
-                                row == 0 ?
-                                    -std::sin(angle)
-                                    : std::sin(angle)
-                            )
-                    );
-                }
-                else
-                    data.push_back(row == column ? 1 : 0);
-            }
-        }
-        return Matrix4x4(data);
+        Matrix4x4 result;
+        result.Set(0, 0, std::cos(angle));
+        result.Set(0, 1, -std::sin(angle));
+        result.Set(1, 0, std::sin(angle));
+        result.Set(1, 1, std::cos(angle));
+        return result;
     }
     Matrix4x4 Matrix4x4::Translation(float x, float y, float z)
     {
-        std::vector<float> data;
-        for (int column = 0; column < 4; column++)
-        {
-            for (int row = 0; row < 4; row++)
-            {
-                if (row == column)
-                {
-                    data.push_back(1);
-                }
-                else if (column == 3)
-                {
-                    switch (row)
-                    {
-                    case 0:
-                        data.push_back(x);
-                        break;
-                    case 1:
-                        data.push_back(y);
-                        break;
-                    case 2:
-                        data.push_back(z);
-                        break;
-                    }
-                }
-                else
-                    data.push_back(0);
-            }
-        }
-        return Matrix4x4(data);
+        Matrix4x4 result;
+        result.Set(0, 3, x);
+        result.Set(1, 3, y);
+        result.Set(2, 3, z);
+        return result;
     }
     //Matrix4x4 Matrix4x4::Perspective()
     //{
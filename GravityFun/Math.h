@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
 namespace GravityFun::Math
@@ -45,6 +46,7 @@ namespace GravityFun::Math
         static Matrix4x4 Translation(float x, float y, float z);
         //static Matrix4x4 Perspective();
     private:
-        std::vector<float> Data;
+        /// @brief Column-major, in place so the matrices of a frame don't allocate.
+        std::array<float, 16> Data;
     };
 }
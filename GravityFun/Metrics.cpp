@@ -0,0 +1,160 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace GravityFun
+{
+    /// @return The value at the quantile of the values, which are reordered.
+    static double get_quantile(std::vector<double>& values, double quantile)
+    {
+        if (values.empty())
+            return 0;
+        auto index = (std::size_t)std::min((double)values.size() - 1, std::floor(quantile * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    /// @brief Adds to a slot that has a single writer at a time, so no read-modify-write is needed.
+    static void add(std::atomic<long long>& nanoseconds, std::chrono::steady_clock::duration duration)
+    {
+        nanoseconds.store(nanoseconds.load(std::memory_order_relaxed)
+            + std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+    }
+
+    Metrics::Scope::Scope(Metrics& metrics, Pass pass, int worker)
+        : Nanoseconds(metrics.WorkerSlots[(int)pass][worker].Nanoseconds), Begin(std::chrono::steady_clock::now())
+    {
+    }
+    Metrics::Scope::Scope(Metrics& metrics)
+        : Nanoseconds(metrics.SerialSlot.Nanoseconds), Begin(std::chrono::steady_clock::now())
+    {
+    }
+    Metrics::Scope::~Scope()
+    {
+        add(Nanoseconds, std::chrono::steady_clock::now() - Begin);
+    }
+
+    Metrics::Metrics()
+        : WorkersCount(0), LastSerialNanoseconds(0), SerialNanoseconds(0),
+          IntervalStartSteps(0), IntervalStartIdledTime(0), Started(false), SnapshotNumber(0)
+    {
+        // Up to 1000 frames per second
+        FrameTimes.reserve((std::size_t)(UPDATE_INTERVAL * 1000));
+    }
+
+    void Metrics::SetWorkersCount(int count)
+    {
+        if (count <= WorkersCount)
+            return;
+        for (int pass = 0; pass < PASSES_COUNT; pass++)
+        {
+            std::unique_ptr<Slot[]> slots(new Slot[count]);
+            for (int i = 0; i < WorkersCount; i++)
+                slots[i].Nanoseconds.store(WorkerSlots[pass][i].Nanoseconds.load());
+            WorkerSlots[pass] = std::move(slots);
+            LastWorkerNanoseconds[pass].resize(count, 0);
+            WorkerNanoseconds[pass].resize(count, 0);
+        }
+        WorkersCount = count;
+        _Snapshot.WorkerLoads.resize(count, 0);
+    }
+
+    void Metrics::AddWorkerTime(Pass pass, int worker, std::chrono::steady_clock::duration duration)
+    {
+        add(WorkerSlots[(int)pass][worker].Nanoseconds, duration);
+    }
+
+    void Metrics::AddSerialTime(std::chrono::steady_clock::duration duration)
+    {
+        add(SerialSlot.Nanoseconds, duration);
+    }
+
+    void Metrics::AddFrame(double frame_time)
+    {
+        if (FrameTimes.size() < FrameTimes.capacity())
+            FrameTimes.push_back(frame_time);
+    }
+
+    void Metrics::Update(long long steps_count, int objects_count, double idled_time, long long mapper_overflows_count)
+    {
+        // Collect the slots' growth since the last run
+        for (int pass = 0; pass < PASSES_COUNT; pass++)
+        {
+            for (int i = 0; i < WorkersCount; i++)
+            {
+                long long nanoseconds = WorkerSlots[pass][i].Nanoseconds.load(std::memory_order_relaxed);
+                WorkerNanoseconds[pass][i] += nanoseconds - LastWorkerNanoseconds[pass][i];
+                LastWorkerNanoseconds[pass][i] = nanoseconds;
+            }
+        }
+        long long serial_nanoseconds = SerialSlot.Nanoseconds.load(std::memory_order_relaxed);
+        SerialNanoseconds += serial_nanoseconds - LastSerialNanoseconds;
+        LastSerialNanoseconds = serial_nanoseconds;
+
+        auto now = std::chrono::steady_clock::now();
+        if (!Started)
+        {
+            Started = true;
+            IntervalStartTime = now;
+            IntervalStartSteps = steps_count;
+            IntervalStartIdledTime = idled_time;
+            return;
+        }
+        double duration = std::chrono::duration<double>(now - IntervalStartTime).count();
+        if (duration < UPDATE_INTERVAL)
+            return;
+
+        // Publish
+        long long steps = steps_count - IntervalStartSteps;
+        double steps_divisor = 1e9 * std::max(1LL, steps);
+        _Snapshot.StepsPerSecond = steps / duration;
+        _Snapshot.FramesPerSecond = FrameTimes.size() / duration;
+        _Snapshot.FrameTimeMedian = get_quantile(FrameTimes, 0.5);
+        _Snapshot.FrameTimeP95 = get_quantile(FrameTimes, 0.95);
+        _Snapshot.FrameTimeP99 = get_quantile(FrameTimes, 0.99);
+        _Snapshot.FramesCount += (long long)FrameTimes.size();
+        _Snapshot.FrameTimeSum = std::accumulate(FrameTimes.begin(), FrameTimes.end(), _Snapshot.FrameTimeSum);
+        for (int pass = 0; pass < PASSES_COUNT; pass++)
+            _Snapshot.PassTimes[pass] = WorkersCount == 0 ? 0
+                : *std::max_element(WorkerNanoseconds[pass].begin(), WorkerNanoseconds[pass].end()) / steps_divisor;
+        _Snapshot.SerialTime = SerialNanoseconds / steps_divisor;
+        long long max_load = 1;
+        long long total_load = 0;
+        for (int i = 0; i < WorkersCount; i++)
+        {
+            long long load = WorkerNanoseconds[(int)Pass::Physics1][i] + WorkerNanoseconds[(int)Pass::Physics2][i];
+            max_load = std::max(max_load, load);
+            total_load += load;
+        }
+        for (int i = 0; i < WorkersCount; i++)
+            _Snapshot.WorkerLoads[i] = (double)(WorkerNanoseconds[(int)Pass::Physics1][i]
+                + WorkerNanoseconds[(int)Pass::Physics2][i]) / max_load;
+        _Snapshot.WorkerImbalance = total_load == 0 ? 0 : (double)max_load * WorkersCount / total_load - 1;
+        _Snapshot.IdlingShare = std::clamp((idled_time - IntervalStartIdledTime) / duration, 0.0, 1.0);
+        _Snapshot.ObjectsCount = objects_count;
+        _Snapshot.StepsCount = steps_count;
+        _Snapshot.MapperOverflowsCount = mapper_overflows_count;
+        SnapshotNumber++;
+
+        // Next interval
+        for (int pass = 0; pass < PASSES_COUNT; pass++)
+            std::fill(WorkerNanoseconds[pass].begin(), WorkerNanoseconds[pass].end(), 0);
+        SerialNanoseconds = 0;
+        FrameTimes.clear();
+        IntervalStartTime = now;
+        IntervalStartSteps = steps_count;
+        IntervalStartIdledTime = idled_time;
+    }
+
+    const Metrics::Snapshot& Metrics::GetSnapshot()
+    {
+        return _Snapshot;
+    }
+
+    long long Metrics::GetSnapshotNumber()
+    {
+        return SnapshotNumber;
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief The performance metrics of the loop, collected in every build.
+    ///        Each worker adds its busy time to its own slot, and GameManager aggregates the slots
+    ///        once per run into a snapshot that is published every UPDATE_INTERVAL.
+    class Metrics final
+    {
+    public:
+        /// @brief The parallel passes that the workers' busy times are kept for.
+        enum class Pass { Physics1, Physics2, ContactSolving };
+        static constexpr int PASSES_COUNT = 3;
+        /// @brief In seconds.
+        static constexpr double UPDATE_INTERVAL = 0.5;
+
+        struct Snapshot
+        {
+            double StepsPerSecond = 0;
+            double FramesPerSecond = 0;
+            /// @brief The frame time percentiles in seconds.
+            double FrameTimeMedian = 0;
+            double FrameTimeP95 = 0;
+            double FrameTimeP99 = 0;
+            /// @brief The count and the total time in seconds of the measured frames since the start.
+            long long FramesCount = 0;
+            double FrameTimeSum = 0;
+            /// @brief The busy time of the slowest worker of each pass per step, in seconds.
+            std::array<double, PASSES_COUNT> PassTimes{};
+            /// @brief The time of GameManager and the notifiers per step, in seconds.
+            double SerialTime = 0;
+            /// @brief The busy time of each Physics worker in both passes relative to the busiest one.
+            std::vector<double> WorkerLoads;
+            /// @brief The busiest Physics worker's time over the average one's, minus 1. 0 when balanced.
+            double WorkerImbalance = 0;
+            /// @brief The share of the time that EnergySaver idled.
+            double IdlingShare = 0;
+            int ObjectsCount = 0;
+            long long StepsCount = 0;
+            /// @brief See ObjectMapper::GetOverflowsCount.
+            long long MapperOverflowsCount = 0;
+        };
+
+        /// @brief Adds the time from its construction to its destruction to a worker's slot, or to the serial slot.
+        class Scope final
+        {
+        public:
+            /// @brief See AddWorkerTime.
+            Scope(Metrics&, Pass, int worker);
+            /// @brief See AddSerialTime.
+            explicit Scope(Metrics&);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope(Scope&&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            Scope& operator=(Scope&&) = delete;
+        private:
+            std::atomic<long long>& Nanoseconds;
+            std::chrono::steady_clock::time_point Begin;
+        };
+
+        Metrics();
+
+        Metrics(const Metrics&) = delete;
+        Metrics(Metrics&&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+        Metrics& operator=(Metrics&&) = delete;
+
+        /// @brief MUST NOT be called while running. Only grows the slots.
+        void SetWorkersCount(int);
+        /// @brief Only called by the worker with this number, which never runs in parallel with itself.
+        void AddWorkerTime(Pass, int worker, std::chrono::steady_clock::duration);
+        /// @brief Called by the serial modules, which never run in parallel with each other.
+        void AddSerialTime(std::chrono::steady_clock::duration);
+        /// @brief MUST be called from the main thread, like Update.
+        /// @param frame_time The time since the last frame.
+        void AddFrame(double frame_time);
+        /// @brief Called once per GameManager run.
+        /// @param idled_time The total time that EnergySaver idled, in seconds.
+        void Update(long long steps_count, int objects_count, double idled_time, long long mapper_overflows_count);
+        /// @brief MUST be called from the main thread.
+        const Snapshot& GetSnapshot();
+        /// @brief Increases whenever a new snapshot is published. MUST be called from the main thread.
+        long long GetSnapshotNumber();
+    private:
+        /// @brief A cache line each, so the workers don't share lines.
+        struct alignas(64) Slot
+        {
+            std::atomic<long long> Nanoseconds{0};
+        };
+
+        int WorkersCount;
+        std::array<std::unique_ptr<Slot[]>, PASSES_COUNT> WorkerSlots;
+        Slot SerialSlot;
+
+        // Aggregated by Update, on the main thread
+
+        std::array<std::vector<long long>, PASSES_COUNT> LastWorkerNanoseconds;
+        std::array<std::vector<long long>, PASSES_COUNT> WorkerNanoseconds;
+        long long LastSerialNanoseconds;
+        long long SerialNanoseconds;
+        std::vector<double> FrameTimes;
+        std::chrono::steady_clock::time_point IntervalStartTime;
+        long long IntervalStartSteps;
+        double IntervalStartIdledTime;
+        bool Started;
+        Snapshot _Snapshot;
+        long long SnapshotNumber;
+    };
+}
@@ -0,0 +1,221 @@
+#include "MetricsServer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <psapi.h>
+using socket_type = SOCKET;
+constexpr socket_type INVALID_SOCKET_VALUE = INVALID_SOCKET;
+static void close_socket(socket_type socket) { closesocket(socket); }
+static int poll_sockets(pollfd * fds, int count, int timeout) { return WSAPoll(fds, count, timeout); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using socket_type = int;
+constexpr socket_type INVALID_SOCKET_VALUE = -1;
+static void close_socket(socket_type socket) { close(socket); }
+static int poll_sockets(pollfd * fds, int count, int timeout) { return poll(fds, count, timeout); }
+#endif
+
+/// @brief How often the server thread checks whether it should stop, in milliseconds.
+constexpr int POLL_TIMEOUT = 200;
+/// @brief How long a client has to send its request, in milliseconds.
+constexpr int REQUEST_TIMEOUT = 1000;
+constexpr int MAX_REQUEST_SIZE = 4096;
+
+/// @return The resident set size in bytes, or 0 if unknown.
+static long long get_resident_set_size()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (long long)counters.WorkingSetSize;
+    return 0;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    long long size, resident;
+    if (statm >> size >> resident)
+        return resident * sysconf(_SC_PAGESIZE);
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+namespace GravityFun
+{
+    MetricsServer::MetricsServer()
+        : Running(false), ListeningSocket((long long)INVALID_SOCKET_VALUE), Published(false)
+    {
+    }
+
+    MetricsServer::~MetricsServer()
+    {
+        Stop();
+    }
+
+    bool MetricsServer::Start(int port)
+    {
+        if (Running)
+            return false;
+#ifdef _WIN32
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+            return false;
+#endif
+        socket_type listening_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (listening_socket == INVALID_SOCKET_VALUE)
+            return false;
+        int reuse = 1;
+        setsockopt(listening_socket, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons((unsigned short)port);
+        if (bind(listening_socket, (const sockaddr *)&address, sizeof(address)) != 0
+            || listen(listening_socket, 8) != 0)
+        {
+            close_socket(listening_socket);
+            return false;
+        }
+        ListeningSocket = (long long)listening_socket;
+        Running = true;
+        Thread = std::thread([this] { Serve(); });
+        return true;
+    }
+
+    void MetricsServer::Stop()
+    {
+        if (!Running)
+            return;
+        Running = false;
+        Thread.join();
+        close_socket((socket_type)ListeningSocket);
+        ListeningSocket = (long long)INVALID_SOCKET_VALUE;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    void MetricsServer::Publish(const Metrics::Snapshot& snapshot)
+    {
+        std::unique_lock<std::mutex> lock(SnapshotMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+            return;
+        _Snapshot = snapshot;
+        Published = true;
+    }
+
+    void MetricsServer::Serve()
+    {
+        socket_type listening_socket = (socket_type)ListeningSocket;
+        std::string request;
+        while (Running)
+        {
+            pollfd listening = { listening_socket, POLLIN, 0 };
+            if (poll_sockets(&listening, 1, POLL_TIMEOUT) <= 0)
+                continue;
+            socket_type client = accept(listening_socket, nullptr, nullptr);
+            if (client == INVALID_SOCKET_VALUE)
+                continue;
+
+            // Reads up to the end of the headers
+            request.clear();
+            char buffer[1024];
+            while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE)
+            {
+                pollfd readable = { client, POLLIN, 0 };
+                if (poll_sockets(&readable, 1, REQUEST_TIMEOUT) <= 0)
+                    break;
+                int size = (int)recv(client, buffer, sizeof(buffer), 0);
+                if (size <= 0)
+                    break;
+                request.append(buffer, size);
+            }
+
+            std::string status = "200 OK";
+            std::string body;
+            if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET / ", 0) == 0)
+                body = GetText();
+            else
+            {
+                status = "404 Not Found";
+                body = "Not found, the metrics are at /metrics\n";
+            }
+            std::string response = "HTTP/1.1 " + status + "\r\n"
+                "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body;
+            std::size_t sent = 0;
+            while (sent < response.size())
+            {
+                int size = (int)send(client, response.data() + sent, (int)(response.size() - sent), 0);
+                if (size <= 0)
+                    break;
+                sent += size;
+            }
+            close_socket(client);
+        }
+    }
+
+    std::string MetricsServer::GetText()
+    {
+        Metrics::Snapshot snapshot;
+        bool published;
+        {
+            std::lock_guard<std::mutex> lock(SnapshotMutex);
+            snapshot = _Snapshot;
+            published = Published;
+        }
+
+        std::ostringstream text;
+        auto write = [&](const char * name, const char * type, const char * help, auto value)
+        {
+            text << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n'
+                << name << ' ' << value << '\n';
+        };
+        text.precision(9);
+        long long resident_set_size = get_resident_set_size();
+        if (resident_set_size != 0)
+            write("process_resident_memory_bytes", "gauge", "Resident memory size in bytes.", resident_set_size);
+        if (!published) // The first snapshot is published after Metrics::UPDATE_INTERVAL
+            return text.str();
+
+        write("gravityfun_steps_total", "counter", "Completed physics steps.", snapshot.StepsCount);
+        write("gravityfun_steps_per_second", "gauge", "Physics steps per second.", snapshot.StepsPerSecond);
+        write("gravityfun_frames_per_second", "gauge", "Rendered frames per second.", snapshot.FramesPerSecond);
+        text << "# HELP gravityfun_frame_time_seconds Frame times, the quantiles of the last update interval.\n"
+            "# TYPE gravityfun_frame_time_seconds summary\n"
+            "gravityfun_frame_time_seconds{quantile=\"0.5\"} " << snapshot.FrameTimeMedian << "\n"
+            "gravityfun_frame_time_seconds{quantile=\"0.95\"} " << snapshot.FrameTimeP95 << "\n"
+            "gravityfun_frame_time_seconds{quantile=\"0.99\"} " << snapshot.FrameTimeP99 << "\n"
+            "gravityfun_frame_time_seconds_sum " << snapshot.FrameTimeSum << "\n"
+            "gravityfun_frame_time_seconds_count " << snapshot.FramesCount << '\n';
+        text << "# HELP gravityfun_pass_seconds Time per physics step of each pass, the slowest worker's for the parallel ones.\n"
+            "# TYPE gravityfun_pass_seconds gauge\n"
+            "gravityfun_pass_seconds{pass=\"physics1\"} " << snapshot.PassTimes[(int)Metrics::Pass::Physics1] << "\n"
+            "gravityfun_pass_seconds{pass=\"physics2\"} " << snapshot.PassTimes[(int)Metrics::Pass::Physics2] << "\n"
+            "gravityfun_pass_seconds{pass=\"contact_solving\"} " << snapshot.PassTimes[(int)Metrics::Pass::ContactSolving] << "\n"
+            "gravityfun_pass_seconds{pass=\"serial\"} " << snapshot.SerialTime << '\n';
+        write("gravityfun_worker_imbalance_ratio", "gauge",
+            "The busiest physics worker's time over the average one's, minus 1.", snapshot.WorkerImbalance);
+        write("gravityfun_idle_ratio", "gauge", "The share of the time that the energy saver idled.", snapshot.IdlingShare);
+        write("gravityfun_objects", "gauge", "Objects count.", snapshot.ObjectsCount);
+        write("gravityfun_mapper_overflows_total", "counter",
+            "Objects mapped beyond the capacity of their object mapper slot.", snapshot.MapperOverflowsCount);
+        return text.str();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GravityFun.dec.h"
+
+#include "Metrics.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace GravityFun
+{
+    /// @brief Serves the latest metrics snapshot in the Prometheus text format on http://127.0.0.1:port/metrics,
+    ///        from its own thread. For a local scraper: the clients are served one at a time,
+    ///        and a client that doesn't send its request holds the others up for up to a second.
+    class MetricsServer final
+    {
+    public:
+        MetricsServer();
+        /// @brief Stops the server.
+        ~MetricsServer();
+
+        MetricsServer(const MetricsServer&) = delete;
+        MetricsServer(MetricsServer&&) = delete;
+        MetricsServer& operator=(const MetricsServer&) = delete;
+        MetricsServer& operator=(MetricsServer&&) = delete;
+
+        /// @brief Listens on the loopback interface only.
+        /// @return Whether the port could be listened on.
+        bool Start(int port);
+        void Stop();
+
+        /// @brief Replaces the served snapshot. Never waits for the server thread,
+        ///        the snapshot is skipped if the server is copying the last one.
+        void Publish(const Metrics::Snapshot&);
+    private:
+        std::thread Thread;
+        std::atomic<bool> Running;
+        /// @brief The listening socket, as an integer on every platform.
+        long long ListeningSocket;
+        /// @brief Guards _Snapshot and Published.
+        std::mutex SnapshotMutex;
+        Metrics::Snapshot _Snapshot;
+        bool Published;
+
+        /// @brief Accepts and answers one client at a time, waiting up to REQUEST_TIMEOUT for each request.
+        void Serve();
+        /// @return The response body.
+        std::string GetText();
+    };
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "FloatingObject.h"
+#include "Math.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Maps the objects to a grid level by their radius, where the cell size of level k is
+    ///        MinCellSize * 2^k and the objects of a level are not wider than its cells.
+    ///        The cells of all levels are hashed to BucketsCount buckets, sorted by a counting sort.
+    ///        Wraps around at the borders set by SetBorders, like ObjectMapper, unless it is unbounded.
+    template <int LevelsCount, int BucketsCount>
+    class MultiLevelObjectMapper final
+    {
+        static_assert((BucketsCount & (BucketsCount - 1)) == 0, "BucketsCount must be a power of 2.");
+    private:
+        /// @brief The cell indexes are clamped to this in the unbounded mode, to fit in the keys.
+        static constexpr double MaxIndex = 1 << 26;
+
+        double BorderX = 1;
+        double BorderY = 1;
+        bool Unbounded = false;
+        /// @brief The minimum cell size, the size of the level 0 cells.
+        double MinCellSize;
+
+        std::array<int, LevelsCount> CellsCountsX;
+        std::array<int, LevelsCount> CellsCountsY;
+        std::array<double, LevelsCount> PositionToIndexX;
+        std::array<double, LevelsCount> PositionToIndexY;
+        /// @brief The maximum radius of the objects in each level, negative when empty.
+        std::array<double, LevelsCount> MaxRadiuses;
+
+        /// @brief The first index of each bucket in SortedObjects, followed by the total count.
+        std::array<int, BucketsCount + 1> BucketStarts;
+        std::vector<int> SortedObjects;
+        /// @brief The cell key of each SortedObjects item, to skip the other cells with the same bucket.
+        std::vector<std::uint64_t> SortedKeys;
+        std::vector<std::uint64_t> ObjectKeys;
+
+        inline int GetLevel(double radius) const
+        {
+            int level = 0;
+            double cell_size = MinCellSize;
+            while (level < LevelsCount - 1 && 2 * radius > cell_size)
+            {
+                level++;
+                cell_size *= 2;
+            }
+            return level;
+        }
+
+        inline static std::uint64_t GetKey(int level, int index_x, int index_y)
+        {
+            constexpr std::uint64_t mask = (1ull << 28) - 1;
+            return ((std::uint64_t)level << 56) | (((std::uint64_t)index_x & mask) << 28) | ((std::uint64_t)index_y & mask);
+        }
+
+        inline static int GetBucket(std::uint64_t key)
+        {
+            key ^= key >> 29;
+            key *= 0xbf58476d1ce4e5b9ull;
+            key ^= key >> 32;
+            return (int)(key & (BucketsCount - 1));
+        }
+
+        inline int GetIndexX(int level, double position_x) const
+        {
+            return (int)std::clamp(std::floor((position_x + BorderX) * PositionToIndexX[level]), -MaxIndex, MaxIndex);
+        }
+
+        inline int GetIndexY(int level, double position_y) const
+        {
+            return (int)std::clamp(std::floor((position_y + BorderY) * PositionToIndexY[level]), -MaxIndex, MaxIndex);
+        }
+
+        inline int Wrap(int index, int count) const
+        {
+            if (Unbounded)
+                return index;
+            index %= count;
+            return index < 0 ? index + count : index;
+        }
+    public:
+        explicit MultiLevelObjectMapper(double min_cell_size) : MinCellSize(min_cell_size)
+        {
+            SetBorders(1, 1);
+            MaxRadiuses.fill(-1);
+            BucketStarts.fill(0);
+        }
+
+        /// @brief Sets the area to [-border_x, border_x] * [-border_y, border_y].
+        ///        The objects have to be mapped again after this.
+        inline void SetBorders(double border_x, double border_y)
+        {
+            BorderX = border_x;
+            BorderY = border_y;
+            double cell_size = MinCellSize;
+            for (int level = 0; level < LevelsCount; level++)
+            {
+                // The cells are stretched to fit the area, so they wrap around at the borders
+                CellsCountsX[level] = std::max(1, (int)(2 * border_x / cell_size));
+                CellsCountsY[level] = std::max(1, (int)(2 * border_y / cell_size));
+                PositionToIndexX[level] = CellsCountsX[level] / (2 * border_x);
+                PositionToIndexY[level] = CellsCountsY[level] / (2 * border_y);
+                cell_size *= 2;
+            }
+        }
+
+        /// @brief When unbounded, the cells do not wrap around at the borders but go on indefinitely.
+        ///        The objects have to be mapped again after this.
+        inline void SetUnbounded(bool unbounded)
+        {
+            Unbounded = unbounded;
+        }
+
+        /// @brief Replaces the mapped objects with the given ones, where the object index is the index in the span.
+        /// @param sweep_time Each object is mapped with its radius plus the distance it moves in this time,
+        ///                   so the queries reach the objects that can pass by during it.
+        inline void Map(std::span<const FloatingObject> objects, double mass_to_radius, double sweep_time = 0)
+        {
+            int objects_count = (int)objects.size();
+            MaxRadiuses.fill(-1);
+            BucketStarts.fill(0);
+            ObjectKeys.resize(objects_count);
+            SortedObjects.resize(objects_count);
+            SortedKeys.resize(objects_count);
+            for (int i = 0; i < objects_count; i++)
+            {
+                double radius = objects[i].Mass * mass_to_radius + objects[i].Velocity.GetMagnitude() * sweep_time;
+                int level = GetLevel(radius);
+                MaxRadiuses[level] = std::max(MaxRadiuses[level], radius);
+                auto key = GetKey(
+                    level,
+                    Wrap(GetIndexX(level, objects[i].Position.x), CellsCountsX[level]),
+                    Wrap(GetIndexY(level, objects[i].Position.y), CellsCountsY[level])
+                );
+                ObjectKeys[i] = key;
+                BucketStarts[GetBucket(key) + 1]++;
+            }
+            for (int bucket = 0; bucket < BucketsCount; bucket++)
+                BucketStarts[bucket + 1] += BucketStarts[bucket];
+            // Fill from the end of each bucket, so the objects of a bucket stay in ascending order
+            for (int i = objects_count - 1; i >= 0; i--)
+            {
+                int index = --BucketStarts[GetBucket(ObjectKeys[i]) + 1];
+                SortedObjects[index] = i;
+                SortedKeys[index] = ObjectKeys[i];
+            }
+            // The decrements moved the end of each bucket to its start
+            for (int bucket = 0; bucket < BucketsCount; bucket++)
+                BucketStarts[bucket] = BucketStarts[bucket + 1];
+            BucketStarts[BucketsCount] = objects_count;
+        }
+
+        /// @brief Visits the objects that can be within the radius plus their own radius from the position,
+        ///        only checking the levels that have objects.
+        ///        The visitor is called with the object index as int
+        ///        and can return true to stop visiting any more objects.
+        /// @return Whether the visitor returned true to stop visiting.
+        template <typename Visitor>
+        inline bool VisitObjects(Math::Vec2 position, double radius, const Visitor& visitor) const
+        {
+            for (int level = 0; level < LevelsCount; level++)
+            {
+                if (MaxRadiuses[level] < 0)
+                    continue;
+                double reach = radius + MaxRadiuses[level];
+                int left = GetIndexX(level, position.x - reach);
+                int right = GetIndexX(level, position.x + reach);
+                if (!Unbounded && right - left >= CellsCountsX[level])
+                {
+                    left = 0;
+                    right = CellsCountsX[level] - 1;
+                }
+                int bottom = GetIndexY(level, position.y - reach);
+                int top = GetIndexY(level, position.y + reach);
+                if (!Unbounded && top - bottom >= CellsCountsY[level])
+                {
+                    bottom = 0;
+                    top = CellsCountsY[level] - 1;
+                }
+                for (int x = left; x <= right; x++)
+                {
+                    int index_x = Wrap(x, CellsCountsX[level]);
+                    for (int y = bottom; y <= top; y++)
+                    {
+                        auto key = GetKey(level, index_x, Wrap(y, CellsCountsY[level]));
+                        int bucket = GetBucket(key);
+                        for (int j = BucketStarts[bucket]; j < BucketStarts[bucket + 1]; j++)
+                        {
+                            if (SortedKeys[j] == key && visitor(SortedObjects[j]))
+                                return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+    };
+}
@@ -0,0 +1,88 @@
+#include "ObjectFlow.h"
+
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+namespace GravityFun
+{
+    inline bool parse_numbers(const std::string& text, std::vector<double>& numbers)
+    {
+        std::istringstream stream(text);
+        double number;
+        while (stream >> number)
+            numbers.push_back(number);
+        return stream.eof(); // Else not a number
+    }
+
+    bool ObjectFlow::ParseEmitter(const std::string& text, Emitter& emitter)
+    {
+        std::vector<double> numbers;
+        if (!parse_numbers(text, numbers) || numbers.size() != 5 || !(numbers[4] > 0))
+            return false;
+        emitter.Position = Math::Vec2(numbers[0], numbers[1]);
+        emitter.Velocity = Math::Vec2(numbers[2], numbers[3]);
+        emitter.Rate = numbers[4];
+        return true;
+    }
+
+    bool ObjectFlow::ParseSink(const std::string& text, Sink& sink)
+    {
+        std::vector<double> numbers;
+        if (!parse_numbers(text, numbers) || numbers.size() != 3 || !(numbers[2] > 0))
+            return false;
+        sink.Position = Math::Vec2(numbers[0], numbers[1]);
+        sink.Radius = numbers[2];
+        return true;
+    }
+
+    void ObjectFlow::SetEmitters(std::vector<Emitter> emitters)
+    {
+        Emitters = std::move(emitters);
+        Remainders.assign(Emitters.size(), 0);
+        Counts.assign(Emitters.size(), 0);
+    }
+
+    void ObjectFlow::SetSinks(std::vector<Sink> sinks)
+    {
+        Sinks = std::move(sinks);
+    }
+
+    const std::vector<ObjectFlow::Emitter>& ObjectFlow::GetEmitters() const
+    {
+        return Emitters;
+    }
+
+    const std::vector<ObjectFlow::Sink>& ObjectFlow::GetSinks() const
+    {
+        return Sinks;
+    }
+
+    bool ObjectFlow::IsEmpty() const
+    {
+        return Emitters.empty() && Sinks.empty();
+    }
+
+    bool ObjectFlow::IsInSink(Math::Vec2 position) const
+    {
+        for (const auto& sink : Sinks)
+        {
+            auto offset = position - sink.Position;
+            if (offset.GetDotProduct(offset) < sink.Radius * sink.Radius)
+                return true;
+        }
+        return false;
+    }
+
+    const std::vector<int>& ObjectFlow::Advance(double time_diff)
+    {
+        for (std::size_t i = 0; i < Emitters.size(); i++)
+        {
+            double due = Remainders[i] + Emitters[i].Rate * time_diff;
+            double count = std::floor(due);
+            Remainders[i] = due - count;
+            Counts[i] = (int)count;
+        }
+        return Counts;
+    }
+}
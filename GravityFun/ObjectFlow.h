@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Math.h"
+
+#include <string>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Emitters that spawn objects at steady rates and sinks that absorb them,
+    ///        so the objects count settles where the spawning and absorbing rates meet.
+    class ObjectFlow final
+    {
+    public:
+        struct Emitter
+        {
+            Math::Vec2 Position;
+            /// @brief The velocity of the spawned objects.
+            Math::Vec2 Velocity;
+            /// @brief Objects per second.
+            double Rate;
+        };
+
+        struct Sink
+        {
+            Math::Vec2 Position;
+            /// @brief The objects are absorbed when their centers are within this distance.
+            double Radius;
+        };
+
+        ObjectFlow() = default;
+
+        ObjectFlow(const ObjectFlow&) = delete;
+        ObjectFlow(ObjectFlow&&) = delete;
+        ObjectFlow& operator=(const ObjectFlow&) = delete;
+        ObjectFlow& operator=(ObjectFlow&&) = delete;
+
+        /// @brief Parses "x y velocity_x velocity_y rate".
+        /// @return Whether the text is a valid emitter.
+        static bool ParseEmitter(const std::string& text, Emitter& emitter);
+        /// @brief Parses "x y radius".
+        /// @return Whether the text is a valid sink.
+        static bool ParseSink(const std::string& text, Sink& sink);
+
+        /// @brief Must not be called while the flow is being advanced.
+        void SetEmitters(std::vector<Emitter> emitters);
+        /// @brief Must not be called while the flow is being advanced.
+        void SetSinks(std::vector<Sink> sinks);
+
+        const std::vector<Emitter>& GetEmitters() const;
+        const std::vector<Sink>& GetSinks() const;
+        bool IsEmpty() const;
+        /// @brief Whether the position is absorbed by a sink.
+        bool IsInSink(Math::Vec2 position) const;
+
+        /// @brief Moves the emitters forward in time.
+        /// @return The number of objects that each emitter spawns in the time,
+        ///         where the fractions are carried over to the next calls.
+        const std::vector<int>& Advance(double time_diff);
+    private:
+        std::vector<Emitter> Emitters;
+        std::vector<Sink> Sinks;
+        /// @brief The fraction of an object that each emitter has not spawned yet.
+        std::vector<double> Remainders;
+        std::vector<int> Counts;
+    };
+}
@@ -4,22 +4,20 @@
 
 #include <algorithm>
 #include <array>
-#include <functional>
+#include <cmath>
 
 namespace GravityFun
 {
-    template <int SizeX, int SizeY, int AreaX, int AreaY, int CellCapacity>
+    /// @brief Maps the objects to SizeX * SizeY slots that evenly cover the area
+    ///        between the borders set by SetBorders, which wraps around at the borders.
+    template <int SizeX, int SizeY, int CellCapacity>
     class ObjectMapper final
     {
     private:
-        static constexpr double PositionToIndexX = (double)SizeX / AreaX;
-        static constexpr double PositionToIndexY = (double)SizeY / AreaY;
         static constexpr int IndexMultiplierX = SizeY * CellCapacity;
         static constexpr int IndexMultiplierY = CellCapacity;
 
         static constexpr int SlotsCount = SizeX * SizeY;
-        static constexpr double SlotSizeX = (double)AreaX / SizeX;
-        static constexpr double SlotSizeY = (double)AreaY / SizeY;
 
         static constexpr int MaxLeft = (SizeX / 2);
         static constexpr int MaxRight = SizeX - MaxLeft - 1;
@@ -28,14 +26,20 @@ namespace GravityFun
 
         std::array<int, SizeX * SizeY * CellCapacity> MappedObjectBuffer;
 
+        double BorderX = 1;
+        double BorderY = 1;
+        long long OverflowsCount = 0;
+        double PositionToIndexX = SizeX * 0.5;
+        double PositionToIndexY = SizeY * 0.5;
+
         inline int GetIndexX(double position_x) const
         {
-            return (int)(position_x * PositionToIndexX);
+            return (int)std::floor((position_x + BorderX) * PositionToIndexX);
         }
 
         inline int GetIndexY(double position_y) const
         {
-            return (int)(position_y * PositionToIndexY);
+            return (int)std::floor((position_y + BorderY) * PositionToIndexY);
         }
 
         inline int GetIndex(int index_x, int index_y) const
@@ -75,7 +79,8 @@ namespace GravityFun
             return i;
         }
 
-        inline bool VisitObjects(int start, const std::function<bool(int)>& visitor) const
+        template <typename Visitor>
+        inline bool VisitObjects(int start, const Visitor& visitor) const
         {
             int stop = start + SlotsCount;
             for (int j = start; j < stop; j++)
@@ -93,6 +98,18 @@ namespace GravityFun
             return false;
         }
     public:
+        static constexpr int SLOTS_COUNT = SlotsCount;
+
+        /// @brief Sets the area to [-border_x, border_x] * [-border_y, border_y].
+        ///        The mapped objects have to be cleared and added again after this.
+        inline void SetBorders(double border_x, double border_y)
+        {
+            BorderX = border_x;
+            BorderY = border_y;
+            PositionToIndexX = SizeX / (2 * border_x);
+            PositionToIndexY = SizeY / (2 * border_y);
+        }
+
         inline void Clear()
         {
             for (int i = 0; i < SlotsCount; i++)
@@ -109,6 +126,8 @@ namespace GravityFun
             {
                 if (MappedObjectBuffer[i] == -1)
                 {
+                    if (i >= start + CellCapacity)
+                        OverflowsCount++;
                     MappedObjectBuffer[i] = object_index;
                     if (++i < stop)
                     {
@@ -117,7 +136,39 @@ namespace GravityFun
                     return;
                 }
             }
-            stop = 0;
+            OverflowsCount++;
+        }
+
+        /// @brief The number of the objects that were added beyond the capacity of their slot, since the construction.
+        inline long long GetOverflowsCount() const
+        {
+            return OverflowsCount;
+        }
+
+        /// @brief The sum of the squared object counts of the slots.
+        ///        Divided by the squared objects count, it's 1 / SLOTS_COUNT for uniformly spread objects
+        ///        and grows as the objects get clustered.
+        inline long long GetSquaredOccupancySum() const
+        {
+            long long sum = 0;
+            for (int i = 0; i < SlotsCount; i++)
+            {
+                int start = i * CellCapacity;
+                int stop = start + CellCapacity;
+                long long count = 0;
+                for (int j = start; j < stop && MappedObjectBuffer[j] != -1; j++)
+                    count++;
+                sum += count * count;
+            }
+            return sum;
+        }
+
+        /// @brief The maximum number of slots that VisitObjects(position, radius, visitor) visits.
+        inline int GetVisitedSlotsCount(double radius) const
+        {
+            int x = std::min(SizeX, 2 * ((int)(radius * PositionToIndexX) + 1) + 1);
+            int y = std::min(SizeY, 2 * ((int)(radius * PositionToIndexY) + 1) + 1);
+            return x * y;
         }
 
         /// @brief Fills the result array with the objects in the slot where the position is in.
@@ -131,19 +182,22 @@ namespace GravityFun
         }
 
         /// @brief Visits the objects in the slot where the position is in.
-        ///        The visitor can return true to stop visiting any more objects.
+        ///        The visitor is called with the object index as int
+        ///        and can return true to stop visiting any more objects.
         /// @return Whether the visitor returned true to stop visiting.
-        template <int MaxCount>
-        inline bool VisitObjects(Math::Vec2 position, const std::function<bool(int)>& visitor) const
+        template <typename Visitor>
+        inline bool VisitObjects(Math::Vec2 position, const Visitor& visitor) const
         {
             int start = GetIndex(position);
-            return VisitObjects<MaxCount>(start, visitor);
+            return VisitObjects(start, visitor);
         }
 
         /// @brief Visits the objects in the slots in proximity of the position.
-        ///        The visitor can return true to stop visiting any more objects.
+        ///        The visitor is called with the object index as int
+        ///        and can return true to stop visiting any more objects.
         /// @return Whether the visitor returned true to stop visiting.
-        inline bool VisitObjects(Math::Vec2 position, double radius, const std::function<bool(int)>& visitor) const
+        template <typename Visitor>
+        inline bool VisitObjects(Math::Vec2 position, double radius, const Visitor& visitor) const
         {
             // Center position
             int center_x = GetIndexX(position.x);
@@ -0,0 +1,161 @@
+#include "ObstacleField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+namespace GravityFun
+{
+    inline double get_segment_distance(Math::Vec2 position, Math::Vec2 start, Math::Vec2 end)
+    {
+        auto segment = end - start;
+        auto offset = position - start;
+        double length_squared = segment.GetDotProduct(segment);
+        double t = length_squared == 0 ? 0 : std::clamp(offset.GetDotProduct(segment) / length_squared, 0.0, 1.0);
+        return (offset - segment * t).GetMagnitude();
+    }
+
+    ObstacleField::ObstacleField(double cell_size)
+        : CellSize(cell_size), BorderX(1), BorderY(1), CellsCountX(1), CellsCountY(1),
+          PositionToIndexX(0.5), PositionToIndexY(0.5)
+    {
+    }
+
+    bool ObstacleField::ParseShape(const std::string& text, Shape& shape)
+    {
+        std::istringstream stream(text);
+        std::string type;
+        stream >> type;
+        std::vector<double> numbers;
+        double number;
+        while (stream >> number)
+            numbers.push_back(number);
+        if (!stream.eof()) // Not a number
+            return false;
+
+        shape.Points.clear();
+        shape.Thickness = 0;
+        if (type == "line" && numbers.size() == 5 && numbers[4] > 0)
+        {
+            shape.Type = ShapeType::Line;
+            shape.Points.emplace_back(numbers[0], numbers[1]);
+            shape.Points.emplace_back(numbers[2], numbers[3]);
+            shape.Thickness = numbers[4];
+            return true;
+        }
+        if (type == "polygon" && numbers.size() >= 6 && numbers.size() % 2 == 0)
+        {
+            shape.Type = ShapeType::Polygon;
+            for (std::size_t i = 0; i < numbers.size(); i += 2)
+                shape.Points.emplace_back(numbers[i], numbers[i + 1]);
+            return true;
+        }
+        return false;
+    }
+
+    void ObstacleField::SetShapes(std::vector<Shape> shapes)
+    {
+        Shapes = std::move(shapes);
+        Build();
+    }
+
+    void ObstacleField::SetBorders(double border_x, double border_y)
+    {
+        BorderX = border_x;
+        BorderY = border_y;
+        CellsCountX = std::max(1, (int)std::ceil(2 * border_x / CellSize));
+        CellsCountY = std::max(1, (int)std::ceil(2 * border_y / CellSize));
+        PositionToIndexX = CellsCountX / (2 * border_x);
+        PositionToIndexY = CellsCountY / (2 * border_y);
+        Build();
+    }
+
+    const std::vector<ObstacleField::Shape>& ObstacleField::GetShapes() const
+    {
+        return Shapes;
+    }
+
+    bool ObstacleField::IsEmpty() const
+    {
+        return Shapes.empty();
+    }
+
+    ObstacleField::Sample ObstacleField::GetSample(Math::Vec2 position) const
+    {
+        if (Shapes.empty())
+            return Sample{ std::numeric_limits<double>::infinity(), Math::Vec2(0, 1) };
+
+        Math::Vec2 clamped(std::clamp(position.x, -BorderX, BorderX), std::clamp(position.y, -BorderY, BorderY));
+        double outside_distance = (position - clamped).GetMagnitude();
+        double u = std::clamp((clamped.x + BorderX) * PositionToIndexX, 0.0, (double)CellsCountX);
+        double v = std::clamp((clamped.y + BorderY) * PositionToIndexY, 0.0, (double)CellsCountY);
+        int x = std::min((int)u, CellsCountX - 1);
+        int y = std::min((int)v, CellsCountY - 1);
+        double fx = u - x;
+        double fy = v - y;
+
+        int row_length = CellsCountX + 1;
+        double d00 = Distances[y * row_length + x];
+        double d10 = Distances[y * row_length + x + 1];
+        double d01 = Distances[(y + 1) * row_length + x];
+        double d11 = Distances[(y + 1) * row_length + x + 1];
+
+        // Bilinear, with the gradient of the same interpolation
+        double distance = (d00 * (1 - fx) + d10 * fx) * (1 - fy) + (d01 * (1 - fx) + d11 * fx) * fy + outside_distance;
+        Math::Vec2 gradient(
+            ((d10 - d00) * (1 - fy) + (d11 - d01) * fy) * PositionToIndexX,
+            ((d01 - d00) * (1 - fx) + (d11 - d10) * fx) * PositionToIndexY
+        );
+        double magnitude = gradient.GetMagnitude();
+        return Sample{ distance, magnitude == 0 ? Math::Vec2(0, 1) : gradient / magnitude };
+    }
+
+    void ObstacleField::Build()
+    {
+        if (Shapes.empty())
+        {
+            Distances.clear();
+            return;
+        }
+        int row_length = CellsCountX + 1;
+        Distances.resize(row_length * (CellsCountY + 1));
+        for (int y = 0; y <= CellsCountY; y++)
+        {
+            for (int x = 0; x <= CellsCountX; x++)
+            {
+                Math::Vec2 position(x / PositionToIndexX - BorderX, y / PositionToIndexY - BorderY);
+                Distances[y * row_length + x] = (float)GetExactDistance(position);
+            }
+        }
+    }
+
+    double ObstacleField::GetExactDistance(Math::Vec2 position) const
+    {
+        double distance = std::numeric_limits<double>::infinity();
+        for (const auto& shape : Shapes)
+        {
+            if (shape.Type == ShapeType::Line)
+            {
+                distance = std::min(distance,
+                    get_segment_distance(position, shape.Points[0], shape.Points[1]) - shape.Thickness * 0.5);
+                continue;
+            }
+            // Polygon, inside by the even-odd rule
+            double edge_distance = std::numeric_limits<double>::infinity();
+            bool inside = false;
+            for (std::size_t i = 0, j = shape.Points.size() - 1; i < shape.Points.size(); j = i++)
+            {
+                const auto& a = shape.Points[i];
+                const auto& b = shape.Points[j];
+                edge_distance = std::min(edge_distance, get_segment_distance(position, a, b));
+                if ((a.y > position.y) != (b.y > position.y)
+                    && position.x < (b.x - a.x) * (position.y - a.y) / (b.y - a.y) + a.x)
+                    inside = !inside;
+            }
+            distance = std::min(distance, inside ? -edge_distance : edge_distance);
+        }
+        return distance;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Math.h"
+
+#include <string>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Static obstacles that the objects bounce off, sampled to a signed distance field grid,
+    ///        so a query costs the same no matter how many and how complex the shapes are.
+    class ObstacleField final
+    {
+    public:
+        enum class ShapeType { Line, Polygon };
+
+        struct Shape
+        {
+            ShapeType Type;
+            /// @brief The 2 ends of a line, or the vertices of a polygon in order.
+            std::vector<Math::Vec2> Points;
+            /// @brief The width of a line, with round ends. Unused for polygons.
+            double Thickness;
+        };
+
+        struct Sample
+        {
+            /// @brief The distance to the nearest obstacle surface, negative inside the obstacles.
+            double Distance;
+            /// @brief The direction that the distance increases in, away from the obstacles.
+            Math::Vec2 Normal;
+        };
+
+        /// @param cell_size The size of the grid cells, the field is about as accurate as this.
+        explicit ObstacleField(double cell_size);
+
+        ObstacleField(const ObstacleField&) = delete;
+        ObstacleField(ObstacleField&&) = delete;
+        ObstacleField& operator=(const ObstacleField&) = delete;
+        ObstacleField& operator=(ObstacleField&&) = delete;
+
+        /// @brief Parses "line x1 y1 x2 y2 thickness" or "polygon x1 y1 x2 y2 x3 y3 ...".
+        /// @return Whether the text is a valid shape.
+        static bool ParseShape(const std::string& text, Shape& shape);
+
+        /// @brief Must not be called while the field is being sampled. Samples the new shapes.
+        void SetShapes(std::vector<Shape> shapes);
+        /// @brief Must not be called while the field is being sampled.
+        ///        Samples the shapes again for the area [-border_x, border_x] * [-border_y, border_y].
+        void SetBorders(double border_x, double border_y);
+
+        const std::vector<Shape>& GetShapes() const;
+        bool IsEmpty() const;
+        /// @brief Thread-safe. Interpolates the field at the position.
+        ///        Beyond the area, the distance is estimated by adding the distance to the area.
+        Sample GetSample(Math::Vec2 position) const;
+    private:
+        double CellSize;
+        double BorderX;
+        double BorderY;
+        /// @brief The number of cells in each direction, with one more grid point.
+        int CellsCountX;
+        int CellsCountY;
+        double PositionToIndexX;
+        double PositionToIndexY;
+        std::vector<Shape> Shapes;
+        /// @brief The distances at the grid points, row by row from the bottom left.
+        std::vector<float> Distances;
+
+        void Build();
+        double GetExactDistance(Math::Vec2 position) const;
+    };
+}
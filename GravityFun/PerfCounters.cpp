@@ -0,0 +1,295 @@
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace GravityFun::PerfCounters
+{
+    /// @brief The sums of a phase on one thread, written only by that thread.
+    struct PhaseSums
+    {
+        std::atomic<long long> Calls{0};
+        std::atomic<long long> Nanoseconds{0};
+        std::array<std::atomic<std::uint64_t>, COUNTERS.size()> Counts{};
+        /// @brief The number of the calls that the counter was counted in.
+        std::array<std::atomic<long long>, COUNTERS.size()> Samples{};
+    };
+
+    struct ThreadCounters
+    {
+        /// @brief The group leader, or -1 if no counter is open.
+        int GroupFd = -1;
+        /// @brief The open counters in the group's read order.
+        std::vector<Counter> Opened;
+        /// @brief The file descriptors of Opened, the group leader first.
+        std::vector<int> Fds;
+        std::array<PhaseSums, PHASES.size()> Sums;
+    };
+
+    static std::atomic<bool> Enabled{false};
+    /// @brief Guards Threads and UnavailableReason. Threads only grows, so the sums outlive their threads.
+    static std::mutex ThreadsMutex;
+    static std::vector<std::unique_ptr<ThreadCounters>> Threads;
+    static std::string UnavailableReason;
+    /// @brief Closes the counters of its thread when the thread exits, while the sums stay in Threads.
+    struct LocalCountersOwner
+    {
+        ThreadCounters * Counters = nullptr;
+        ~LocalCountersOwner();
+    };
+    static thread_local LocalCountersOwner LocalCounters;
+
+#ifdef __linux__
+    static bool set_event(Counter counter, perf_event_attr& attr)
+    {
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (counter)
+        {
+        case Counter::Cycles: attr.config = PERF_COUNT_HW_CPU_CYCLES; return true;
+        case Counter::Instructions: attr.config = PERF_COUNT_HW_INSTRUCTIONS; return true;
+        case Counter::L1DataMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            return true;
+        case Counter::LastLevelCacheMisses: attr.config = PERF_COUNT_HW_CACHE_MISSES; return true;
+        case Counter::BranchMisses: attr.config = PERF_COUNT_HW_BRANCH_MISSES; return true;
+        }
+        return false;
+    }
+
+    /// @brief Opens the counters of the calling thread in one group, so they're read with one call.
+    static void open_counters(ThreadCounters& counters)
+    {
+        for (auto counter : COUNTERS)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            if (!set_event(counter, attr))
+                continue;
+            attr.read_format = PERF_FORMAT_GROUP;
+            // User space only, which is allowed up to perf_event_paranoid 2
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, counters.GroupFd, 0);
+            if (fd == -1)
+            {
+                if (counters.GroupFd == -1)
+                {
+                    std::lock_guard<std::mutex> lock(ThreadsMutex);
+                    UnavailableReason = std::string("perf_event_open: ") + std::strerror(errno);
+                }
+                continue;
+            }
+            if (counters.GroupFd == -1)
+                counters.GroupFd = fd;
+            counters.Opened.push_back(counter);
+            counters.Fds.push_back(fd);
+        }
+    }
+
+    /// @brief Closes the counters of the calling thread, which can't be read after this.
+    static void close_counters(ThreadCounters& counters)
+    {
+        // The members before the group leader
+        for (auto i = counters.Fds.rbegin(); i != counters.Fds.rend(); i++)
+            close(*i);
+        counters.Fds.clear();
+        counters.GroupFd = -1;
+    }
+
+    /// @return Whether the counts were read.
+    static bool read_counters(ThreadCounters& counters, std::array<std::uint64_t, COUNTERS.size()>& counts)
+    {
+        if (counters.GroupFd == -1)
+            return false;
+        std::array<std::uint64_t, COUNTERS.size() + 1> values; // The number of the values, then the values
+        ssize_t size = (ssize_t)((counters.Opened.size() + 1) * sizeof(std::uint64_t));
+        if (read(counters.GroupFd, values.data(), size) != size)
+            return false;
+        for (std::size_t i = 0; i < counters.Opened.size(); i++)
+            counts[(std::size_t)counters.Opened[i]] = values[i + 1];
+        return true;
+    }
+#else
+    static void open_counters(ThreadCounters&)
+    {
+        std::lock_guard<std::mutex> lock(ThreadsMutex);
+        UnavailableReason = "Only supported on Linux";
+    }
+
+    static bool read_counters(ThreadCounters&, std::array<std::uint64_t, COUNTERS.size()>&)
+    {
+        return false;
+    }
+
+    static void close_counters(ThreadCounters&)
+    {
+    }
+#endif
+
+    LocalCountersOwner::~LocalCountersOwner()
+    {
+        if (Counters != nullptr)
+            close_counters(*Counters);
+    }
+
+    static ThreadCounters& get_local_counters()
+    {
+        if (LocalCounters.Counters == nullptr)
+        {
+            std::unique_ptr<ThreadCounters> counters(new ThreadCounters());
+            open_counters(*counters);
+            std::lock_guard<std::mutex> lock(ThreadsMutex);
+            LocalCounters.Counters = counters.get();
+            Threads.push_back(std::move(counters));
+        }
+        return *LocalCounters.Counters;
+    }
+
+    const char * GetName(Phase phase)
+    {
+        switch (phase)
+        {
+        case Phase::PhysicsPass1: return "physics pass1";
+        case Phase::MapperRebuild: return "mapper rebuild";
+        case Phase::PhysicsPass2: return "physics pass2";
+        case Phase::ContactSolving: return "contact solving";
+        case Phase::Rendering: return "rendering";
+        }
+        return "";
+    }
+
+    const char * GetName(Counter counter)
+    {
+        switch (counter)
+        {
+        case Counter::Cycles: return "cycles";
+        case Counter::Instructions: return "instructions";
+        case Counter::L1DataMisses: return "L1D misses";
+        case Counter::LastLevelCacheMisses: return "LLC misses";
+        case Counter::BranchMisses: return "branch misses";
+        }
+        return "";
+    }
+
+    void SetEnabled(bool value)
+    {
+        Enabled.store(value, std::memory_order_relaxed);
+    }
+    bool IsEnabled()
+    {
+        return Enabled.load(std::memory_order_relaxed);
+    }
+
+    Scope::Scope(Phase phase) : _Phase(phase), Enabled(IsEnabled())
+    {
+        if (!Enabled)
+            return;
+        BeginCounts.fill(0);
+        read_counters(get_local_counters(), BeginCounts);
+        Begin = std::chrono::steady_clock::now();
+    }
+    Scope::~Scope()
+    {
+        if (!Enabled)
+            return;
+        auto end = std::chrono::steady_clock::now();
+        auto& counters = get_local_counters();
+        std::array<std::uint64_t, COUNTERS.size()> end_counts;
+        bool counted = read_counters(counters, end_counts);
+        auto& sums = counters.Sums[(std::size_t)_Phase];
+        // Only this thread writes its sums
+        sums.Calls.store(sums.Calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sums.Nanoseconds.store(sums.Nanoseconds.load(std::memory_order_relaxed)
+            + std::chrono::duration_cast<std::chrono::nanoseconds>(end - Begin).count(), std::memory_order_relaxed);
+        if (!counted)
+            return;
+        for (auto counter : counters.Opened)
+        {
+            auto i = (std::size_t)counter;
+            sums.Counts[i].store(sums.Counts[i].load(std::memory_order_relaxed) + end_counts[i] - BeginCounts[i],
+                std::memory_order_relaxed);
+            sums.Samples[i].store(sums.Samples[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    Totals GetTotals(Phase phase)
+    {
+        Totals totals{ 0, 0, {}, {} };
+        std::array<long long, COUNTERS.size()> samples{};
+        long long nanoseconds = 0;
+        std::lock_guard<std::mutex> lock(ThreadsMutex);
+        for (auto& counters : Threads)
+        {
+            auto& sums = counters->Sums[(std::size_t)phase];
+            totals.Calls += sums.Calls.load(std::memory_order_relaxed);
+            nanoseconds += sums.Nanoseconds.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < COUNTERS.size(); i++)
+            {
+                totals.Counts[i] += sums.Counts[i].load(std::memory_order_relaxed);
+                samples[i] += sums.Samples[i].load(std::memory_order_relaxed);
+            }
+        }
+        totals.Seconds = nanoseconds * 1e-9;
+        for (std::size_t i = 0; i < COUNTERS.size(); i++)
+            totals.Available[i] = totals.Calls != 0 && samples[i] == totals.Calls;
+        return totals;
+    }
+
+    std::string GetUnavailableReason()
+    {
+        std::lock_guard<std::mutex> lock(ThreadsMutex);
+        return UnavailableReason;
+    }
+
+    void WriteReport(std::ostream& stream, long long object_steps)
+    {
+        auto flags = stream.flags();
+        auto precision = stream.precision();
+        double divisor = (double)std::max(1LL, object_steps);
+        stream << "Per object per step:\n" << std::setw(16) << "phase" << std::setw(10) << "calls" << std::setw(12) << "ms"
+            << std::setw(10) << "ns";
+        for (auto counter : COUNTERS)
+            stream << std::setw(16) << GetName(counter);
+        stream << '\n' << std::fixed;
+        bool any_unavailable = false;
+        for (auto phase : PHASES)
+        {
+            auto totals = GetTotals(phase);
+            if (totals.Calls == 0)
+                continue;
+            stream << std::setw(16) << GetName(phase) << std::setw(10) << totals.Calls
+                << std::setprecision(1) << std::setw(12) << totals.Seconds * 1e3
+                << std::setprecision(2) << std::setw(10) << totals.Seconds * 1e9 / divisor;
+            for (std::size_t i = 0; i < COUNTERS.size(); i++)
+            {
+                if (totals.Available[i])
+                    stream << std::setw(16) << totals.Counts[i] / divisor;
+                else
+                    stream << std::setw(16) << "n/a";
+                any_unavailable = any_unavailable || !totals.Available[i];
+            }
+            stream << '\n';
+        }
+        std::string reason = GetUnavailableReason();
+        if (any_unavailable)
+            stream << "Some hardware counters are unavailable" << (reason.empty() ? "" : " (" + reason + ")")
+                << ", only the times are measured for them\n";
+        stream.flags(flags);
+        stream.precision(precision);
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace GravityFun::PerfCounters
+{
+    /// @brief The parts of the loop that the counters are attributed to.
+    enum class Phase
+    {
+        /// @brief The pass1 Physics modules (forces and motion, or the fluid densities).
+        PhysicsPass1,
+        /// @brief The object mapper and collision mapper rebuilds.
+        MapperRebuild,
+        /// @brief The pass2 Physics modules (contact detection, or forces and motion).
+        PhysicsPass2,
+        ContactSolving,
+        Rendering,
+    };
+
+    constexpr std::array<Phase, 5> PHASES = {
+        Phase::PhysicsPass1, Phase::MapperRebuild, Phase::PhysicsPass2, Phase::ContactSolving, Phase::Rendering
+    };
+
+    enum class Counter
+    {
+        Cycles,
+        Instructions,
+        L1DataMisses,
+        LastLevelCacheMisses,
+        BranchMisses,
+    };
+
+    constexpr std::array<Counter, 5> COUNTERS = {
+        Counter::Cycles, Counter::Instructions, Counter::L1DataMisses, Counter::LastLevelCacheMisses, Counter::BranchMisses
+    };
+
+    const char * GetName(Phase);
+    const char * GetName(Counter);
+
+    /// @brief Starts or stops sampling, off by default.
+    ///        Each thread opens its counters the first time it samples while enabled,
+    ///        and closes them when it exits.
+    void SetEnabled(bool);
+    bool IsEnabled();
+
+    /// @brief Adds the counts of the calling thread's hardware counters and the time from its construction
+    ///        to its destruction to a phase, if sampling is enabled at its construction.
+    ///        Only the time is added where the counters can't be opened,
+    ///        like on other systems than Linux, or when perf_event_paranoid forbids them.
+    ///        Nested scopes are counted in both phases.
+    class Scope final
+    {
+    public:
+        explicit Scope(Phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+    private:
+        Phase _Phase;
+        bool Enabled;
+        std::chrono::steady_clock::time_point Begin;
+        std::array<std::uint64_t, COUNTERS.size()> BeginCounts;
+    };
+
+    struct Totals
+    {
+        long long Calls;
+        double Seconds;
+        std::array<std::uint64_t, COUNTERS.size()> Counts;
+        /// @brief Whether the counter was counted in all of the calls.
+        std::array<bool, COUNTERS.size()> Available;
+    };
+
+    /// @brief The sums of all threads. MUST NOT be called while sampling.
+    Totals GetTotals(Phase);
+    /// @brief Why no counter could be opened, or empty.
+    std::string GetUnavailableReason();
+
+    /// @brief Writes a table of the phases with the time and the counts per object per step.
+    ///        MUST NOT be called while sampling.
+    /// @param object_steps The sum of the objects count over the steps, see GameManager::GetObjectStepsCount.
+    void WriteReport(std::ostream&, long long object_steps);
+}
@@ -1,28 +1,161 @@
 #include "Physics.h"
 
+#include "Allocations.h"
 #include "GameManager.h"
+#include "PerfCounters.h"
+#include "Trace.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <numbers>
+#include <span>
 #include <utility>
 
+/// @brief Branch-free relative gravity kernel.
+/// @return The acceleration toward an object of unit mass divided by their distance vector,
+///         without MASS_GRAVITY_ACCELERATION.
+inline double GetGravityKernel(double distance_squared)
+{
+#if GRAVITYFUN_GRAVITY_SOFTENING == 1 // Plummer
+    constexpr double epsilon = GravityFun::GameManager::GRAVITY_SOFTENING_LENGTH;
+    double d2 = distance_squared + epsilon * epsilon;
+    return 1 / (d2 * std::sqrt(d2));
+#elif GRAVITYFUN_GRAVITY_SOFTENING == 2 // Cubic spline, exactly Newtonian beyond h
+    constexpr double epsilon = GravityFun::GameManager::GRAVITY_SOFTENING_LENGTH;
+    constexpr double h = 2.8 * epsilon;
+    constexpr double inverse_h3 = 1 / (h * h * h);
+    double distance = std::sqrt(distance_squared);
+    double u = distance / h;
+    double u2 = u * u;
+    double inner = inverse_h3 * (10.666666666667 + u2 * (32 * u - 38.4));
+    double outer = inverse_h3 * (21.333333333333 - 48 * u + 38.4 * u2 - 10.666666666667 * u2 * u - 0.066666666667 / (u2 * u));
+    double newtonian = 1 / (distance_squared * distance);
+    return u < 0.5 ? inner : (u < 1 ? outer : newtonian);
+#else
+    return distance_squared == 0 ? 0 : 1 / (distance_squared * std::sqrt(distance_squared));
+#endif
+}
+
+/// @brief Used for the wrap around mode, where objects interact with the nearest periodic image of each other.
+/// @param period The width and height of the periodic area, or 0 for no periodicity.
+/// @param inverse_period The inverse of the period, or 0 for no periodicity.
+inline GravityFun::Math::Vec2 GetNearestImage(
+    GravityFun::Math::Vec2 distance2d,
+    const GravityFun::Math::Vec2& period,
+    const GravityFun::Math::Vec2& inverse_period
+)
+{
+    distance2d.x -= period.x * std::nearbyint(distance2d.x * inverse_period.x);
+    distance2d.y -= period.y * std::nearbyint(distance2d.y * inverse_period.y);
+    return distance2d;
+}
+
+/// @brief Swept circle test of an object moving relative to another during a step.
+/// @param start2d The distance vector between the objects at the start of the step.
+/// @param motion2d The relative motion during the step.
+/// @param threshold The sum of the radiuses.
+/// @return The fraction of the step in [0, 1) when they start touching, or 1 if they don't.
+///         Objects that already overlap at the start are not considered touching.
+inline double GetTimeOfImpact(
+    const GravityFun::Math::Vec2& start2d,
+    const GravityFun::Math::Vec2& motion2d,
+    double threshold
+)
+{
+    double b = start2d.GetDotProduct(motion2d);
+    double c = start2d.GetDotProduct(start2d) - threshold * threshold;
+    if (b >= 0 || c <= 0)
+        return 1;
+    double discriminant = b * b - motion2d.GetDotProduct(motion2d) * c;
+    if (discriminant < 0)
+        return 1;
+    double time = c / (-b + std::sqrt(discriminant));
+    return time < 1 ? time : 1;
+}
+
+constexpr double NEAR_GRAVITY_RADIUS_SQUARED = GravityFun::GameManager::NEAR_GRAVITY_RADIUS * GravityFun::GameManager::NEAR_GRAVITY_RADIUS;
+
+constexpr double FLUID_H = GravityFun::GameManager::FLUID_SMOOTHING_LENGTH;
+constexpr double FLUID_H_SQUARED = FLUID_H * FLUID_H;
+/// @brief The 2D poly6 kernel is FLUID_POLY6 * (h^2 - r^2)^3, used for the density.
+constexpr double FLUID_POLY6 = 4 / (std::numbers::pi * FLUID_H_SQUARED * FLUID_H_SQUARED * FLUID_H_SQUARED * FLUID_H_SQUARED);
+/// @brief The 2D spiky kernel gradient magnitude is FLUID_SPIKY_GRADIENT * (h - r)^2, used for the pressure.
+constexpr double FLUID_SPIKY_GRADIENT = 30 / (std::numbers::pi * FLUID_H_SQUARED * FLUID_H_SQUARED * FLUID_H);
+/// @brief The 2D viscosity kernel Laplacian is FLUID_VISCOSITY_LAPLACIAN * (h - r).
+constexpr double FLUID_VISCOSITY_LAPLACIAN = 40 / (std::numbers::pi * FLUID_H_SQUARED * FLUID_H_SQUARED * FLUID_H);
+
+/// @brief The neighbor query radius of each species, the maximum of its interaction radiuses.
+constexpr auto SPECIES_MAX_INTERACTION_RADIUSES = []()
+{
+    constexpr int count = GravityFun::GameManager::SPECIES_COUNT;
+    std::array<double, count> radiuses{};
+    for (int i = 0; i < count; i++)
+        for (int j = 0; j < count; j++)
+            radiuses[i] = std::max(radiuses[i], GravityFun::GameManager::SPECIES_INTERACTION_RADIUSES[i * count + j]);
+    return radiuses;
+}();
+
+#if GRAVITYFUN_DEBUG
+/// @brief Every this many objects, the cached far gravity is compared with the exact one.
+constexpr int FAR_GRAVITY_ACCURACY_SAMPLING = 16;
+#endif
+
 namespace GravityFun
 {
     Physics::Physics(std::shared_ptr<GameManager> game_manager, int number, int total, Physics * pass1)
         : _GameManager(game_manager), Number(number), Total(total), Hybrid(pass1 != nullptr), Pass1(pass1),
-        LastTimeDiff(0), TimeDebt(0)
+        LastTimeDiff(0), TimeDebt(0), GravityAccelerations(GameManager::MAX_OBJECTS_COUNT)
     {
+        TraceName = std::string(Hybrid ? "Physics pass2 #" : "Physics pass1 #") + std::to_string(number);
         LastTime = std::chrono::steady_clock::now();
-        for (int i = 0; i < GameManager::MAX_OBJECTS_COUNT; i++)
+        if (Hybrid)
+            _GameManager->GetContactGraph().SetWorkersCount(total);
+        _GameManager->GetMetrics().SetWorkersCount(total);
+    }
+
+    double Physics::UpdateTimeDiff()
+    {
+        auto& last_time = Hybrid ? Pass1->LastTime : LastTime;
+        auto& time_diff = Hybrid ? Pass1->TimeDiff : TimeDiff;
+        auto& last_time_diff = Hybrid ? Pass1->LastTimeDiff : LastTimeDiff;
+        auto& time_debt = Hybrid ? Pass1->TimeDebt : TimeDebt;
+        auto time = std::chrono::steady_clock::now();
+        double fixed_time_diff = _GameManager->GetFixedTimeDiff();
+        if (fixed_time_diff > 0)
         {
-            // To make sure the loops/conditions that check LastCollisions do not go out of range,
-            // without needing the extra range condition.
-            LastCollisions[i][0] = GameManager::MAX_OBJECTS_COUNT + 1;
+            time_diff = fixed_time_diff;
+            time_debt = 0;
         }
+        else
+        {
+            double actual_time_diff = std::min(
+                GameManager::MAX_TIME_DIFF,
+                std::chrono::duration<double>(time - last_time).count()
+            ) * _GameManager->GetTimeMultiplier();
+            double offset = actual_time_diff + time_debt - last_time_diff;
+            double correction = std::abs(offset / actual_time_diff); // Scales small changes down to reduce oscillation
+            correction = _GameManager->GetTimeStrictness() * offset * correction;
+            if (std::abs(correction) > std::abs(offset))
+                correction = offset;
+            time_diff = last_time_diff + correction;
+            if (time_diff <= 0)
+                time_diff = actual_time_diff * GameManager::MIN_TIME_DIFF_SCALE;
+            time_debt += actual_time_diff - time_diff;
+        }
+        last_time_diff = time_diff;
+        last_time = time;
+        if (Number == 0)
+            _GameManager->ReportTimeDiff(time_diff);
+        return time_diff;
     }
 
     void Physics::OnRun()
     {
+        Trace::Scope scope(TraceName.c_str());
+        PerfCounters::Scope counters(Hybrid ? PerfCounters::Phase::PhysicsPass2 : PerfCounters::Phase::PhysicsPass1);
+        Metrics::Scope metrics(_GameManager->GetMetrics(), Hybrid ? Metrics::Pass::Physics2 : Metrics::Pass::Physics1, Number);
+        Allocations::Scope allocations(Hybrid ? Allocations::Module::PhysicsPass2 : Allocations::Module::PhysicsPass1);
         const auto& read_buffer = Hybrid ?
             _GameManager->GetPhysicsPass2ReadBuffer()
             : _GameManager->GetPhysicsPass1ReadBuffer();
@@ -30,181 +163,223 @@ namespace GravityFun
             _GameManager->GetPhysicsPass2WriteBuffer()
             : _GameManager->GetPhysicsPass1WriteBuffer();
 
+        bool unbounded = _GameManager->IsUnboundedOn();
         const auto& object_mapper = _GameManager->GetObjectMapper();
+        const auto& sparse_object_mapper = _GameManager->GetSparseObjectMapper();
+        // Queries the mapper of the current mode
+        auto visit_objects = [&](Math::Vec2 position, double radius, const auto& visitor) -> bool
+        {
+            return unbounded ?
+                sparse_object_mapper.VisitObjects(position, radius, visitor)
+                : object_mapper.VisitObjects(position, radius, visitor);
+        };
 
         const int objects_count = _GameManager->GetObjectsCount();
         const int begin = Number * objects_count / Total;
         const int end = (Number + 1) * objects_count / Total;
 
-        if (Hybrid && _GameManager->IsObjectCollisionOn()) // Object collision mode
+        bool col = _GameManager->IsBorderCollisionOn() && !unbounded;
+        bool wrap = !_GameManager->IsBorderCollisionOn() && !unbounded;
+        double bx = _GameManager->GetBorderX();
+        double by = _GameManager->GetBorderY();
+        Math::Vec2 period = wrap ? Math::Vec2(2 * bx, 2 * by) : Math::Vec2(0, 0);
+        Math::Vec2 inverse_period = wrap ? Math::Vec2(1 / period.x, 1 / period.y) : Math::Vec2(0, 0);
+
+        if (_GameManager->IsEventDrivenCollisionOn()) // Event-driven mode (collisions without forces)
         {
-            std::array<int, GameManager::MAX_COLLISION_COUNT> collided;
-            std::array<Math::Vec2, GameManager::MAX_COLLISION_COUNT> collision_direction;
-            std::array<double, GameManager::MAX_COLLISION_COUNT> collision_threshold;
+            if (Hybrid)
+            {
+                // Already moved by pass1
+                std::copy(read_buffer.begin() + begin, read_buffer.begin() + end, write_buffer.begin() + begin);
+            }
+            else
+            {
+                // Every pass1 module keeps its time diff updated for when the mode changes
+                double time_diff = UpdateTimeDiff();
+                if (Number == 0) // Events are processed in order, which is sequential
+                {
+                    _GameManager->GetEventDrivenCollisions().Advance(
+                        std::span<const FloatingObject>(read_buffer.data(), objects_count),
+                        std::span<FloatingObject>(write_buffer.data(), objects_count),
+                        time_diff, bx, by
+                    );
+                }
+            }
+        }
+        else if (Hybrid && _GameManager->IsContactDetectionOn()) // Object collision or merge mode (contact detection)
+        {
+            auto& contacts = _GameManager->GetContactGraph().GetWorkerContacts(Number);
+            const auto& collision_mapper = _GameManager->GetCollisionMapper();
+            double time_diff = Pass1->TimeDiff;
             for (int i = begin; i < end; i++)
             {
-                int collisions_count = 0;
-                object_mapper.VisitObjects(read_buffer[i].Position, 2 * GameManager::MAX_MASS * GameManager::MASS_TO_RADIUS,
+                int contacts_count = 0;
+                double earliest_collision_time = 1;
+                auto displacement = read_buffer[i].Velocity * time_diff;
+                // Only visits the levels of the collision mapper that have objects, each with its own maximum radius.
+                // The mapped radiuses include the displacements, so this reaches the objects that could have
+                // passed through this one during the step, and the pair test checks both displacements.
+                collision_mapper.VisitObjects(read_buffer[i].Position,
+                    read_buffer[i].Mass * GameManager::MASS_TO_RADIUS + ContactGraph::MARGIN + displacement.GetMagnitude(),
                     [&](int j) -> bool
                     {
                         if (i == j)
                             return false;
-                        auto distance2d = read_buffer[i].Position - read_buffer[j].Position; // from j, towards i
+                        auto difference2d = read_buffer[i].Position - read_buffer[j].Position;
+                        auto distance2d = GetNearestImage(difference2d, period, inverse_period); // from j, towards i
                         double distance = distance2d.GetMagnitude();
                         double threshold = (read_buffer[i].Mass + read_buffer[j].Mass) * GameManager::MASS_TO_RADIUS;
-                        if (distance < threshold)
+                        Math::Vec2 normal;
+                        if (distance < threshold + ContactGraph::MARGIN)
                         {
-                            collided[collisions_count] = j;
-                            collision_direction[collisions_count] = distance2d.GetNormalized();
-                            collision_threshold[collisions_count] = threshold;
-                            collisions_count++;
+                            if (j < i) // Each contact is detected by its lower index
+                                return false;
+                            normal = distance == 0 ? Math::Vec2(1, 0) : distance2d / distance;
                         }
-                        return collisions_count >= GameManager::MAX_COLLISION_COUNT;
+                        else
+                        {
+                            // Relative to j, i moved from start2d to distance2d
+                            auto motion2d = displacement - read_buffer[j].Velocity * time_diff;
+                            auto start2d = distance2d - motion2d;
+                            // Broadphase: the swept bounding box must reach the threshold
+                            if (std::min(start2d.x, distance2d.x) > threshold || std::max(start2d.x, distance2d.x) < -threshold
+                                || std::min(start2d.y, distance2d.y) > threshold || std::max(start2d.y, distance2d.y) < -threshold)
+                                return false;
+                            double time = GetTimeOfImpact(start2d, motion2d, threshold);
+                            if (time >= 1)
+                                return false;
+                            // Passed through each other
+                            earliest_collision_time = std::min(earliest_collision_time, time);
+                            if (j < i)
+                                return false;
+                            normal = (start2d + motion2d * time).GetNormalized();
+                        }
+                        // The masses, target velocity, and impulse are set by ContactGraph::Build
+                        contacts.push_back(ContactGraph::Contact{ i, j, normal, distance2d - difference2d, threshold, 0, 0, 0, 0, 0 });
+                        return ++contacts_count >= GameManager::MAX_COLLISION_COUNT;
                     }
                 );
 
-                write_buffer[i].Position = read_buffer[i].Position;
-
-                if (collisions_count == 0)
-                {
-                    write_buffer[i].Velocity = read_buffer[i].Velocity;
-                    continue;
-                }
-
-                auto shared_velocity = read_buffer[i].Velocity * read_buffer[i].Mass;
-                double shared_mass = read_buffer[i].Mass;
-                int last_col_i = 0;
-                for (int n = 0; n < collisions_count; n++)
-                {
-                    int j = collided[n];
-                    while (LastCollisions[i][last_col_i] < j) // No range condition required
-                    {
-                        last_col_i++;
-                    }
-                    if (LastCollisions[i][last_col_i] == j) // No range condition required
-                    {
-                        last_col_i++;
-                    }
-                    else
-                    {
-                        shared_velocity = read_buffer[j].Velocity * read_buffer[j].Mass;
-                        shared_mass += read_buffer[j].Mass;
-                    }
-                }
-                shared_velocity /= shared_mass;
-
-                Math::Vec2 rebound(0, 0);
-                int rebound_count = 0;
-                int new_collisions[GameManager::MAX_COLLISION_COUNT + 1];
-                last_col_i = 0;
-                for (int n = 0; n < collisions_count; n++)
-                {
-                    int j = collided[n];
-                    new_collisions[n] = j;
-                    while (LastCollisions[i][last_col_i] < j) // No range condition required
-                    {
-                        last_col_i++;
-                    }
-                    if (LastCollisions[i][last_col_i] == j) // No range condition required
-                    {
-                        last_col_i++;
-                    }
-                    else
-                    {
-                        auto col_dir = collision_direction[n];
-                        double rebound_d = (
-                            read_buffer[j].Velocity.GetDotProduct(col_dir)
-                            - read_buffer[i].Velocity.GetDotProduct(col_dir)
-                        ) * 0.5;
-                        rebound += col_dir * rebound_d;
-                        rebound_count++;
-                    }
-
-                    // Update position to exit collision
-                    auto distance2d = write_buffer[i].Position - read_buffer[j].Position; // from other, towards i
-                    double distance = distance2d.GetMagnitude();
-                    double col_threshold = collision_threshold[n];
-                    if (distance < col_threshold)
+                write_buffer[i] = read_buffer[i];
+                // Go back to the earliest swept collision, where the objects touch instead of passing through
+                write_buffer[i].Position -= displacement * (1 - earliest_collision_time);
+            }
+        }
+        else if (!Hybrid && _GameManager->IsFluidOn()) // Fluid density pass, the pass2 modules apply the forces
+        {
+            auto& densities = _GameManager->GetFluidDensities();
+            for (int i = begin; i < end; i++)
+            {
+                double density = 0; // Includes the object itself
+                visit_objects(read_buffer[i].Position, FLUID_H,
+                    [&](int j) -> bool
                     {
-                        write_buffer[i].Position
-                            += distance2d.GetNormalized()
-                                * ((col_threshold - distance) * 0.5); // Each object goes 0.5 => successful exit
+                        auto distance2d = GetNearestImage(read_buffer[j].Position - read_buffer[i].Position, period, inverse_period);
+                        double t = FLUID_H_SQUARED - distance2d.GetDotProduct(distance2d);
+                        if (t > 0)
+                            density += read_buffer[j].Mass * FLUID_POLY6 * t * t * t;
+                        return false;
                     }
-                }
-                // The new_collisions[collisions_count] is guaranteed to have no range issues
-                // as the array size is GameManager::MAX_COLLISION_COUNT + 1.
-                // This last value is to make sure the loops/conditions that check LastCollisions
-                // do not go out of range, without needing the extra range condition.
-                new_collisions[collisions_count] = GameManager::MAX_OBJECTS_COUNT + 1;
-                std::copy(std::begin(new_collisions), std::end(new_collisions), LastCollisions[i].begin());
-                if (rebound_count != 0)
-                {
-                    rebound /= rebound_count;
-                    write_buffer[i].Velocity = shared_velocity + rebound * 0.5 * GameManager::COLLISION_PRESERVE;
-                }
-                else // Collided but no new collision
-                {
-                    auto prev_pos = read_buffer[i].Position - read_buffer[i].Velocity * Pass1->TimeDiff;
-                    write_buffer[i].Velocity = (write_buffer[i].Position - prev_pos) / Pass1->TimeDiff;
-                }
+                );
+                densities[i] = density;
+                write_buffer[i] = read_buffer[i];
             }
         }
         else // Normal mode (forces, motion, and border collision)
         {
-            auto& last_time = Hybrid ? Pass1->LastTime : LastTime;
-            auto& time_diff = Hybrid ? Pass1->TimeDiff : TimeDiff;
-            auto& last_time_diff = Hybrid ? Pass1->LastTimeDiff : LastTimeDiff;
-            auto& time_debt = Hybrid ? Pass1->TimeDebt : TimeDebt;
-            auto time = std::chrono::steady_clock::now();
-            double actual_time_diff = std::min(
-                GameManager::MAX_TIME_DIFF,
-                std::chrono::duration<double>(time - last_time).count()
-            ) * _GameManager->GetTimeMultiplier();
-            double offset = actual_time_diff + time_debt - last_time_diff;
-            double correction = std::abs(offset / actual_time_diff); // Scales small changes down to reduce oscillation
-            correction = _GameManager->GetTimeStrictness() * offset * correction;
-            if (std::abs(correction) > std::abs(offset))
-                correction = offset;
-            time_diff = last_time_diff + correction;
-            if (time_diff <= 0)
-                time_diff = actual_time_diff * GameManager::MIN_TIME_DIFF_SCALE;
-            last_time_diff = time_diff;
-            time_debt += actual_time_diff - time_diff;
-            last_time = time;
+            double time_diff = UpdateTimeDiff();
 
-            bool g = _GameManager->IsRelativeGravityOn();
+            bool fluid = _GameManager->IsFluidOn();
+            const auto& densities = _GameManager->GetFluidDensities();
+            double max_fluid_acceleration = GameManager::FLUID_MAX_STEP_DISPLACEMENT * FLUID_H / (time_diff * time_diff);
+            bool species = _GameManager->IsSpeciesInteractionOn();
+            double species_damping = std::exp(-GameManager::SPECIES_FRICTION * time_diff);
+            bool g = _GameManager->IsMassGravityOn();
             double g_scale = _GameManager->GetRelativeGravityScale();
-            bool col = _GameManager->IsBorderCollisionOn();
-            double bx = _GameManager->GetBorderX();
-            double by = _GameManager->GetBorderY();
             Math::Vec2 mouse_position(_GameManager->GetMousePositionX(), _GameManager->GetMousePositionY());
             double mouse_g = _GameManager->IsMousePulling() ?
                                 GameManager::MOUSE_GRAVITY_ACCELERATION
                                 : (_GameManager->IsMousePushing() ? -GameManager::MASS_GRAVITY_ACCELERATION : 0);
             double braking = _GameManager->IsMouseBraking();
             double down_acceleration = _GameManager->IsDownGravityOn() ? GameManager::DOWN_GRAVITY_ACCELERATION : 0;
-            for (int i = begin; i < end; i++)
+            GravityEngine engine = _GameManager->GetGravityEngine();
+            // With a cutoff over half the period, several images of an object would be in range in the wrap around mode
+            // (like in x in a portrait window), so it's clamped there to keep the nearest image sum exact
+            double gravity_radius = wrap ? std::min({ GameManager::MASS_GRAVITY_RADIUS, bx, by }) : GameManager::MASS_GRAVITY_RADIUS;
+            double gravity_radius_squared = gravity_radius * gravity_radius;
+            auto& far_gravity_cache = _GameManager->GetFarGravityCache();
+            const auto& obstacle_field = _GameManager->GetObstacleField();
+            bool obstacles = !obstacle_field.IsEmpty();
+#if GRAVITYFUN_DEBUG
+            double far_gravity_error_squared = 0;
+            double far_gravity_exact_squared = 0;
+#endif
+            // The gravity is accumulated in a loop of its own, so only it is timed for the force engine selector
+            if (g)
             {
-                // Acceleration
-                Math::Vec2 net_acceleration(0, 0);
-                if (g)
+                auto pass_start_time = std::chrono::steady_clock::now();
+                for (int i = begin; i < end; i++)
                 {
-                    if (objects_count > 10)
+                    Math::Vec2 net_acceleration(0, 0);
+                    if (engine == GravityEngine::GridWalk)
                     {
-                        object_mapper.VisitObjects(read_buffer[i].Position, GameManager::MASS_GRAVITY_RADIUS,
+                        // The near gravity is calculated every step, the far gravity is cached
+                        auto& far_gravity = far_gravity_cache[i];
+                        bool refresh = far_gravity.Age < 0
+                            || far_gravity.Age >= GameManager::FAR_GRAVITY_REFRESH_STEPS
+                            || (read_buffer[i].Position - far_gravity.Position).GetMagnitude() > GameManager::FAR_GRAVITY_DRIFT_TOLERANCE;
+                        Math::Vec2 far_acceleration(0, 0);
+                        visit_objects(read_buffer[i].Position,
+                            refresh ? gravity_radius : GameManager::NEAR_GRAVITY_RADIUS,
                             [&](int j) -> bool
                             {
                                 if (i == j)
                                     return false;
-                                auto distance2d = read_buffer[j].Position - read_buffer[i].Position;
-                                double distance = distance2d.GetMagnitude();
-                                if (distance > GameManager::MASS_GRAVITY_RADIUS)
+                                auto distance2d = GetNearestImage(read_buffer[j].Position - read_buffer[i].Position, period, inverse_period);
+                                double distance_squared = distance2d.GetDotProduct(distance2d);
+                                if (distance_squared > gravity_radius_squared
+                                    || (!refresh && distance_squared > NEAR_GRAVITY_RADIUS_SQUARED))
                                     return false;
-                                double f = distance == 0 ? 0 : read_buffer[j].Mass * GameManager::MASS_GRAVITY_ACCELERATION / (distance * distance);
-                                net_acceleration += distance2d.GetNormalized() * f;
+                                double f = read_buffer[j].Mass * GameManager::MASS_GRAVITY_ACCELERATION * GetGravityKernel(distance_squared);
+                                if (distance_squared > NEAR_GRAVITY_RADIUS_SQUARED)
+                                    far_acceleration += distance2d * f;
+                                else
+                                    net_acceleration += distance2d * f;
                                 return false;
                             }
                         );
+                        if (refresh)
+                        {
+                            far_gravity.Acceleration = far_acceleration;
+                            far_gravity.Position = read_buffer[i].Position;
+                            // Spread the refreshes of a fully invalidated cache over the steps
+                            far_gravity.Age = far_gravity.Age < 0 ? i % GameManager::FAR_GRAVITY_REFRESH_STEPS : 0;
+                        }
+                        far_gravity.Age++;
+                        net_acceleration += far_gravity.Acceleration;
+#if GRAVITYFUN_DEBUG
+                        if (i % FAR_GRAVITY_ACCURACY_SAMPLING == 0)
+                        {
+                            Math::Vec2 exact_acceleration(0, 0);
+                            visit_objects(read_buffer[i].Position, gravity_radius,
+                                [&](int j) -> bool
+                                {
+                                    if (i == j)
+                                        return false;
+                                    auto distance2d = GetNearestImage(read_buffer[j].Position - read_buffer[i].Position, period, inverse_period);
+                                    double distance_squared = distance2d.GetDotProduct(distance2d);
+                                    if (distance_squared > gravity_radius_squared)
+                                        return false;
+                                    double f = read_buffer[j].Mass * GameManager::MASS_GRAVITY_ACCELERATION * GetGravityKernel(distance_squared);
+                                    exact_acceleration += distance2d * f;
+                                    return false;
+                                }
+                            );
+                            auto error = net_acceleration - exact_acceleration;
+                            far_gravity_error_squared += error.GetDotProduct(error);
+                            far_gravity_exact_squared += exact_acceleration.GetDotProduct(exact_acceleration);
+                        }
+#endif
                     }
                     else
                     {
@@ -212,13 +387,88 @@ namespace GravityFun
                         {
                             if (i == j)
                                 continue;
-                            auto distance2d = read_buffer[j].Position - read_buffer[i].Position;
-                            double distance = distance2d.GetMagnitude();
-                            double f = distance == 0 ? 0 : read_buffer[j].Mass * GameManager::MASS_GRAVITY_ACCELERATION / (distance * distance);
-                            net_acceleration += distance2d.GetNormalized() * f;
+                            auto distance2d = GetNearestImage(read_buffer[j].Position - read_buffer[i].Position, period, inverse_period);
+                            double distance_squared = distance2d.GetDotProduct(distance2d);
+                            if (wrap && distance_squared > gravity_radius_squared)
+                                continue;
+                            double f = read_buffer[j].Mass * GameManager::MASS_GRAVITY_ACCELERATION * GetGravityKernel(distance_squared);
+                            net_acceleration += distance2d * f;
                         }
                     }
-                    net_acceleration = net_acceleration * g_scale;
+                    GravityAccelerations[i - begin] = net_acceleration * g_scale;
+                }
+                _GameManager->GetForceEngineSelector().ReportForcePass(
+                    engine,
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - pass_start_time).count(),
+                    end - begin
+                );
+            }
+            for (int i = begin; i < end; i++)
+            {
+                // Acceleration
+                Math::Vec2 net_acceleration(0, 0);
+                if (g)
+                {
+                    net_acceleration = GravityAccelerations[i - begin];
+                }
+                else if (species)
+                {
+                    // The row of the interaction table of this species
+                    int row = read_buffer[i].Species * GameManager::SPECIES_COUNT;
+                    visit_objects(read_buffer[i].Position, SPECIES_MAX_INTERACTION_RADIUSES[read_buffer[i].Species],
+                        [&](int j) -> bool
+                        {
+                            if (i == j)
+                                return false;
+                            auto distance2d = GetNearestImage(read_buffer[j].Position - read_buffer[i].Position, period, inverse_period);
+                            double distance_squared = distance2d.GetDotProduct(distance2d);
+                            int pair = row + read_buffer[j].Species;
+                            double radius = GameManager::SPECIES_INTERACTION_RADIUSES[pair];
+                            if (distance_squared >= radius * radius || distance_squared == 0)
+                                return false;
+                            double distance = std::sqrt(distance_squared);
+                            double ratio = distance / radius;
+                            // Repulsion up close, then a tent shaped pull or push that peaks halfway through the rest
+                            double f = ratio < GameManager::SPECIES_REPULSION_RATIO ?
+                                ratio / GameManager::SPECIES_REPULSION_RATIO - 1
+                                : GameManager::SPECIES_INTERACTION_COEFFICIENTS[pair]
+                                    * (1 - std::abs(2 * ratio - 1 - GameManager::SPECIES_REPULSION_RATIO) / (1 - GameManager::SPECIES_REPULSION_RATIO));
+                            net_acceleration += distance2d * (f * radius / distance);
+                            return false;
+                        }
+                    );
+                    net_acceleration = net_acceleration * GameManager::SPECIES_INTERACTION_ACCELERATION;
+                }
+                else if (fluid)
+                {
+                    // Symmetric pressure, so the pairs push each other equally, and viscosity
+                    double pressure_i = std::max(0.0, GameManager::FLUID_STIFFNESS * (densities[i] - GameManager::FLUID_REST_DENSITY));
+                    double pressure_term_i = pressure_i / (densities[i] * densities[i]);
+                    Math::Vec2 viscosity_acceleration(0, 0);
+                    visit_objects(read_buffer[i].Position, FLUID_H,
+                        [&](int j) -> bool
+                        {
+                            if (i == j)
+                                return false;
+                            auto distance2d = GetNearestImage(read_buffer[i].Position - read_buffer[j].Position, period, inverse_period);
+                            double distance_squared = distance2d.GetDotProduct(distance2d);
+                            if (distance_squared >= FLUID_H_SQUARED || distance_squared == 0)
+                                return false;
+                            double distance = std::sqrt(distance_squared);
+                            double pressure_j = std::max(0.0, GameManager::FLUID_STIFFNESS * (densities[j] - GameManager::FLUID_REST_DENSITY));
+                            double pressure_term = pressure_term_i + pressure_j / (densities[j] * densities[j]);
+                            double f = read_buffer[j].Mass * pressure_term * FLUID_SPIKY_GRADIENT * (FLUID_H - distance) * (FLUID_H - distance);
+                            net_acceleration += distance2d * (f / distance);
+                            viscosity_acceleration += (read_buffer[j].Velocity - read_buffer[i].Velocity)
+                                * (read_buffer[j].Mass / densities[j] * FLUID_VISCOSITY_LAPLACIAN * (FLUID_H - distance));
+                            return false;
+                        }
+                    );
+                    net_acceleration += viscosity_acceleration * (GameManager::FLUID_VISCOSITY / densities[i]);
+                    // Too strong pushes would overshoot the neighbors in a long step
+                    double magnitude = net_acceleration.GetMagnitude();
+                    if (magnitude > max_fluid_acceleration)
+                        net_acceleration = net_acceleration * (max_fluid_acceleration / magnitude);
                 }
                 net_acceleration.y -= down_acceleration;
                 // Mouse pull/push
@@ -229,8 +479,12 @@ namespace GravityFun
                     double f = distance == 0 ? 0 : mouse_g / (distance * distance);
                     net_acceleration += distance2d.GetNormalized() * f;
                 }
+                // The merges, spawns, and removals only change the latest buffer, so the whole object is carried over
+                write_buffer[i] = read_buffer[i];
                 // Velocity
                 write_buffer[i].Velocity = read_buffer[i].Velocity + net_acceleration * time_diff;
+                if (species)
+                    write_buffer[i].Velocity = write_buffer[i].Velocity * species_damping;
                 // Braking (applied to velocity)
                 if (braking)
                 {
@@ -256,8 +510,9 @@ namespace GravityFun
                 // Handle out of borders position
                 if (col) // Border collision => bounce
                 {
-                    double local_bx = bx - read_buffer[i].Mass * GameManager::MASS_TO_RADIUS;
-                    double local_by = by - read_buffer[i].Mass * GameManager::MASS_TO_RADIUS;
+                    // At least 0, as the merged objects can be larger than the domain
+                    double local_bx = std::max(0.0, bx - read_buffer[i].Mass * GameManager::MASS_TO_RADIUS);
+                    double local_by = std::max(0.0, by - read_buffer[i].Mass * GameManager::MASS_TO_RADIUS);
                     if (write_buffer[i].Position.x < -local_bx)
                     {
                         write_buffer[i].Position.x = -local_bx + (-local_bx - write_buffer[i].Position.x);
@@ -279,7 +534,7 @@ namespace GravityFun
                         write_buffer[i].Velocity.y = -write_buffer[i].Velocity.y * GameManager::COLLISION_PRESERVE;
                     }
                 }
-                else // No border collision => come from the other side
+                else if (wrap) // No border collision => come from the other side
                 {
                     if (write_buffer[i].Position.x < -bx)
                     {
@@ -298,7 +553,24 @@ namespace GravityFun
                         write_buffer[i].Position.y = -by + (write_buffer[i].Position.y - (by));
                     }
                 }
+                // Obstacle collision => bounce, with one lookup regardless of the obstacles
+                if (obstacles)
+                {
+                    auto sample = obstacle_field.GetSample(write_buffer[i].Position);
+                    double overlap = read_buffer[i].Mass * GameManager::MASS_TO_RADIUS - sample.Distance;
+                    if (overlap > 0)
+                    {
+                        write_buffer[i].Position += sample.Normal * overlap;
+                        double normal_velocity = write_buffer[i].Velocity.GetDotProduct(sample.Normal);
+                        if (normal_velocity < 0)
+                            write_buffer[i].Velocity -= sample.Normal * (normal_velocity * (1 + GameManager::COLLISION_PRESERVE));
+                    }
+                }
             }
+#if GRAVITYFUN_DEBUG
+            if (far_gravity_exact_squared != 0)
+                _GameManager->ReportFarGravityError(far_gravity_error_squared, far_gravity_exact_squared);
+#endif
         }
     }
 }
@@ -4,9 +4,10 @@
 
 #include "GameManager.h"
 
-#include <array>
 #include <chrono>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace GravityFun
 {
@@ -17,9 +18,11 @@ namespace GravityFun
         /// @param number Zero-based number of this physics module.
         /// @param total The total number of physics modules.
         /// @param pass1 The pass1 module with the same number if this is a hybrid (pass2) module.
-        ///              Hybrid means whether the module is turned into a object collision module
-        ///              when the GameManager::IsObjectCollisionOn() returns true.
+        ///              Hybrid means whether the module is turned into a contact detection module
+        ///              when GameManager::IsContactDetectionOn() returns true.
         ///              Else it will only calculate forces, motion, and border collision.
+        ///              When GameManager::IsFluidOn() returns true, the pass1 modules only calculate
+        ///              the fluid densities, and the pass2 modules apply the fluid forces.
         ///              Also, if true, this module's considered a part of pass2, else pass1.
         explicit Physics(std::shared_ptr<GameManager>, int number = 0, int total = 1, Physics * pass1 = nullptr);
 
@@ -35,13 +38,18 @@ namespace GravityFun
         int Total;
         bool Hybrid;
         Physics * Pass1;
+        /// @brief The name of this module's spans in the trace.
+        std::string TraceName;
 
         std::chrono::steady_clock::time_point LastTime;
         double TimeDiff;
         double LastTimeDiff;
         double TimeDebt;
+        /// @brief The gravity accelerations of this module's objects, from the object at begin.
+        std::vector<Math::Vec2> GravityAccelerations;
 
-        /// @brief Used for collision mode
-        std::array<std::array<int, GameManager::MAX_COLLISION_COUNT + 1>, GameManager::MAX_OBJECTS_COUNT> LastCollisions;
+        /// @brief Updates the time diff of this module, or of the pass1 module if this is a hybrid module.
+        /// @return The updated time diff.
+        double UpdateTimeDiff();
     };
 }
@@ -0,0 +1,97 @@
+#include "PoissonDiskSampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GravityFun
+{
+    PoissonDiskSampler::PoissonDiskSampler()
+        : BorderX(1), BorderY(1), MinDistanceSquared(0), PositionToIndex(1), CellsCountX(1), CellsCountY(1)
+    {
+    }
+
+    void PoissonDiskSampler::Reset(double border_x, double border_y, double min_distance)
+    {
+        BorderX = border_x;
+        BorderY = border_y;
+        MinDistanceSquared = min_distance * min_distance;
+        // The cell diagonal is the minimum distance, so no 2 placed points share a cell
+        PositionToIndex = std::sqrt(2.0) / min_distance;
+        CellsCountX = std::max(1, (int)std::ceil(2 * border_x * PositionToIndex));
+        CellsCountY = std::max(1, (int)std::ceil(2 * border_y * PositionToIndex));
+        Cells.assign(CellsCountX * CellsCountY, -1);
+        Points.clear();
+        NextPoints.clear();
+    }
+
+    void PoissonDiskSampler::AddPoint(Math::Vec2 point)
+    {
+        int cell = GetCellIndex(point);
+        if (cell == -1)
+            return;
+        // Added points can be closer than the minimum distance, so a cell can have more
+        NextPoints.push_back(Cells[cell]);
+        Cells[cell] = (int)Points.size();
+        Points.push_back(point);
+    }
+
+    bool PoissonDiskSampler::Place(Random& random, double margin, Math::Vec2& point)
+    {
+        double x = BorderX - margin;
+        double y = BorderY - margin;
+        if (x < 0 || y < 0)
+            return false;
+        for (int i = 0; i < MAX_ATTEMPTS; i++)
+        {
+            Math::Vec2 candidate(random.GetDouble(-x, x), random.GetDouble(-y, y));
+            if (TryAddPoint(candidate))
+            {
+                point = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool PoissonDiskSampler::TryAddPoint(Math::Vec2 point)
+    {
+        if (GetCellIndex(point) == -1 || !IsFarEnough(point))
+            return false;
+        AddPoint(point);
+        return true;
+    }
+
+    int PoissonDiskSampler::GetCellIndex(Math::Vec2 point) const
+    {
+        int x = (int)std::floor((point.x + BorderX) * PositionToIndex);
+        int y = (int)std::floor((point.y + BorderY) * PositionToIndex);
+        if (point.x == BorderX) // The upper borders are in the area
+            x = CellsCountX - 1;
+        if (point.y == BorderY)
+            y = CellsCountY - 1;
+        if (x < 0 || x >= CellsCountX || y < 0 || y >= CellsCountY)
+            return -1;
+        return y * CellsCountX + x;
+    }
+
+    bool PoissonDiskSampler::IsFarEnough(Math::Vec2 point) const
+    {
+        int cell = GetCellIndex(point);
+        int cell_x = cell % CellsCountX;
+        int cell_y = cell / CellsCountX;
+        // The minimum distance is within 2 cells
+        for (int y = std::max(0, cell_y - 2); y <= std::min(CellsCountY - 1, cell_y + 2); y++)
+        {
+            for (int x = std::max(0, cell_x - 2); x <= std::min(CellsCountX - 1, cell_x + 2); x++)
+            {
+                for (int i = Cells[y * CellsCountX + x]; i != -1; i = NextPoints[i])
+                {
+                    auto offset = Points[i] - point;
+                    if (offset.GetDotProduct(offset) < MinDistanceSquared)
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Math.h"
+#include "Random.h"
+
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Places points at random with a minimum distance between them (Poisson-disk sampling),
+    ///        on a grid with cells small enough to hold one placed point each,
+    ///        so a placement only checks the 5x5 nearby cells.
+    class PoissonDiskSampler final
+    {
+    public:
+        PoissonDiskSampler();
+
+        PoissonDiskSampler(const PoissonDiskSampler&) = delete;
+        PoissonDiskSampler(PoissonDiskSampler&&) = delete;
+        PoissonDiskSampler& operator=(const PoissonDiskSampler&) = delete;
+        PoissonDiskSampler& operator=(PoissonDiskSampler&&) = delete;
+
+        /// @brief The number of random candidates tried for a point before giving up.
+        static constexpr int MAX_ATTEMPTS = 30;
+
+        /// @brief Removes the points and sets the area [-border_x, border_x] * [-border_y, border_y].
+        void Reset(double border_x, double border_y, double min_distance);
+        /// @brief Adds a point that the placed points keep away from, like an existing object.
+        ///        Points beyond the area are ignored.
+        void AddPoint(Math::Vec2 point);
+        /// @brief Places a point at least the minimum distance away from the others,
+        ///        and at least the margin away from the borders.
+        /// @return Whether a place was found within MAX_ATTEMPTS candidates, else the point is not changed.
+        bool Place(Random& random, double margin, Math::Vec2& point);
+        /// @brief Adds the point if it is at least the minimum distance away from the others,
+        ///        for placing points of other distributions.
+        /// @return Whether the point was added.
+        bool TryAddPoint(Math::Vec2 point);
+    private:
+        double BorderX;
+        double BorderY;
+        double MinDistanceSquared;
+        double PositionToIndex;
+        int CellsCountX;
+        int CellsCountY;
+        /// @brief The last added point of each cell, or -1, followed by NextPoints.
+        std::vector<int> Cells;
+        std::vector<Math::Vec2> Points;
+        /// @brief The previously added point of the same cell for each point, or -1.
+        std::vector<int> NextPoints;
+
+        int GetCellIndex(Math::Vec2 point) const;
+        bool IsFarEnough(Math::Vec2 point) const;
+    };
+}
@@ -6,9 +6,20 @@ namespace GravityFun
     {
     }
 
+    void Random::Seed(unsigned int seed)
+    {
+        mt.seed(seed);
+    }
+
     double Random::GetDouble(double min, double max)
     {
         std::uniform_real_distribution<double> distribution(min, max);
         return distribution(mt);
     }
+
+    double Random::GetNormal(double mean, double standard_deviation)
+    {
+        std::normal_distribution<double> distribution(mean, standard_deviation);
+        return distribution(mt);
+    }
 }
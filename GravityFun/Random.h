@@ -9,7 +9,11 @@ namespace GravityFun
     public:
         Random();
 
+        void Seed(unsigned int seed);
+
         double GetDouble(double min = 0, double max = 1);
+        /// @brief Normally distributed.
+        double GetNormal(double mean = 0, double standard_deviation = 1);
     private:
         std::random_device device;
         std::mt19937 mt;
@@ -1,6 +1,8 @@
 #include "Renderer.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <numbers>
 #include <random>
 
@@ -8,6 +10,9 @@
 #include "Shaders.h"
 #include "Window.h"
 #include "GameManager.h"
+#include "Allocations.h"
+#include "PerfCounters.h"
+#include "Trace.h"
 
 constexpr int CIRCLE_RESOLUTION = 80;
 
@@ -18,18 +23,61 @@ constexpr float HINT_ICON_Z = 0.05;
 constexpr float HINT_ICON_SIZE = 0.03;
 constexpr float HINT_ICON_PADDING = 0.01;
 constexpr float HINT_ICON_ANIMATION_SPEED = 4;
+/// @brief The brightness of the hints of the toggles that the fluid mode replaces.
+constexpr float HINT_ICON_REPLACED_BRIGHTNESS = 0.35;
+
+/// @brief The colors that the objects are tinted with by their species in the species interaction mode.
+constexpr double SPECIES_COLORS[GravityFun::GameManager::SPECIES_COUNT][3] = {
+    { 1, 0.35, 0.35 },
+    { 0.35, 1, 0.45 },
+    { 0.4, 0.55, 1 },
+    { 1, 0.85, 0.3 },
+};
+/// @brief How much the species color replaces the object color.
+constexpr double SPECIES_TINT = 0.75;
+
+/// @brief The radius of the marks where the emitters are.
+constexpr double EMITTER_MARK_RADIUS = 0.015;
+
+/// @brief Appended to the window title when the fluid mode replaces the object collisions that are on.
+constexpr const char * FLUID_TITLE_NOTE = " | fluid replaces object collisions";
+
+/// @brief The bottom left corner of the performance overlay, in the normalized device coordinates.
+constexpr float OVERLAY_X = -0.97;
+constexpr float OVERLAY_Y = -0.97;
+constexpr float OVERLAY_WIDTH = 0.6;
+constexpr float OVERLAY_ROW_HEIGHT = 0.03;
+constexpr float OVERLAY_PADDING = 0.01;
+/// @brief The height of the rows of all the workers together.
+constexpr float OVERLAY_WORKERS_HEIGHT = 0.2;
+/// @brief The frame time of a full bar, in seconds.
+constexpr double OVERLAY_FRAME_TIME_SCALE = 1.0 / 30;
+/// @brief The frame time that is marked on the frame time bars, in seconds.
+constexpr double OVERLAY_FRAME_TIME_MARK = 1.0 / 60;
+/// @brief The colors of physics pass1, physics pass2, contact solving, and the serial modules in the step bar.
+constexpr float OVERLAY_STEP_COLORS[4][3] = {
+    { 0.3, 0.5, 1 },
+    { 0.3, 0.9, 0.4 },
+    { 1, 0.85, 0.3 },
+    { 0.6, 0.6, 0.6 },
+};
 
 namespace GravityFun
 {
     Renderer::Renderer(std::shared_ptr<Window> window, std::shared_ptr<GameManager> game_manager)
-        : _Window(window), _GameManager(game_manager), MainThreadId(std::this_thread::get_id()),
-          Program(SimpleVertexShaderSource, SimpleFragmentShaderSource),
+        : LoopScheduler::Module(false, nullptr, nullptr, true),
+          _Window(window), _GameManager(game_manager), MainThreadId(std::this_thread::get_id()),
           Circle(BufferGeneration::GenerateCircle(CIRCLE_RESOLUTION)),
+          Square(BufferGeneration::GenerateSquare()),
+          Obstacles(BufferGeneration::GenerateObstacles(game_manager->GetObstacleField().GetShapes(), CIRCLE_RESOLUTION)),
           DownGravityToggle(BufferGeneration::GenerateDownGravityToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           RelativeGravityToggle(BufferGeneration::GenerateRelativeGravityToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           VariableMassToggle(BufferGeneration::GenerateVariableMassToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           BorderCollisionToggle(BufferGeneration::GenerateBorderCollisionToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
+          UnboundedToggle(BufferGeneration::GenerateUnboundedToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           ObjectCollisionToggle(BufferGeneration::GenerateObjectCollisionToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
+          MergeToggle(BufferGeneration::GenerateMergeToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
+          SpeciesInteractionToggle(BufferGeneration::GenerateSpeciesInteractionToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           MotionBlurToggle(BufferGeneration::GenerateMotionBlurToggle(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           ObjectsCountSlider(BufferGeneration::GenerateObjectsCountSlider(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           TimeMultiplierSlider(BufferGeneration::GenerateTimeMultiplierSlider(
@@ -40,7 +88,8 @@ namespace GravityFun
           )),
           EnergySavingSlider(BufferGeneration::GenerateEnergySavingSlider(CIRCLE_RESOLUTION, HINT_ICON_Z)),
           LastTime(std::chrono::steady_clock::now()),
-          LoopScheduler::Module(false, nullptr, nullptr, true)
+          Program(SimpleVertexShaderSource, SimpleFragmentShaderSource),
+          OverlaySnapshotNumber(-1), OriginalTitle(window->GetTitle()), FluidNoteShown(false)
     {
         ProgramModelUniform = Program.GetUniformLocation("Model");
         ProgramViewUniform = Program.GetUniformLocation("View");
@@ -51,31 +100,39 @@ namespace GravityFun
         AnimatedModels.push_back(&RelativeGravityToggle);
         AnimatedModels.push_back(&VariableMassToggle);
         AnimatedModels.push_back(&BorderCollisionToggle);
+        AnimatedModels.push_back(&UnboundedToggle);
         AnimatedModels.push_back(&ObjectCollisionToggle);
+        AnimatedModels.push_back(&MergeToggle);
+        AnimatedModels.push_back(&SpeciesInteractionToggle);
         AnimatedModels.push_back(&MotionBlurToggle);
         AnimatedModels.push_back(&ObjectsCountSlider);
         AnimatedModels.push_back(&TimeMultiplierSlider);
         AnimatedModels.push_back(&EnergySavingSlider);
-        AnimationTargetFunctions[&DownGravityToggle] = [this]() { return _GameManager->IsDownGravityOn() ? 1 : 0; };
-        AnimationTargetFunctions[&RelativeGravityToggle] = [this]() { return _GameManager->GetRelativeGravityScale() * 0.5 + 0.5; };
-        AnimationTargetFunctions[&VariableMassToggle] = [this]() { return _GameManager->IsVariableMassOn() ? 1 : 0; };
-        AnimationTargetFunctions[&BorderCollisionToggle] = [this]() { return _GameManager->IsBorderCollisionOn() ? 1 : 0; };
-        AnimationTargetFunctions[&ObjectCollisionToggle] = [this]() { return _GameManager->IsObjectCollisionOn() ? 1 : 0; };
-        AnimationTargetFunctions[&MotionBlurToggle] = [this]() { return _GameManager->IsMotionBlurOn() ? 1 : 0; };
-        AnimationTargetFunctions[&ObjectsCountSlider] = [this]() { return (float)_GameManager->GetObjectsCount() / GameManager::MAX_OBJECTS_COUNT; };
-        AnimationTargetFunctions[&TimeMultiplierSlider] = [this]() {
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsDownGravityOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->GetRelativeGravityScale() * 0.5 + 0.5; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsVariableMassOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsBorderCollisionOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsUnboundedOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsObjectCollisionOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsMergeOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsSpeciesInteractionOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return _GameManager->IsMotionBlurOn() ? 1 : 0; });
+        AnimationTargetFunctions.push_back([this]() { return (float)_GameManager->GetRenderObjectsCount() / GameManager::MAX_OBJECTS_COUNT; });
+        AnimationTargetFunctions.push_back([this]() {
             return (std::log2(_GameManager->GetTimeMultiplier()) - std::log2(GameManager::MIN_TIME_MULTIPLIER))
                 / (std::log2(GameManager::MAX_TIME_MULTIPLIER) - std::log2(GameManager::MIN_TIME_MULTIPLIER));
-        };
-        AnimationTargetFunctions[&EnergySavingSlider] = [this]() {
+        });
+        AnimationTargetFunctions.push_back([this]() {
             return (
                 (_GameManager->GetPhysicsFidelity() - GameManager::MIN_PHYSICS_FIDELITY)
                 / (GameManager::MAX_PHYSICS_FIDELITY - GameManager::MIN_PHYSICS_FIDELITY)
             );
-        };
+        });
 
-        for (auto& item : AnimatedModels)
-            item->SetState(AnimationTargetFunctions[item]());
+        for (int i = 0; i < AnimatedModels.size(); i++)
+            AnimatedModels[i]->SetState(AnimationTargetFunctions[i]());
+        ToggleAnimations.resize(AnimatedModels.size(), Animation{ false, 0, 0, 0 });
+        ObjectColors.resize(GameManager::MAX_OBJECTS_COUNT, ObjectColor{ -1, 0, 0, 0 });
 
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -115,6 +172,9 @@ namespace GravityFun
 
     void Renderer::OnRun()
     {
+        Trace::Scope scope("Renderer");
+        PerfCounters::Scope counters(PerfCounters::Phase::Rendering);
+        Allocations::Scope allocations(Allocations::Module::Rendering);
         UpdateView();
 
         _Window->MakeCurrent();
@@ -129,18 +189,14 @@ namespace GravityFun
         glUniformMatrix4fv(ProgramProjectionUniform, 1, GL_FALSE, ProjectionMatrix.GetData());
 
         // Update hints
-        for (auto& item : AnimatedModels)
+        for (int i = 0; i < AnimatedModels.size(); i++)
         {
-            float temp = AnimationTargetFunctions[item]();
-            if (
-                    temp != item->GetState()
-                    && (
-                        !ActiveToggleAnimations.contains(item)
-                        || temp != ActiveToggleAnimations[item].e
-                    )
-                )
-                ActiveToggleAnimations[item] = Animation{
-                    item->GetState(),
+            float temp = AnimationTargetFunctions[i]();
+            auto& animation = ToggleAnimations[i];
+            if (temp != AnimatedModels[i]->GetState() && (!animation.Active || temp != animation.e))
+                animation = Animation{
+                    true,
+                    AnimatedModels[i]->GetState(),
                     temp,
                     0
                 };
@@ -151,47 +207,93 @@ namespace GravityFun
         std::chrono::duration<float> time_diff_d = now - LastTime;
         float time_diff = time_diff_d.count();
         LastTime = now;
+        _GameManager->GetMetrics().AddFrame(time_diff);
         if (time_diff > GameManager::MAX_TIME_DIFF)
             time_diff = GameManager::MAX_TIME_DIFF;
         float t_diff = time_diff * HINT_ICON_ANIMATION_SPEED;
 
         // Update animations
-        std::vector<AnimatedModel*> animations_to_remove;
-        for (auto& item : ActiveToggleAnimations)
+        for (int i = 0; i < AnimatedModels.size(); i++)
         {
-            item.second.t += t_diff;
-            if (item.second.t >= 1)
+            auto& animation = ToggleAnimations[i];
+            if (!animation.Active)
+                continue;
+            animation.t += t_diff;
+            if (animation.t >= 1)
             {
-                item.first->SetState(
-                    item.second.e
+                AnimatedModels[i]->SetState(
+                    animation.e
                 );
-                animations_to_remove.push_back(item.first);
+                animation.Active = false;
             }
             else
             {
-                item.first->SetState(
-                    item.second.s + (item.second.e - item.second.s) * smoothstep(item.second.t)
+                AnimatedModels[i]->SetState(
+                    animation.s + (animation.e - animation.s) * smoothstep(animation.t)
                 );
             }
         }
-        for (auto& item : animations_to_remove)
-            ActiveToggleAnimations.erase(item);
+
+        // Render obstacles
+        if (!_GameManager->GetObstacleField().IsEmpty())
+        {
+            glUniformMatrix4fv(ProgramModelUniform, 1, GL_FALSE, Math::Matrix4x4().GetData());
+            glUniform4f(ProgramColorUniform, 0.35, 0.35, 0.4, 1);
+            Obstacles.Render();
+        }
+
+        // Render sinks and emitters
+        const auto& object_flow = _GameManager->GetObjectFlow();
+        glUniform4f(ProgramColorUniform, 0.12, 0.1, 0.2, 1);
+        for (const auto& sink : object_flow.GetSinks())
+        {
+            auto model_matrix =
+                Math::Matrix4x4::Translation(sink.Position.x, sink.Position.y, 0)
+                * Math::Matrix4x4::Scale(sink.Radius, sink.Radius, 1);
+            glUniformMatrix4fv(ProgramModelUniform, 1, GL_FALSE, model_matrix.GetData());
+            Circle.Render();
+        }
+        glUniform4f(ProgramColorUniform, 0.35, 0.35, 0.4, 1);
+        for (const auto& emitter : object_flow.GetEmitters())
+        {
+            auto model_matrix =
+                Math::Matrix4x4::Translation(emitter.Position.x, emitter.Position.y, 0)
+                * Math::Matrix4x4::Scale(EMITTER_MARK_RADIUS, EMITTER_MARK_RADIUS, 1);
+            glUniformMatrix4fv(ProgramModelUniform, 1, GL_FALSE, model_matrix.GetData());
+            Circle.Render();
+        }
 
         // Render objects
         const auto& previous_buffer = _GameManager->GetPreviousRenderBuffer();
         const auto& buffer = _GameManager->GetRenderBuffer();
-        for (int i = 0; i < _GameManager->GetObjectsCount(); i++)
+        for (int i = 0; i < _GameManager->GetRenderObjectsCount(); i++)
         {
-            const auto& item_previous = previous_buffer[i];
             const auto& item = buffer[i];
+            // The object at the same index is another one when objects are merged or removed
+            const auto& item_previous = previous_buffer[i].Id == item.Id ? previous_buffer[i] : item;
 
-            std::uniform_real_distribution<double> distribution(0.5, 1.0);
-            std::mt19937 mt(i * 3 + 0);
-            double r = distribution(mt);
-            mt.seed(i * 3 + 1);
-            double g = distribution(mt);
-            mt.seed(i * 3 + 2);
-            double b = distribution(mt);
+            auto& color = ObjectColors[i];
+            if (color.Id != item.Id)
+            {
+                std::uniform_real_distribution<double> distribution(0.5, 1.0);
+                std::mt19937 mt(item.Id * 3 + 0);
+                color.r = distribution(mt);
+                mt.seed(item.Id * 3 + 1);
+                color.g = distribution(mt);
+                mt.seed(item.Id * 3 + 2);
+                color.b = distribution(mt);
+                color.Id = item.Id;
+            }
+            double r = color.r;
+            double g = color.g;
+            double b = color.b;
+            if (_GameManager->IsSpeciesInteractionOn())
+            {
+                const auto& species_color = SPECIES_COLORS[item.Species];
+                r += (species_color[0] - r) * SPECIES_TINT;
+                g += (species_color[1] - g) * SPECIES_TINT;
+                b += (species_color[2] - b) * SPECIES_TINT;
+            }
 
             if (_GameManager->IsMotionBlurOn())
             {
@@ -234,8 +336,8 @@ namespace GravityFun
             Circle.Render();
         }
 
-        // Render hints
-        glUniform4f(ProgramColorUniform, 1, 1, 1, 1);
+        // Render hints, dimming the collision toggles while the fluid replaces them
+        bool fluid_on = _GameManager->IsFluidOn();
         float start = -(HINT_ICON_SIZE + HINT_ICON_PADDING) * (AnimatedModels.size() - 1);
         for (int i = 0; i < AnimatedModels.size(); i++)
         {
@@ -247,14 +349,110 @@ namespace GravityFun
                     HINT_ICON_SIZE,
                     1
                 );
+            float brightness = fluid_on && (model == &ObjectCollisionToggle || model == &MergeToggle) ? HINT_ICON_REPLACED_BRIGHTNESS : 1;
+            glUniform4f(ProgramColorUniform, brightness, brightness, brightness, 1);
             glUniformMatrix4fv(ProgramModelUniform, 1, GL_FALSE, model_matrix.GetData());
             model->Render();
         }
 
+        UpdateTitle();
+        RenderOverlay();
+
         auto token = StartIdling(0, PredictLowerExecutionTime());
         _Window->SwapBuffers();
     }
 
+    void Renderer::UpdateTitle()
+    {
+        bool fluid_note = _GameManager->IsFluidOn() && (_GameManager->IsObjectCollisionOn() || _GameManager->IsMergeOn());
+        const char * note = fluid_note ? FLUID_TITLE_NOTE : "";
+        char title[256];
+        if (!_GameManager->IsOverlayOn())
+        {
+            if (OverlaySnapshotNumber != -1 || fluid_note != FluidNoteShown)
+            {
+                std::snprintf(title, sizeof(title), "%s%s", OriginalTitle.c_str(), note);
+                _Window->SetTitle(title);
+                OverlaySnapshotNumber = -1;
+                FluidNoteShown = fluid_note;
+            }
+            return;
+        }
+        auto& metrics = _GameManager->GetMetrics();
+        if (OverlaySnapshotNumber == metrics.GetSnapshotNumber() && fluid_note == FluidNoteShown)
+            return;
+        const auto& snapshot = metrics.GetSnapshot();
+        OverlaySnapshotNumber = metrics.GetSnapshotNumber();
+        FluidNoteShown = fluid_note;
+        std::snprintf(title, sizeof(title),
+            "%.0f steps/s | %.0f FPS | frame %.1f/%.1f/%.1f ms | step %.2f+%.2f+%.2f+%.2f ms | imbalance %.0f%% | idle %.0f%% | %d objects%s",
+            snapshot.StepsPerSecond, snapshot.FramesPerSecond,
+            snapshot.FrameTimeMedian * 1e3, snapshot.FrameTimeP95 * 1e3, snapshot.FrameTimeP99 * 1e3,
+            snapshot.PassTimes[0] * 1e3, snapshot.PassTimes[1] * 1e3, snapshot.PassTimes[2] * 1e3, snapshot.SerialTime * 1e3,
+            snapshot.WorkerImbalance * 100, snapshot.IdlingShare * 100, snapshot.ObjectsCount, note);
+        _Window->SetTitle(title);
+    }
+
+    void Renderer::RenderOverlay()
+    {
+        if (!_GameManager->IsOverlayOn())
+            return;
+        const auto& snapshot = _GameManager->GetMetrics().GetSnapshot();
+
+        // The overlay is drawn in the normalized device coordinates
+        glUniformMatrix4fv(ProgramViewUniform, 1, GL_FALSE, Math::Matrix4x4().GetData());
+        int workers_count = (int)snapshot.WorkerLoads.size();
+        float worker_row_height = std::min(OVERLAY_ROW_HEIGHT, OVERLAY_WORKERS_HEIGHT / std::max(1, workers_count));
+        float height = OVERLAY_ROW_HEIGHT * 5 + worker_row_height * workers_count + OVERLAY_PADDING * 7;
+        glUniform4f(ProgramColorUniform, 0, 0, 0, 0.6);
+        RenderBar(OVERLAY_X - OVERLAY_PADDING, OVERLAY_Y - OVERLAY_PADDING, OVERLAY_WIDTH + 2 * OVERLAY_PADDING, height);
+
+        // From the bottom: the idling share, the workers' loads, the step's parts, and the frame time percentiles
+        float y = OVERLAY_Y;
+        glUniform4f(ProgramColorUniform, 0.3, 0.8, 0.9, 1);
+        RenderBar(OVERLAY_X, y, OVERLAY_WIDTH * snapshot.IdlingShare, OVERLAY_ROW_HEIGHT);
+        y += OVERLAY_ROW_HEIGHT + OVERLAY_PADDING;
+        glUniform4f(ProgramColorUniform, 1, 0.55, 0.2, 1);
+        for (int i = 0; i < workers_count; i++)
+            RenderBar(OVERLAY_X, y + i * worker_row_height, OVERLAY_WIDTH * snapshot.WorkerLoads[i], worker_row_height * 0.8f);
+        y += worker_row_height * workers_count + OVERLAY_PADDING;
+        double step_times[4] = { snapshot.PassTimes[0], snapshot.PassTimes[1], snapshot.PassTimes[2], snapshot.SerialTime };
+        double step_time = step_times[0] + step_times[1] + step_times[2] + step_times[3];
+        float x = OVERLAY_X;
+        for (int i = 0; i < 4 && step_time > 0; i++)
+        {
+            float width = OVERLAY_WIDTH * step_times[i] / step_time;
+            glUniform4f(ProgramColorUniform, OVERLAY_STEP_COLORS[i][0], OVERLAY_STEP_COLORS[i][1], OVERLAY_STEP_COLORS[i][2], 1);
+            RenderBar(x, y, width, OVERLAY_ROW_HEIGHT);
+            x += width;
+        }
+        y += OVERLAY_ROW_HEIGHT + OVERLAY_PADDING;
+        double frame_times[3] = { snapshot.FrameTimeP99, snapshot.FrameTimeP95, snapshot.FrameTimeMedian };
+        for (int i = 0; i < 3; i++)
+        {
+            float brightness = 0.5 + 0.25 * i;
+            glUniform4f(ProgramColorUniform, 1, brightness, brightness, 1);
+            RenderBar(OVERLAY_X, y, OVERLAY_WIDTH * std::min(1.0, frame_times[i] / OVERLAY_FRAME_TIME_SCALE), OVERLAY_ROW_HEIGHT);
+            y += OVERLAY_ROW_HEIGHT + OVERLAY_PADDING;
+        }
+        glUniform4f(ProgramColorUniform, 1, 1, 1, 1);
+        RenderBar(
+            OVERLAY_X + OVERLAY_WIDTH * OVERLAY_FRAME_TIME_MARK / OVERLAY_FRAME_TIME_SCALE,
+            y - 3 * (OVERLAY_ROW_HEIGHT + OVERLAY_PADDING), 0.003, 3 * OVERLAY_ROW_HEIGHT + 2 * OVERLAY_PADDING
+        );
+    }
+
+    void Renderer::RenderBar(float x, float y, float width, float height)
+    {
+        if (width <= 0 || height <= 0)
+            return;
+        auto model_matrix =
+            Math::Matrix4x4::Translation(x + width / 2, y + height / 2, HINT_ICON_Z)
+            * Math::Matrix4x4::Scale(width / 2, height / 2, 1);
+        glUniformMatrix4fv(ProgramModelUniform, 1, GL_FALSE, model_matrix.GetData());
+        Square.Render();
+    }
+
     void Renderer::UpdateView()
     {
         ViewMatrix = Math::Matrix4x4::Scale(1 / _GameManager->GetBorderX(), 1 / _GameManager->GetBorderY(), -1);
@@ -11,8 +11,8 @@
 
 #include <functional>
 #include <chrono>
-#include <map>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -38,12 +38,18 @@ namespace GravityFun
         std::thread::id MainThreadId;
 
         Model Circle;
+        Model Square;
+        /// @brief The obstacles in the world coordinates.
+        Model Obstacles;
 
         AnimatedModel DownGravityToggle;
         AnimatedModel RelativeGravityToggle;
         AnimatedModel VariableMassToggle;
         AnimatedModel BorderCollisionToggle;
+        AnimatedModel UnboundedToggle;
         AnimatedModel ObjectCollisionToggle;
+        AnimatedModel MergeToggle;
+        AnimatedModel SpeciesInteractionToggle;
         AnimatedModel MotionBlurToggle;
 
         AnimatedModel ObjectsCountSlider;
@@ -51,9 +57,14 @@ namespace GravityFun
         AnimatedModel EnergySavingSlider;
 
         std::vector<AnimatedModel*> AnimatedModels;
-        std::map<AnimatedModel*, std::function<float()>> AnimationTargetFunctions;
-        struct Animation { public: float s, e, t; };
-        std::map<AnimatedModel*, Animation> ActiveToggleAnimations;
+        /// @brief The states that the animated models at the same indexes animate to.
+        std::vector<std::function<float()>> AnimationTargetFunctions;
+        struct Animation { public: bool Active; float s, e, t; };
+        /// @brief The animations of the animated models at the same indexes.
+        std::vector<Animation> ToggleAnimations;
+        struct ObjectColor { public: int Id; float r, g, b; };
+        /// @brief The colors of the objects at the same render buffer indexes, computed again when the Id changes.
+        std::vector<ObjectColor> ObjectColors;
         std::chrono::steady_clock::time_point LastTime;
 
         ShaderProgram Program;
@@ -62,10 +73,23 @@ namespace GravityFun
         GLint ProgramProjectionUniform;
         GLint ProgramColorUniform;
 
+        /// @brief The snapshot of the metrics that the window title shows, or -1 when it shows the original title.
+        long long OverlaySnapshotNumber;
+        std::string OriginalTitle;
+        /// @brief Whether the window title shows that the fluid replaces the object collisions.
+        bool FluidNoteShown;
+
         Math::Matrix4x4 CalculateCircleModelMatrix(double x, double y);
         Math::Matrix4x4 ViewMatrix;
         Math::Matrix4x4 ProjectionMatrix;
 
         void UpdateView();
+        /// @brief Shows the metrics in the window title when the overlay is on,
+        ///        and notes when the fluid replaces the object collisions or merging that are on.
+        void UpdateTitle();
+        /// @brief Draws the metrics as bars when the overlay is on.
+        void RenderOverlay();
+        /// @brief Draws a bar in the normalized device coordinates.
+        void RenderBar(float x, float y, float width, float height);
     };
 }
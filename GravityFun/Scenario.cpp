@@ -0,0 +1,197 @@
+#include "Scenario.h"
+
+#include "GameManager.h"
+#include "PoissonDiskSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace GravityFun::Scenario
+{
+    /// @brief The standard deviation of each velocity component of the uniform gas.
+    constexpr double GAS_SPEED = 0.2;
+    /// @brief The radius that holds half of the Plummer sphere's mass, relative to border_y.
+    constexpr double PLUMMER_SCALE_RADIUS = 0.15;
+    /// @brief Relative to border_y.
+    constexpr double DISK_RADIUS = 0.4;
+    constexpr double DISK_SPEED = 0.3;
+    /// @brief The spacing of the piled objects relative to their diameter, so they start just apart.
+    constexpr double PILE_SPACING = 1.01;
+    /// @brief Relative to border_y.
+    constexpr double RING_RADIUS = 0.6;
+    /// @brief Relative to border_y.
+    constexpr double RING_WIDTH = 0.25;
+    constexpr double RING_SPEED = 0.5;
+    /// @brief The gap between the objects of a row of the granular bed.
+    constexpr double GRANULAR_GAP = 0.001;
+
+    const char * GetName(Kind kind)
+    {
+        switch (kind)
+        {
+        case Kind::Scattered: return "scattered";
+        case Kind::UniformGas: return "uniform-gas";
+        case Kind::PlummerSphere: return "plummer-sphere";
+        case Kind::CollidingDisks: return "colliding-disks";
+        case Kind::SettledPile: return "settled-pile";
+        case Kind::RotatingRing: return "rotating-ring";
+        case Kind::GranularBed: return "granular-bed";
+        }
+        return "";
+    }
+
+    bool Parse(const std::string& text, Kind& kind)
+    {
+        for (auto item : KINDS)
+        {
+            if (text == GetName(item))
+            {
+                kind = item;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Places a point of a distribution apart from the others if it can, else anywhere in the distribution.
+    template <typename Sample>
+    inline Math::Vec2 place(PoissonDiskSampler& sampler, const Sample& sample)
+    {
+        for (int i = 0; i < PoissonDiskSampler::MAX_ATTEMPTS; i++)
+        {
+            Math::Vec2 point = sample();
+            if (sampler.TryAddPoint(point))
+                return point;
+        }
+        // Too crowded
+        Math::Vec2 point = sample();
+        sampler.AddPoint(point);
+        return point;
+    }
+
+    inline Math::Vec2 clamp(Math::Vec2 point, double x, double y)
+    {
+        return Math::Vec2(std::clamp(point.x, -x, x), std::clamp(point.y, -y, y));
+    }
+
+    void Generate(Kind kind, std::span<FloatingObject> objects, double border_x, double border_y, bool variable_mass, Random& random)
+    {
+        int count = (int)objects.size();
+        std::vector<double> masses(count);
+        double total_mass = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (kind == Kind::GranularBed || variable_mass)
+                masses[i] = random.GetDouble(GameManager::MIN_MASS, GameManager::MAX_MASS);
+            else
+                masses[i] = GameManager::DEFAULT_MASS;
+            total_mass += masses[i];
+        }
+        double max_radius = (kind == Kind::GranularBed || variable_mass ? GameManager::MAX_MASS : GameManager::DEFAULT_MASS)
+            * GameManager::MASS_TO_RADIUS;
+        // Within the borders even in the largest size
+        double x = border_x - max_radius;
+        double y = border_y - max_radius;
+
+        PoissonDiskSampler sampler;
+        sampler.Reset(border_x, border_y, 2 * max_radius);
+        // The hexagonal pile's odd rows are shifted by half the spacing
+        double pile_spacing = 2 * max_radius * PILE_SPACING;
+        int pile_row_count = std::max(1, (int)std::floor(2 * x / pile_spacing));
+        // The granular bed's rows
+        double bed_x = -border_x;
+        double bed_y = -border_y;
+
+        for (int i = 0; i < count; i++)
+        {
+            double radius = masses[i] * GameManager::MASS_TO_RADIUS;
+            Math::Vec2 position;
+            Math::Vec2 velocity;
+            switch (kind)
+            {
+            case Kind::Scattered:
+            case Kind::UniformGas:
+                position = place(sampler, [&] { return Math::Vec2(random.GetDouble(-x, x), random.GetDouble(-y, y)); });
+                if (kind == Kind::UniformGas)
+                    velocity = Math::Vec2(random.GetNormal(0, GAS_SPEED), random.GetNormal(0, GAS_SPEED));
+                break;
+            case Kind::PlummerSphere:
+            {
+                // The projected mass within distance r is r^2 / (r^2 + a^2) of the total
+                double a = PLUMMER_SCALE_RADIUS * border_y;
+                position = place(sampler, [&]
+                {
+                    // The tail beyond the borders is cut off
+                    Math::Vec2 point(2 * x, 0);
+                    while (std::abs(point.x) > x || std::abs(point.y) > y)
+                    {
+                        double u = random.GetDouble();
+                        double angle = random.GetDouble(0, 2 * std::numbers::pi);
+                        double r = a * std::sqrt(u / (1 - u));
+                        point = Math::Vec2(r * std::cos(angle), r * std::sin(angle));
+                    }
+                    return point;
+                });
+                double r_squared = position.GetDotProduct(position);
+                double circular_speed = std::sqrt(GameManager::MASS_GRAVITY_ACCELERATION * total_mass
+                    * std::sqrt(r_squared) / (r_squared + a * a));
+                // Isotropic, with the kinetic energy of the circular orbit
+                velocity = Math::Vec2(random.GetNormal(0, circular_speed / std::numbers::sqrt2),
+                    random.GetNormal(0, circular_speed / std::numbers::sqrt2));
+                break;
+            }
+            case Kind::CollidingDisks:
+            {
+                double side = i % 2 == 0 ? -1 : 1;
+                Math::Vec2 center(side * border_x / 2, 0);
+                double disk_radius = std::min(DISK_RADIUS * border_y, border_x / 2 - max_radius);
+                position = place(sampler, [&]
+                {
+                    double r = disk_radius * std::sqrt(random.GetDouble());
+                    double angle = random.GetDouble(0, 2 * std::numbers::pi);
+                    return clamp(center + Math::Vec2(r * std::cos(angle), r * std::sin(angle)), x, y);
+                });
+                velocity = Math::Vec2(-side * DISK_SPEED, 0);
+                break;
+            }
+            case Kind::SettledPile:
+            {
+                int row = i / pile_row_count;
+                int column = i % pile_row_count;
+                position = clamp(Math::Vec2(
+                    -x + column * pile_spacing + (row % 2 == 1 ? pile_spacing / 2 : 0),
+                    -y + row * pile_spacing * std::numbers::sqrt3 / 2
+                ), x, y);
+                break;
+            }
+            case Kind::RotatingRing:
+            {
+                double angle = 0;
+                position = place(sampler, [&]
+                {
+                    double r = border_y * random.GetDouble(RING_RADIUS - RING_WIDTH / 2, RING_RADIUS + RING_WIDTH / 2);
+                    angle = random.GetDouble(0, 2 * std::numbers::pi);
+                    return clamp(Math::Vec2(r * std::cos(angle), r * std::sin(angle)), x, y);
+                });
+                // Counterclockwise
+                velocity = Math::Vec2(-std::sin(angle), std::cos(angle)) * RING_SPEED;
+                break;
+            }
+            case Kind::GranularBed:
+            {
+                if (bed_x + 2 * radius > border_x)
+                {
+                    bed_x = -border_x;
+                    bed_y += 2 * max_radius;
+                }
+                position = clamp(Math::Vec2(bed_x + radius, bed_y + radius), border_x - radius, border_y - radius);
+                bed_x += 2 * radius + GRANULAR_GAP;
+                break;
+            }
+            }
+            objects[i] = FloatingObject(masses[i], position, velocity, i, i % GameManager::SPECIES_COUNT);
+        }
+    }
+}
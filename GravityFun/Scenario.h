@@ -0,0 +1,45 @@
+#pragma once
+
+#include "FloatingObject.h"
+#include "Random.h"
+
+#include <array>
+#include <span>
+#include <string>
+
+namespace GravityFun::Scenario
+{
+    /// @brief The initial conditions of the objects, reproducible with the same seed.
+    enum class Kind
+    {
+        /// @brief Apart from each other at random, at rest. Also used for the objects added later in any scenario.
+        Scattered,
+        /// @brief Spread uniformly, with normally distributed velocities.
+        UniformGas,
+        /// @brief A Plummer profile around the center, with velocities that roughly balance the relative gravity.
+        PlummerSphere,
+        /// @brief 2 disks moving into each other.
+        CollidingDisks,
+        /// @brief Packed hexagonally from the bottom, at rest.
+        SettledPile,
+        /// @brief A thin ring around the center, moving along it.
+        RotatingRing,
+        /// @brief Objects of mixed masses packed in rows from the bottom, at rest, regardless of the variable mass mode.
+        GranularBed,
+    };
+
+    constexpr std::array<Kind, 7> KINDS = {
+        Kind::Scattered, Kind::UniformGas, Kind::PlummerSphere, Kind::CollidingDisks,
+        Kind::SettledPile, Kind::RotatingRing, Kind::GranularBed
+    };
+
+    /// @brief The lowercase hyphenated name, like "plummer-sphere".
+    const char * GetName(Kind);
+    /// @return Whether the text is the name of a scenario.
+    bool Parse(const std::string& text, Kind& kind);
+
+    /// @brief Writes the objects of a scenario within [-border_x, border_x] * [-border_y, border_y],
+    ///        with the index as the Id, in the same way for the same random state.
+    /// @param variable_mass Whether the masses are random, else GameManager::DEFAULT_MASS.
+    void Generate(Kind, std::span<FloatingObject> objects, double border_x, double border_y, bool variable_mass, Random&);
+}
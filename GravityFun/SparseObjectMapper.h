@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief Maps the objects to the cells of an unbounded grid. Only the occupied cells are stored,
+    ///        in an open addressing hash table keyed by the cell coordinates,
+    ///        so objects of distant cells never share a cell.
+    class SparseObjectMapper final
+    {
+    private:
+        /// @brief The cell coordinates are clamped to this, so far away positions do not overflow.
+        static constexpr double MaxIndex = 1 << 30;
+        /// @brief The key of (-2^31, -2^31), which clamped coordinates never have.
+        static constexpr std::uint64_t EmptyKey = 0x8000000080000000ull;
+        static constexpr int InitialSlotsCount = 64;
+
+        double PositionToIndexX = 1;
+        double PositionToIndexY = 1;
+
+        /// @brief The cell key of each slot, EmptyKey when unused. The size is a power of 2.
+        std::vector<std::uint64_t> Keys;
+        /// @brief The last added object of each used slot, followed by NextObjects.
+        std::vector<int> CellObjects;
+        std::vector<int> CellObjectsCounts;
+        /// @brief The used slots, to clear and visit them without scanning the table.
+        std::vector<int> UsedSlots;
+        /// @brief The previously added object of the same cell for each object index, -1 for none.
+        std::vector<int> NextObjects;
+
+        inline int GetIndexX(double position_x) const
+        {
+            return (int)std::clamp(std::floor(position_x * PositionToIndexX), -MaxIndex, MaxIndex);
+        }
+
+        inline int GetIndexY(double position_y) const
+        {
+            return (int)std::clamp(std::floor(position_y * PositionToIndexY), -MaxIndex, MaxIndex);
+        }
+
+        inline static std::uint64_t GetKey(int index_x, int index_y)
+        {
+            return ((std::uint64_t)(std::uint32_t)index_x << 32) | (std::uint64_t)(std::uint32_t)index_y;
+        }
+
+        /// @return The slot of the key, or the empty slot where it would be added.
+        inline int FindSlot(std::uint64_t key) const
+        {
+            std::uint64_t hash = key;
+            hash ^= hash >> 31;
+            hash *= 0x7fb5d329728ea185ull;
+            hash ^= hash >> 27;
+            int mask = (int)Keys.size() - 1;
+            for (int slot = (int)(hash & mask); ; slot = (slot + 1) & mask)
+                if (Keys[slot] == key || Keys[slot] == EmptyKey)
+                    return slot;
+        }
+
+        /// @brief Doubles the table, keeping the load factor at most 1/2.
+        inline void Grow()
+        {
+            auto keys = std::move(Keys);
+            auto cell_objects = std::move(CellObjects);
+            auto cell_objects_counts = std::move(CellObjectsCounts);
+            Keys.assign(keys.size() * 2, EmptyKey);
+            CellObjects.resize(Keys.size());
+            CellObjectsCounts.resize(Keys.size());
+            for (auto& slot : UsedSlots)
+            {
+                int new_slot = FindSlot(keys[slot]);
+                Keys[new_slot] = keys[slot];
+                CellObjects[new_slot] = cell_objects[slot];
+                CellObjectsCounts[new_slot] = cell_objects_counts[slot];
+                slot = new_slot;
+            }
+        }
+
+        template <typename Visitor>
+        inline bool VisitSlot(int slot, const Visitor& visitor) const
+        {
+            for (int i = CellObjects[slot]; i != -1; i = NextObjects[i])
+                if (visitor(i))
+                    return true;
+            return false;
+        }
+    public:
+        SparseObjectMapper()
+            : Keys(InitialSlotsCount, EmptyKey), CellObjects(InitialSlotsCount), CellObjectsCounts(InitialSlotsCount)
+        {
+        }
+
+        /// @brief Allocates for up to objects_count objects, which never occupy more cells,
+        ///        so adding them does not allocate.
+        inline void Reserve(int objects_count)
+        {
+            while (Keys.size() < 2 * (std::size_t)objects_count)
+                Grow();
+            UsedSlots.reserve(objects_count);
+            if ((int)NextObjects.size() < objects_count)
+                NextObjects.resize(objects_count);
+        }
+
+        /// @brief The mapped objects have to be cleared and added again after this.
+        inline void SetCellSize(double cell_size_x, double cell_size_y)
+        {
+            PositionToIndexX = 1 / cell_size_x;
+            PositionToIndexY = 1 / cell_size_y;
+        }
+
+        inline void Clear()
+        {
+            for (int slot : UsedSlots)
+                Keys[slot] = EmptyKey;
+            UsedSlots.clear();
+        }
+
+        inline void AddObject(Math::Vec2 position, int object_index)
+        {
+            if (object_index >= (int)NextObjects.size())
+                NextObjects.resize(object_index + 1);
+            auto key = GetKey(GetIndexX(position.x), GetIndexY(position.y));
+            int slot = FindSlot(key);
+            if (Keys[slot] == EmptyKey)
+            {
+                if (2 * (UsedSlots.size() + 1) > Keys.size())
+                {
+                    Grow();
+                    slot = FindSlot(key);
+                }
+                Keys[slot] = key;
+                CellObjects[slot] = -1;
+                CellObjectsCounts[slot] = 0;
+                UsedSlots.push_back(slot);
+            }
+            NextObjects[object_index] = CellObjects[slot];
+            CellObjects[slot] = object_index;
+            CellObjectsCounts[slot]++;
+        }
+
+        /// @brief The sum of the squared object counts of the occupied cells.
+        inline long long GetSquaredOccupancySum() const
+        {
+            long long sum = 0;
+            for (int slot : UsedSlots)
+                sum += (long long)CellObjectsCounts[slot] * CellObjectsCounts[slot];
+            return sum;
+        }
+
+        /// @brief The maximum number of cells that VisitObjects(position, radius, visitor) looks up.
+        inline int GetVisitedSlotsCount(double radius) const
+        {
+            int x = 2 * ((int)(radius * PositionToIndexX) + 1) + 1;
+            int y = 2 * ((int)(radius * PositionToIndexY) + 1) + 1;
+            return std::min(x * y, (int)UsedSlots.size());
+        }
+
+        /// @brief Visits the objects in the cell where the position is in.
+        ///        The visitor is called with the object index as int
+        ///        and can return true to stop visiting any more objects.
+        /// @return Whether the visitor returned true to stop visiting.
+        template <typename Visitor>
+        inline bool VisitObjects(Math::Vec2 position, const Visitor& visitor) const
+        {
+            int slot = FindSlot(GetKey(GetIndexX(position.x), GetIndexY(position.y)));
+            return Keys[slot] != EmptyKey && VisitSlot(slot, visitor);
+        }
+
+        /// @brief Visits the objects in the cells in proximity of the position.
+        ///        The visitor is called with the object index as int
+        ///        and can return true to stop visiting any more objects.
+        /// @return Whether the visitor returned true to stop visiting.
+        template <typename Visitor>
+        inline bool VisitObjects(Math::Vec2 position, double radius, const Visitor& visitor) const
+        {
+            int left = GetIndexX(position.x - radius);
+            int right = GetIndexX(position.x + radius);
+            int bottom = GetIndexY(position.y - radius);
+            int top = GetIndexY(position.y + radius);
+            if ((double)(right - left + 1) * (top - bottom + 1) > UsedSlots.size())
+            {
+                // Fewer occupied cells than cells in range
+                for (int slot : UsedSlots)
+                {
+                    int x = (int)(std::int32_t)(std::uint32_t)(Keys[slot] >> 32);
+                    int y = (int)(std::int32_t)(std::uint32_t)Keys[slot];
+                    if (left <= x && x <= right && bottom <= y && y <= top && VisitSlot(slot, visitor))
+                        return true;
+                }
+                return false;
+            }
+            for (int x = left; x <= right; x++)
+            {
+                for (int y = bottom; y <= top; y++)
+                {
+                    int slot = FindSlot(GetKey(x, y));
+                    if (Keys[slot] != EmptyKey && VisitSlot(slot, visitor))
+                        return true;
+                }
+            }
+            return false;
+        }
+    };
+}
@@ -0,0 +1,120 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace GravityFun::Trace
+{
+    struct Span
+    {
+        const char * Name;
+        /// @brief In nanoseconds since the start.
+        std::int64_t Begin;
+        std::int64_t End;
+    };
+
+    /// @brief Written only by its thread, and read by WriteChromeTrace.
+    struct Buffer
+    {
+        int ThreadNumber;
+        std::array<Span, BUFFER_CAPACITY> Spans;
+        /// @brief The number of the spans ever written, the next one is written to Count % BUFFER_CAPACITY.
+        std::atomic<std::uint64_t> Count{0};
+    };
+
+    static std::atomic<bool> Enabled{false};
+    static const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+    /// @brief Guards Buffers, which only grows, so the buffers outlive their threads.
+    static std::mutex BuffersMutex;
+    static std::vector<std::unique_ptr<Buffer>> Buffers;
+    static thread_local Buffer * LocalBuffer = nullptr;
+
+    static Buffer * get_local_buffer()
+    {
+        if (LocalBuffer == nullptr)
+        {
+            std::unique_ptr<Buffer> buffer(new Buffer());
+            std::lock_guard<std::mutex> lock(BuffersMutex);
+            buffer->ThreadNumber = (int)Buffers.size() + 1;
+            LocalBuffer = buffer.get();
+            Buffers.push_back(std::move(buffer));
+        }
+        return LocalBuffer;
+    }
+
+    static std::int64_t to_nanoseconds(std::chrono::steady_clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - StartTime).count();
+    }
+
+    void SetEnabled(bool value)
+    {
+        Enabled.store(value, std::memory_order_relaxed);
+    }
+    bool IsEnabled()
+    {
+        return Enabled.load(std::memory_order_relaxed);
+    }
+
+    void Record(const char * name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+    {
+        Buffer * buffer = get_local_buffer();
+        std::uint64_t count = buffer->Count.load(std::memory_order_relaxed);
+        buffer->Spans[count % BUFFER_CAPACITY] = { name, to_nanoseconds(begin), to_nanoseconds(end) };
+        buffer->Count.store(count + 1, std::memory_order_release);
+    }
+
+    Scope::Scope(const char * name) : Name(name), Enabled(IsEnabled())
+    {
+        if (Enabled)
+            Begin = std::chrono::steady_clock::now();
+    }
+    Scope::~Scope()
+    {
+        if (Enabled)
+            Record(Name, Begin, std::chrono::steady_clock::now());
+    }
+
+    bool WriteChromeTrace(const std::string& filename)
+    {
+        std::ofstream file(filename);
+        if (!file)
+            return false;
+        file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+        bool first = true;
+        std::vector<Span> spans;
+        std::lock_guard<std::mutex> lock(BuffersMutex);
+        for (auto& buffer : Buffers)
+        {
+            std::uint64_t end = buffer->Count.load(std::memory_order_acquire);
+            std::uint64_t begin = end > BUFFER_CAPACITY ? end - BUFFER_CAPACITY : 0;
+            spans.clear();
+            for (std::uint64_t i = begin; i < end; i++)
+                spans.push_back(buffer->Spans[i % BUFFER_CAPACITY]);
+            // The spans that may have been overwritten while copying, including the one being written
+            std::atomic_thread_fence(std::memory_order_acquire);
+            std::uint64_t count = buffer->Count.load(std::memory_order_relaxed);
+            std::uint64_t valid_begin = count + 1 > BUFFER_CAPACITY ? count + 1 - BUFFER_CAPACITY : 0;
+            std::size_t skipped = (std::size_t)std::min(end, std::max(begin, valid_begin)) - begin;
+
+            file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << buffer->ThreadNumber << ",\"args\":{\"name\":\"Thread " << buffer->ThreadNumber << "\"}}";
+            first = false;
+            for (std::size_t i = skipped; i < spans.size(); i++)
+            {
+                // Complete events, in microseconds
+                file << ",\n{\"name\":\"" << spans[i].Name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadNumber
+                    << ",\"ts\":" << spans[i].Begin / 1000.0 << ",\"dur\":" << (spans[i].End - spans[i].Begin) / 1000.0 << '}';
+            }
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return (bool)file;
+    }
+}
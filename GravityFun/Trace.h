@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace GravityFun::Trace
+{
+    /// @brief The number of the latest spans kept for each thread.
+    constexpr std::size_t BUFFER_CAPACITY = 1 << 16;
+
+    /// @brief Starts or stops recording spans, off by default.
+    void SetEnabled(bool);
+    bool IsEnabled();
+
+    /// @brief Adds a span to the calling thread's ring buffer, overwriting its oldest one when full.
+    ///        Lock-free, except for the first span of each thread, which allocates the thread's buffer.
+    /// @param name MUST outlive the buffers, like a string literal or a module's member.
+    void Record(const char * name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+    /// @brief Records the span from its construction to its destruction if tracing is enabled at its construction.
+    class Scope final
+    {
+    public:
+        /// @param name MUST outlive the buffers, like a string literal or a module's member.
+        explicit Scope(const char * name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+    private:
+        const char * Name;
+        bool Enabled;
+        std::chrono::steady_clock::time_point Begin;
+    };
+
+    /// @brief Writes the spans in the buffers of all threads as Chrome trace-event JSON,
+    ///        which chrome://tracing and Perfetto open. Can be called while the spans are recorded,
+    ///        the spans that are overwritten meanwhile are left out. The buffers are kept.
+    /// @return Whether the file could be written.
+    bool WriteChromeTrace(const std::string& filename);
+}
@@ -8,7 +8,7 @@ namespace GravityFun
     int Window::ObjectsCount = 0;
     std::map<GLFWwindow*, Window*> Window::ObjectsMap;
 
-    Window::Window(const std::string& title) : ResizeCallback(nullptr),
+    Window::Window(const std::string& title) : Title(title), ResizeCallback(nullptr),
                        MousePosition({0, 0}),
                        MouseLeftButton(false),
                        MouseRightButton(false),
@@ -73,9 +73,9 @@ namespace GravityFun
     bool Window::GetMouseLeftButton() { return MouseLeftButton; }
     bool Window::GetMouseRightButton() { return MouseRightButton; }
     bool Window::GetMouseMiddleButton() { return MouseMiddleButton; }
-    const std::set<int>& Window::GetPressedKeys() { return PressedKeys; }
-    const std::set<int>& Window::GetReleasedKeys() { return ReleasedKeys; }
-    const std::set<int>& Window::GetRepeatedKeys() { return RepeatedKeys; }
+    const KeySet& Window::GetPressedKeys() { return PressedKeys; }
+    const KeySet& Window::GetReleasedKeys() { return ReleasedKeys; }
+    const KeySet& Window::GetRepeatedKeys() { return RepeatedKeys; }
 
     void Window::MakeCurrent()
     {
@@ -96,6 +96,17 @@ namespace GravityFun
         glfwPollEvents();
     }
 
+    const std::string& Window::GetTitle()
+    {
+        return Title;
+    }
+
+    void Window::SetTitle(const char * title)
+    {
+        Title = title;
+        glfwSetWindowTitle(_GLFWWindow, title);
+    }
+
     void Window::SwapBuffers()
     {
         glfwSwapBuffers(_GLFWWindow);
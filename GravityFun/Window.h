@@ -6,19 +6,21 @@
 #define GLFW_INCLUDE_NONE
 #include "../glfw/include/GLFW/glfw3.h"
 
+#include "InputSource.h"
+
 #include <atomic>
 #include <functional>
 #include <map>
-#include <set>
+#include <string>
 #include <tuple>
 
 namespace GravityFun
 {
-    class Window final
+    class Window final : public InputSource
     {
     public:
         Window(const std::string& title = "GravityFun");
-        ~Window();
+        ~Window() override;
 
         Window(const Window&) = delete;
         Window(Window&&) = delete;
@@ -26,30 +28,34 @@ namespace GravityFun
         Window& operator=(Window&&) = delete;
 
         void SetResizeCallback(std::function<void(int width, int height)>);
-        void GetSize(int& width, int& height);
-        std::tuple<double, double> GetMousePosition();
-        bool GetMouseLeftButton();
-        bool GetMouseRightButton();
-        bool GetMouseMiddleButton();
-        const std::set<int>& GetPressedKeys();
-        const std::set<int>& GetReleasedKeys();
-        const std::set<int>& GetRepeatedKeys();
+        const std::string& GetTitle();
+        /// @brief Reuses the title's storage, so setting titles of similar lengths does not allocate.
+        void SetTitle(const char *);
+        void GetSize(int& width, int& height) override;
+        std::tuple<double, double> GetMousePosition() override;
+        bool GetMouseLeftButton() override;
+        bool GetMouseRightButton() override;
+        bool GetMouseMiddleButton() override;
+        const KeySet& GetPressedKeys() override;
+        const KeySet& GetReleasedKeys() override;
+        const KeySet& GetRepeatedKeys() override;
         void MakeCurrent();
-        void Update();
+        void Update() override;
         void SwapBuffers();
-        bool ShouldClose();
+        bool ShouldClose() override;
         void Close();
     private:
         static int ObjectsCount;
         static std::map<GLFWwindow*, Window*> ObjectsMap;
         GLFWwindow * _GLFWWindow;
+        std::string Title;
         std::function<void(int width, int height)> ResizeCallback;
         std::tuple<double, double> MousePosition;
         bool MouseLeftButton;
         bool MouseRightButton;
         bool MouseMiddleButton;
-        std::set<int> PressedKeys;
-        std::set<int> ReleasedKeys;
-        std::set<int> RepeatedKeys;
+        KeySet PressedKeys;
+        KeySet ReleasedKeys;
+        KeySet RepeatedKeys;
     };
 }
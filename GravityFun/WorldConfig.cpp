@@ -0,0 +1,49 @@
+#include "WorldConfig.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace GravityFun
+{
+    /// @brief The keys that ApplyWorldConfig reads.
+    constexpr const char * WORLD_CONFIG_KEYS[] = { "obstacle", "emitter", "sink", "scenario" };
+
+    template <typename Item, typename Parser>
+    inline std::vector<Item> parse_values(const Config& config, const std::string& key, const Parser& parser)
+    {
+        std::vector<Item> items;
+        for (const auto& value : config.GetValues(key))
+        {
+            Item item;
+            if (parser(value, item))
+                items.push_back(item);
+            else
+                std::cout << "Invalid " << key << " in config: " << value << '\n';
+        }
+        return items;
+    }
+
+    void ApplyWorldConfig(const Config& config, GameManager& game_manager)
+    {
+        game_manager.SetObstacles(parse_values<ObstacleField::Shape>(config, "obstacle", ObstacleField::ParseShape));
+        game_manager.SetObjectFlow(
+            parse_values<ObjectFlow::Emitter>(config, "emitter", ObjectFlow::ParseEmitter),
+            parse_values<ObjectFlow::Sink>(config, "sink", ObjectFlow::ParseSink)
+        );
+        // The last one
+        auto scenarios = parse_values<Scenario::Kind>(config, "scenario", Scenario::Parse);
+        if (!scenarios.empty())
+            game_manager.SetScenario(scenarios.back());
+    }
+
+    std::vector<std::pair<std::string, std::string>> GetWorldConfigEntries(const Config& config)
+    {
+        std::vector<std::pair<std::string, std::string>> entries;
+        for (const auto& entry : config.GetEntries())
+            if (std::any_of(std::begin(WORLD_CONFIG_KEYS), std::end(WORLD_CONFIG_KEYS),
+                    [&](const char * key) { return entry.first == key; }))
+                entries.push_back(entry);
+        return entries;
+    }
+}
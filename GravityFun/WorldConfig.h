@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Config.h"
+#include "GameManager.h"
+
+namespace GravityFun
+{
+    /// @brief Sets the obstacles, emitters, sinks, and scenario of the config to the game manager before it runs.
+    ///        The invalid values are reported to std::cout and skipped.
+    void ApplyWorldConfig(const Config& config, GameManager& game_manager);
+    /// @return The entries of the config that ApplyWorldConfig uses, in their order, so they can be recorded.
+    std::vector<std::pair<std::string, std::string>> GetWorldConfigEntries(const Config& config);
+}